@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <time.h>
+
+#include <sine_nomine/coordinate.h>
+#include <sine_nomine/dijkstra.h>
+#include <sine_nomine/fov.h>
+#include <sine_nomine/level.h>
+#include <sine_nomine/rng.h>
+#include <sine_nomine/structs.h>
+
+/*
+ * Measures the flood fill of a dijkstra map and the field of view calculation
+ * on wide levels. Build and run it once as is and once with
+ * LEVEL_LAYOUT_TILED defined to compare the memory layouts.
+ */
+
+enum { HEIGHT = 512,
+	SEED = 1,
+	WALL_PERCENT = 20,
+	DIJKSTRA_ITERATIONS = 5,
+	FOV_ITERATIONS = 20,
+	FOV_RANGE = 40,
+};
+
+static unsigned int widths[] = { 1024, 4096, 16384 };
+
+static struct level *_populate(
+    struct coordinate_dimension _dimension, struct rng *_rng);
+
+static struct coordinate _random_floor(struct level *_level, struct rng *_rng);
+
+static double _now(void);
+
+int
+main()
+{
+#if defined(LEVEL_LAYOUT_TILED)
+	printf("layout: tiled %dx%d\n", LEVEL_BLOCK_WIDTH, LEVEL_CHUNK_HEIGHT);
+#else
+	printf("layout: row-major\n");
+#endif
+
+	for (unsigned int i = 0; i < sizeof(widths) / sizeof(*widths); i++) {
+		struct rng r;
+		rng_seed(&r, SEED, RNG_STREAM_GENERATION);
+
+		struct coordinate_dimension d = { HEIGHT, widths[i] };
+		struct level *l = _populate(d, &r);
+
+		double start = _now();
+		for (int j = 0; j < DIJKSTRA_ITERATIONS; j++) {
+			struct dijkstra_map *dm = dijkstra_create(l);
+			dijkstra_add_target(dm, _random_floor(l, &r), 0);
+			dijkstra_destroy(dm);
+		}
+		double dijkstra_ms = (_now() - start) / DIJKSTRA_ITERATIONS;
+
+		start = _now();
+		struct fov *fov = fov_create(l);
+		for (int j = 0; j < FOV_ITERATIONS; j++) {
+			struct player p = { _random_floor(l, &r), FOV_RANGE };
+			fov_calculate(fov, p);
+			level_journal_clear(l);
+		}
+		fov_destroy(fov);
+		double fov_ms = (_now() - start) / FOV_ITERATIONS;
+
+		printf("%5ux%-5u  dijkstra %9.3f ms  fov %9.3f ms\n",
+		    d.height, d.width, dijkstra_ms, fov_ms);
+
+		level_destroy(l);
+	}
+
+	exit(EXIT_SUCCESS);
+}
+
+static struct level *
+_populate(struct coordinate_dimension dimension, struct rng *rng)
+{
+	struct level *l = level_create(dimension);
+
+	for (unsigned int y = 0; y < dimension.height; y++) {
+		struct coordinate c = { y, 0 };
+		level_fill_span(l, c, dimension.width, TA_FLOOR);
+
+		for (unsigned int x = 0; x < dimension.width; x++) {
+			if (rng_uniform(rng, 100) >= WALL_PERCENT)
+				continue;
+
+			c.x = x;
+			level_fill_span(l, c, 1, TA_WALL);
+		}
+	}
+
+	return (l);
+}
+
+static struct coordinate
+_random_floor(struct level *level, struct rng *rng)
+{
+	for (;;) {
+		struct coordinate c;
+		c.y = rng_uniform(rng, level->dimension.height);
+		c.x = rng_uniform(rng, level->dimension.width);
+
+		if (level_get_flags(level, c) & TA_FLOOR)
+			return (c);
+	}
+}
+
+static double
+_now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0);
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <time.h>
+#include <unistd.h>
+
+#include <sine_nomine/cave.h>
+#include <sine_nomine/coordinate.h>
+#include <sine_nomine/level.h>
+#include <sine_nomine/rng.h>
+#include <sine_nomine/save.h>
+
+/*
+ * Measures saving and loading cave levels of growing size, with the left half
+ * of each level explored and a few torches. "background" is the time the game
+ * loop spends in saver_write(), the save itself runs on another thread.
+ */
+
+enum { SEED = 1,
+	TORCHES = 1000,
+	ITERATIONS = 5,
+};
+
+static unsigned int sides[] = { 256, 1024, 4096 };
+
+static double _now(void);
+
+int
+main()
+{
+	char path[] = "/tmp/sn-bench-save-XXXXXX";
+	int fd = mkstemp(path);
+	if (fd == -1) {
+		perror("mkstemp");
+		exit(EXIT_FAILURE);
+	}
+	close(fd);
+
+	for (unsigned int i = 0; i < sizeof(sides) / sizeof(*sides); i++) {
+		struct rng r;
+		rng_seed(&r, SEED, RNG_STREAM_GENERATION);
+
+		struct coordinate_dimension d = { sides[i], sides[i] };
+		struct level *l = level_create(d);
+		cave_generate(l, &r, CAVE_FILL, CAVE_ITERATIONS);
+		level_modify_random_floor_tiles(l, &r, TORCHES, TA_TORCH);
+
+		for (unsigned int y = 0; y < d.height; y++) {
+			for (unsigned int x = 0; x < d.width / 2; x++) {
+				struct coordinate c = { y, x };
+				level_add_flags(l, c, TA_KNOWN);
+			}
+			level_journal_clear(l);
+		}
+
+		struct save s = {
+			.config = { .height = d.height, .width = d.width },
+			.player = { { 0, 0 }, 4 },
+			.level = l,
+		};
+
+		double start = _now();
+		for (int j = 0; j < ITERATIONS; j++)
+			save_write(path, &s);
+		double save_ms = (_now() - start) / ITERATIONS;
+
+		start = _now();
+		for (int j = 0; j < ITERATIONS; j++) {
+			struct save t;
+			save_read(path, &t);
+			level_destroy(t.level);
+		}
+		double load_ms = (_now() - start) / ITERATIONS;
+
+		struct saver *saver = saver_create();
+		double background_ms = 0;
+		for (int j = 0; j < ITERATIONS; j++) {
+			start = _now();
+			saver_write(saver, path, &s);
+			background_ms += _now() - start;
+
+			/* Let the save finish outside of the measurement. */
+			saver_destroy(saver);
+			saver = saver_create();
+		}
+		saver_destroy(saver);
+		background_ms /= ITERATIONS;
+
+		FILE *f = fopen(path, "rb");
+		fseek(f, 0, SEEK_END);
+		long size = ftell(f);
+		fclose(f);
+
+		printf("%5ux%-5u  save %8.3f ms  background %6.3f ms  "
+		       "load %8.3f ms  %9ld bytes\n",
+		    d.height, d.width, save_ms, background_ms, load_ms, size);
+
+		level_destroy(l);
+	}
+
+	unlink(path);
+
+	exit(EXIT_SUCCESS);
+}
+
+static double
+_now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0);
+}
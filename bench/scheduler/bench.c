@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <time.h>
+
+#include <sine_nomine/rng.h>
+#include <sine_nomine/scheduler.h>
+
+/*
+ * Measures the cost of one action of growing crowds of actors with random
+ * speeds: taking the actor due next and scheduling its next action.
+ */
+
+enum { SEED = 1,
+	SPEED_MIN = 25,
+	SPEED_MAX = 400,
+	TURNS = 20,
+};
+
+static unsigned int crowds[] = { 1000, 10000, 100000 };
+
+static double _now(void);
+
+int
+main()
+{
+	for (unsigned int i = 0; i < sizeof(crowds) / sizeof(*crowds); i++) {
+		struct rng r;
+		rng_seed(&r, SEED, RNG_STREAM_GAMEPLAY);
+
+		unsigned int n = crowds[i];
+		unsigned int *speeds = calloc(n, sizeof(unsigned int));
+		if (speeds == NULL) {
+			perror("calloc");
+			exit(EXIT_FAILURE);
+		}
+
+		struct scheduler *s = scheduler_create();
+		for (unsigned int a = 0; a < n; a++) {
+			speeds[a] = SPEED_MIN +
+			    rng_uniform(&r, SPEED_MAX - SPEED_MIN + 1);
+			scheduler_add(s, a, rng_uniform(&r, SCHEDULER_TURN));
+		}
+
+		unsigned long actions = 0;
+		double start = _now();
+		while (scheduler_get_time(s) < TURNS * SCHEDULER_TURN) {
+			unsigned int a;
+			scheduler_next(s, &a);
+			scheduler_add(s, a, scheduler_delay(speeds[a]));
+			actions++;
+		}
+		double ms = _now() - start;
+
+		printf("%8u actors  %10lu actions  %9.3f ms  %6.1f ns/action\n",
+		    n, actions, ms, 1000000.0 * ms / actions);
+
+		scheduler_destroy(s);
+		free(speeds);
+	}
+
+	exit(EXIT_SUCCESS);
+}
+
+static double
+_now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0);
+}
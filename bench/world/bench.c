@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <time.h>
+
+#include <sine_nomine/world.h>
+
+/*
+ * Walks a player through a streamed world and reports how often reading the
+ * tiles around the player had to wait for a chunk. Every step reads the tiles
+ * within VIEW of the player (as the field of view would) and then takes
+ * TURN_US of other work, standing in for the rest of a game turn.
+ */
+
+enum { SEED = 1,
+	STEPS = 20000,
+	VIEW = 10,
+	TURN_US = 50,
+};
+
+static unsigned int radii[] = { 0, 1, 2 };
+
+static double _now(void);
+
+int
+main()
+{
+	struct timespec turn = { 0, TURN_US * 1000 };
+
+	for (unsigned int i = 0; i < sizeof(radii) / sizeof(*radii); i++) {
+		struct world *w = world_create(SEED, radii[i]);
+
+		struct world_position p = { 0, 0 };
+		unsigned long floors = 0;
+
+		double start = _now();
+		for (int s = 0; s < STEPS; s++) {
+			/* Diagonally, two steps east for one step south. */
+			p.x++;
+			if (s % 2)
+				p.y++;
+
+			world_update(w, p);
+
+			for (int64_t y = p.y - VIEW; y <= p.y + VIEW; y++) {
+				for (int64_t x = p.x - VIEW; x <= p.x + VIEW;
+				     x++) {
+					struct world_position t = { y, x };
+					if (world_get_flags(w, t) & TA_FLOOR)
+						floors++;
+				}
+			}
+
+			nanosleep(&turn, NULL);
+		}
+		double ms = _now() - start;
+
+		struct world_statistics st = world_get_statistics(w);
+		printf("radius %u  %8.3f ms/step  chunks %5lu  stalls %5lu  "
+		       "evicted %5lu  resident %3u  (%lu floors)\n",
+		    radii[i], ms / STEPS, st.generated, st.stalls, st.evicted,
+		    st.resident, floors);
+
+		world_destroy(w);
+	}
+
+	exit(EXIT_SUCCESS);
+}
+
+static double
+_now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0);
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "coordinate.h"
+#include "level.h"
+#include "rng.h"
+
+typedef enum {
+	AS_WANDER,
+	AS_HUNT,
+} ACTOR_STATE;
+
+/*
+ * Refers to an actor for as long as it lives. The slot of a live actor never
+ * changes and is a small integer (e.g. a key for the scheduler); it is reused
+ * once the actor is removed, the generation tells the old and the new actor
+ * apart.
+ */
+struct actor_handle {
+	unsigned int slot;
+	unsigned int generation;
+};
+
+struct actor_slot {
+	unsigned int index;
+	unsigned int generation;
+};
+
+/*
+ * The actors of a level (monsters, the player is kept apart), stored as a
+ * structure of arrays: the properties of the actor at index i are found at
+ * index i of each array. The arrays are packed, indices run from 0 to
+ * count - 1, so that per-turn loops run linearly over the data they need.
+ * Removing an actor moves the last one into its place, thus an index is only
+ * valid until the next removal; handles stay valid.
+ *
+ * Every actor occupies its tile: the tile carries TA_OCCUPIED, and no two
+ * actors share a tile.
+ */
+struct actors {
+	struct level *level;
+	unsigned int count;
+	unsigned int capacity;
+	struct coordinate *positions;
+	unsigned int *ranges;
+	unsigned int *speeds;
+	ACTOR_STATE *states;
+	struct rng *rngs;
+	unsigned int *slots;
+
+	/* The number of actions due, kept by the game loop. */
+	unsigned int *actions;
+
+	/* Maps slots to indices, free slots are chained through index. */
+	struct actor_slot *table;
+	unsigned int table_size;
+	unsigned int free_slot;
+};
+
+struct actors *actors_create(struct level *_level);
+
+/* Frees the tiles of all actors left. */
+void actors_destroy(struct actors *_actors);
+
+/*
+ * _position must be passable and not occupied. Each actor draws from its own
+ * random number generator, seeded with _seed, so that actors may decide in
+ * any order.
+ */
+struct actor_handle actors_add(struct actors *_actors,
+    struct coordinate _position, unsigned int _range, unsigned int _speed,
+    uint64_t _seed);
+
+void actors_remove(struct actors *_actors, struct actor_handle _handle);
+
+bool actors_is_valid(struct actors *_actors, struct actor_handle _handle);
+
+/* The current index of a live actor. */
+unsigned int actors_get_index(
+    struct actors *_actors, struct actor_handle _handle);
+
+struct actor_handle actors_get_handle(
+    struct actors *_actors, unsigned int _index);
+
+/* Moves the actor at _index to _position, which must not be occupied. */
+void actors_move(
+    struct actors *_actors, unsigned int _index, struct coordinate _position);
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include "coordinate.h"
+#include "frontier.h"
+#include "level.h"
+#include "region.h"
+
+enum { AUTOEXPLORE_EDGE_PRIORITY = 20,
+	AUTOEXPLORE_TORCH_PRIORITY = 0,
+};
+
+struct autoexplore_statistics {
+	unsigned long steps;
+	unsigned long plans;
+};
+
+/*
+ * Autoexplore walks downhill on a dijkstra map seeded with the edge of the
+ * explored area and the known torches (see frontier.h). Instead of building
+ * that map on every step, the planner follows the path it took from the last
+ * map and only plans again if the map could have changed in a way that makes
+ * a different step the best one:
+ *
+ * - the target of the path is no target anymore (e.g. it became known),
+ * - a new target appeared that could be as close as the current one,
+ * - a wall was opened or closed,
+ * - the player left the path.
+ *
+ * The steps taken are the same as with a fresh map on every step.
+ *
+ * The next step can be planned on a worker thread while the game waits for
+ * input, see autoexplore_start(). The thread is started with the first plan
+ * and kept until the planner is destroyed.
+ */
+struct autoexplore {
+	struct level *level;
+	struct region_map *regions;
+	struct frontier *frontier;
+
+	unsigned long generation;
+	bool stale;
+
+	unsigned int value; /* of the dijkstra map at path[0] */
+	unsigned int length;
+	unsigned int next;
+	unsigned int capacity;
+	struct coordinate *path;
+
+	struct autoexplore_statistics statistics;
+
+	/*
+	 * Planning on a worker thread. The worker waits for busy under the
+	 * lock, and clears it once the plan is done.
+	 */
+	bool pending;
+	bool running;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t started;
+	pthread_cond_t finished;
+	bool busy;
+	bool quit;
+	atomic_bool cancelled;
+	struct coordinate player;
+	struct coordinate_offset step;
+	bool more;
+	double frontier_seconds;
+};
+
+struct autoexplore *autoexplore_create(struct level *_level,
+    struct region_map *_regions, struct frontier *_frontier);
+
+void autoexplore_destroy(struct autoexplore *_autoexplore);
+
+/*
+ * Looks at the level changes since the last call. Call it before the journal
+ * is cleared, the frontier has to be up to date.
+ */
+void autoexplore_observe(
+    struct autoexplore *_autoexplore, struct coordinate _player);
+
+/*
+ * Returns the next step for a player at _player, or false if there is nothing
+ * left to explore.
+ */
+bool autoexplore_next(struct autoexplore *_autoexplore,
+    struct coordinate _player, struct coordinate_offset *_step);
+
+/*
+ * Brings the frontier up to date and plans the next step for a player at
+ * _player on a worker thread. The level, its regions and the frontier must not
+ * be touched until autoexplore_finish() or autoexplore_cancel() returns.
+ */
+void autoexplore_start(
+    struct autoexplore *_autoexplore, struct coordinate _player);
+
+/*
+ * Waits for the step planned by autoexplore_start() and returns it like
+ * autoexplore_next() would. _frontier is set to the seconds the worker spent
+ * on the frontier.
+ */
+bool autoexplore_finish(struct autoexplore *_autoexplore,
+    struct coordinate_offset *_step, double *_frontier);
+
+/*
+ * Abandons the step planned by autoexplore_start(). The frontier is brought up
+ * to date anyway, _frontier is set as by autoexplore_finish(). A map that is
+ * being built is dropped within DIJKSTRA_CANCEL_INTERVAL tiles of its flood,
+ * the next step plans afresh.
+ */
+void autoexplore_cancel(struct autoexplore *_autoexplore, double *_frontier);
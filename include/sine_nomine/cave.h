@@ -0,0 +1,32 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include "level.h"
+#include "rng.h"
+
+enum { CAVE_FILL = 45,
+	CAVE_ITERATIONS = 5,
+};
+
+/*
+ * Generates an organic cave level with a cellular automaton. _fill is the
+ * percentage of tiles that start out as walls, _iterations the number of
+ * smoothing steps. Only the largest connected cave is kept, so every floor
+ * tile of the result is reachable from every other one.
+ */
+void cave_generate(struct level *_level, struct rng *_rng, unsigned int _fill,
+    unsigned int _iterations);
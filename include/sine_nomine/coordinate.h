@@ -43,3 +43,11 @@ struct coordinate coordinate_add_offset(
 
 struct coordinate_offset coordinate_get_offset(
     struct coordinate _a, struct coordinate _b);
+
+/*
+ * Sets [_first, _last) to the positions in [0, _length) that land in
+ * [0, _window) when _offset is added, along one axis. The range is empty if
+ * there are none.
+ */
+void coordinate_clip(unsigned int _length, unsigned int _window, int _offset,
+    unsigned int *_first, unsigned int *_last);
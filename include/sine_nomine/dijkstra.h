@@ -16,6 +16,7 @@
 #pragma once
 
 #include <limits.h>
+#include <stdatomic.h>
 
 #include "coordinate.h"
 #include "game.h"
@@ -24,13 +25,38 @@ typedef unsigned int dijkstra;
 
 struct dijkstra_map;
 
+struct region_map;
+
 enum { DIJKSTRA_MAX = UINT_MAX,
+	DIJKSTRA_CANCEL_INTERVAL = 1024, /* tiles flooded between checks */
 };
 
 struct dijkstra_map *dijkstra_create(struct level *_level);
 
 void dijkstra_destroy(struct dijkstra_map *_map);
 
+/*
+ * Restricts the map to the region of _origin: targets that cannot be reached
+ * from _origin are rejected without flooding the level, and the flood never
+ * leaves the region. Must be called before the first target is added. If
+ * _origin is a wall, the map is not restricted.
+ */
+void dijkstra_restrict(struct dijkstra_map *_map, struct region_map *_regions,
+    struct coordinate _origin);
+
+/*
+ * Stops the flood _limit steps away from the targets, tiles further away keep
+ * DIJKSTRA_MAX. Must be called before the first target is added.
+ */
+void dijkstra_limit(struct dijkstra_map *_map, dijkstra _limit);
+
+/*
+ * Makes the flood look at *_cancelled every DIJKSTRA_CANCEL_INTERVAL tiles and
+ * stop once it is set, e.g. by another thread. A map whose flood was cancelled
+ * is incomplete and good for nothing but dijkstra_destroy().
+ */
+void dijkstra_cancel(struct dijkstra_map *_map, atomic_bool *_cancelled);
+
 void dijkstra_add_target(
     struct dijkstra_map *_map, struct coordinate _position, dijkstra value);
 
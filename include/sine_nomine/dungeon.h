@@ -17,7 +17,24 @@
 
 #include "coordinate.h"
 #include "level.h"
+#include "rng.h"
 
-void dungeon_generate(struct level *_level, unsigned int _rooms,
+/*
+ * DG_WORLD generates no levels, the game is played on an unbounded world
+ * instead (see world.h).
+ */
+typedef enum {
+	DG_ROOMS,
+	DG_BSP,
+	DG_CAVE,
+	DG_WORLD,
+} DUNGEON_GENERATOR;
+
+void dungeon_generate(struct level *_level, struct rng *_rng,
+    unsigned int _rooms,
+    struct coordinate_dimension _room_min,
+    struct coordinate_dimension _room_max);
+
+void dungeon_generate_bsp(struct level *_level, struct rng *_rng,
     struct coordinate_dimension _room_min,
     struct coordinate_dimension _room_max);
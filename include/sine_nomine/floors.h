@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#include "game.h"
+#include "pregen.h"
+
+struct floors_statistics {
+	unsigned int active;
+	unsigned int compressed;
+	size_t compressed_bytes;
+	unsigned long generated;
+	unsigned long decompressed;
+};
+
+/*
+ * The floors of the dungeon the player visited. At most _active floors are
+ * kept as they are; the floor that was used least recently beyond that is
+ * compressed (see rle.h) together with its spawn and stairs, and decompressed
+ * when it is visited again. Floors not visited yet come from pregen, starting
+ * at _depth.
+ */
+struct floors;
+
+struct floors *floors_create(struct game_configuration _config,
+    unsigned int _active, unsigned int _depth);
+
+void floors_destroy(struct floors *_floors);
+
+/*
+ * Returns the floor at _depth. The floor belongs to floors and stays valid
+ * until the next call. Floors below the deepest one visited have to be
+ * visited in order.
+ */
+struct pregen_level *floors_get(struct floors *_floors, unsigned int _depth);
+
+/*
+ * Adds a floor that was not generated by pregen, e.g. one loaded from a save.
+ * The floors above it are generated again when they are visited.
+ */
+void floors_add(struct floors *_floors, struct pregen_level *_level);
+
+struct floors_statistics floors_get_statistics(struct floors *_floors);
@@ -15,6 +15,31 @@
 
 #pragma once
 
+#include <stdbool.h>
+
+#include "coordinate.h"
 #include "game.h"
+#include "level.h"
+
+/*
+ * Keeps the field of view of a level current. All tiles fov_calculate() marked
+ * visible lie in the box of side 2 * range + 1 around the position it was last
+ * called for, so only that box has to be looked at to find the tiles that are
+ * not visible anymore. The first call looks at the whole level, as it does not
+ * know which tiles are visible. The box is computed into a buffer that is
+ * reused between calls.
+ */
+struct fov {
+	struct level *level;
+	bool valid;
+	struct coordinate position;
+	unsigned int range;
+	unsigned int capacity;
+	bool *visible;
+};
+
+struct fov *fov_create(struct level *_level);
+
+void fov_destroy(struct fov *_fov);
 
-void fov_calculate(struct player _player, struct level *_level);
+void fov_calculate(struct fov *_fov, struct player _player);
@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include "level.h"
+#include "tileset.h"
+
+/*
+ * Tracks the tiles autoexplore is interested in:
+ *
+ * - edge: unknown tiles next to a known passable tile, i.e. the border of the
+ *   explored area the player can walk up to.
+ * - torches: known torches.
+ *
+ * Like the region map, both sets are kept current from the level journal and
+ * rebuilt from scratch if the journal no longer reaches back far enough. Call
+ * frontier_update() before the journal is cleared and before using the sets.
+ */
+struct frontier {
+	struct level *level;
+	unsigned long generation;
+	struct tileset *edge;
+	struct tileset *torches;
+};
+
+struct frontier *frontier_create(struct level *_level);
+
+void frontier_destroy(struct frontier *_frontier);
+
+void frontier_update(struct frontier *_frontier);
@@ -15,6 +15,11 @@
 
 #pragma once
 
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "actors.h"
+#include "dungeon.h"
 #include "level.h"
 #include "structs.h"
 
@@ -27,6 +32,72 @@ struct game_configuration {
 	unsigned int range;
 	struct range roomsize;
 	struct range torches;
+	uint64_t seed;
+	DUNGEON_GENERATOR generator;
+
+	/*
+	 * A headless game displays nothing and reads its input from the
+	 * script. Once the script is used up a bot explores each level and
+	 * descends. A limit of 0 turns lets the game run until it is quit.
+	 */
+	bool headless;
+	const char *script;
+	unsigned long turns;
+
+	/*
+	 * Paths to record the session to and to replay one from (see
+	 * replay.h), or NULL. A replayed game is headless and takes its
+	 * configuration from the recording.
+	 */
+	const char *record;
+	const char *replay;
+
+	/*
+	 * Path of the save file, or NULL. An existing save is continued. The
+	 * game is saved whenever a level is entered and when the game ends.
+	 */
+	const char *save;
+
+	/*
+	 * Threads to update the monsters with, 0 for one per processor. The
+	 * game plays the same with any number of threads.
+	 */
+	unsigned int jobs;
+};
+
+typedef enum {
+	GS_REGIONS,
+	GS_FRONTIER,
+	GS_AUTOEXPLORE,
+	GS_FOV,
+	GS_UI,
+	GS_BOT,
+	GS_LEVELS,
+	GS_SAVE,
+	GS_ACTORS,
+	GS_COUNT,
+} GAME_SUBSYSTEM;
+
+/*
+ * Times are wall clock seconds. Frames count the times the screen was drawn:
+ * turns that changed nothing are not drawn, neither are most turns followed by
+ * queued up keys. Goal hits and misses count the lookups of the maps monsters
+ * hunt with (see goalcache.h). On the world, chunks counts the chunks generated
+ * and stalls the times play had to wait for one (see world.h). The seed
+ * is the one the game was played with, a session started without --seed can
+ * be played again with it.
+ */
+struct game_statistics {
+	uint64_t seed;
+	unsigned long turns;
+	unsigned long frames;
+	unsigned long levels;
+	unsigned long goal_hits;
+	unsigned long goal_misses;
+	unsigned long chunks;
+	unsigned long stalls;
+	double seconds;
+	double subsystems[GS_COUNT];
 };
 
 struct game *game_create(struct game_configuration _config);
@@ -34,3 +105,11 @@ struct game *game_create(struct game_configuration _config);
 void game_destroy(struct game *_game);
 
 void game_loop(struct game *_game);
+
+struct game_statistics game_get_statistics(struct game *_game);
+
+/*
+ * The monsters of the current level, e.g. to compare games. They belong to the
+ * game and change as it goes on.
+ */
+const struct actors *game_get_monsters(struct game *_game);
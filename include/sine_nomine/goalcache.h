@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include "coordinate.h"
+#include "dijkstra.h"
+#include "level.h"
+
+/*
+ * Shares dijkstra maps between actors heading for the same goals. A map is
+ * keyed by its set of goals (in any order, without duplicates) and by a
+ * generation of the level chosen by the caller, usually the one the level had
+ * when the actors started to plan: maps of an older generation are not handed
+ * out anymore.
+ *
+ * Maps are reference counted. Unreferenced maps stay in the cache until more
+ * than _capacity maps are held, the least recently used ones are destroyed
+ * first. Maps still referenced are never destroyed, the cache grows beyond its
+ * capacity instead.
+ *
+ * The cache may be shared by several threads. A missing map is built outside
+ * the lock, other acquisitions of the same goals wait for it; the level must
+ * not change meanwhile.
+ */
+struct goal_cache;
+
+struct goal_cache_statistics {
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long evictions;
+};
+
+/*
+ * Maps built by the cache are limited to _limit steps from the goals (see
+ * dijkstra_limit()); DIJKSTRA_MAX floods the whole level.
+ */
+struct goal_cache *goal_cache_create(
+    struct level *_level, unsigned int _capacity, dijkstra _limit);
+
+/* All maps must have been released. */
+void goal_cache_destroy(struct goal_cache *_cache);
+
+struct dijkstra_map *goal_cache_acquire(struct goal_cache *_cache,
+    const struct coordinate *_goals, unsigned int _count,
+    unsigned long _generation);
+
+void goal_cache_release(struct goal_cache *_cache, struct dijkstra_map *_map);
+
+struct goal_cache_statistics goal_cache_get_statistics(
+    struct goal_cache *_cache);
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+/*
+ * A small pool of threads running data parallel jobs. jobs_run() splits the
+ * indices [0, _count) into chunks of _grain indices and hands each thread an
+ * equal share of consecutive chunks. A thread that runs out of chunks steals
+ * from the other end of another thread's share, so uneven chunks balance out.
+ * The calling thread takes part and jobs_run() returns once every chunk is
+ * done.
+ *
+ * The order in which chunks run is not defined. Jobs that need a deterministic
+ * result write one result per index and leave combining them to the caller.
+ */
+typedef void (*job_function)(
+    void *_context, unsigned int _begin, unsigned int _end);
+
+struct jobs;
+
+/* _threads includes the calling thread, 0 picks one per online processor. */
+struct jobs *jobs_create(unsigned int _threads);
+
+void jobs_destroy(struct jobs *_jobs);
+
+unsigned int jobs_threads(struct jobs *_jobs);
+
+void jobs_run(struct jobs *_jobs, job_function _function, void *_context,
+    unsigned int _count, unsigned int _grain);
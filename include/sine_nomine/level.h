@@ -15,7 +15,11 @@
 
 #pragma once
 
+#include <stdatomic.h>
+#include <stddef.h>
+
 #include "coordinate.h"
+#include "rng.h"
 #include "structs.h"
 
 typedef enum {
@@ -24,20 +28,171 @@ typedef enum {
 	TA_VISIBLE = 1U << 2,
 	TA_KNOWN = 1U << 3,
 	TA_TORCH = 1U << 4,
+	TA_STAIRS = 1U << 5,
+	TA_UPSTAIRS = 1U << 6,
+	TA_OCCUPIED = 1U << 7,
 } TILE_ATTRIBUTE;
 
 struct level_tile {
 	unsigned int flags;
 };
 
+/*
+ * The tiles of a level are stored in chunks, each holding a band of
+ * LEVEL_CHUNK_HEIGHT full rows. By default a chunk is a single row in
+ * row-major order. When built with LEVEL_LAYOUT_TILED, a chunk is a band of
+ * eight rows stored as consecutive 8x8 blocks, so that vertical neighbors
+ * share cache lines. Code outside of level.h never depends on the layout.
+ *
+ * Chunks are reference counted and shared between a level and its snapshots.
+ * A chunk is copied before it is modified while it is shared (copy-on-write).
+ */
+#if defined(LEVEL_LAYOUT_TILED)
+enum { LEVEL_CHUNK_HEIGHT = 8,
+	LEVEL_BLOCK_WIDTH = 8,
+};
+#else
+enum { LEVEL_CHUNK_HEIGHT = 1,
+	LEVEL_BLOCK_WIDTH = 1,
+};
+#endif
+
+struct level_chunk {
+	atomic_uint references;
+	struct level_tile tiles[];
+};
+
+/*
+ * A single modification of a tile, as recorded in the level journal.
+ */
+struct level_change {
+	struct coordinate position;
+	unsigned int old_flags;
+	unsigned int new_flags;
+};
+
+/*
+ * The journal records every modification applied through level_set_flags()
+ * and friends. Every recorded change bumps the generation counter of the level
+ * by one, so the change that produced generation g is found at index
+ * g - base - 1.
+ */
+struct level_journal {
+	unsigned long base;
+	unsigned int capacity;
+	unsigned int elements;
+	struct level_change *changes;
+};
+
 struct level {
 	struct coordinate_dimension dimension;
-	struct level_tile **tiles;
+	unsigned int chunk_count;
+	unsigned int chunk_tiles;
+	struct level_chunk **chunks;
+	unsigned long generation;
+	struct level_journal journal;
 };
 
 struct level *level_create(struct coordinate_dimension _level);
 
 void level_destroy(struct level *_level);
 
-void level_modify_random_floor_tiles(
-    struct level *_level, unsigned int _count, unsigned int _mask);
+/*
+ * Creates a snapshot of the level. The snapshot shares all chunks with the
+ * level and costs one pointer and one reference per chunk; chunks are only
+ * copied once either side modifies them. The snapshot is a level in its own
+ * right and is released with level_destroy().
+ *
+ * The snapshot may be read (and destroyed) by another thread while the level
+ * is modified, but snapshots must be created by the thread that modifies the
+ * level.
+ */
+struct level *level_snapshot(struct level *_level);
+
+static inline unsigned int
+level_chunk_index(struct coordinate _position)
+{
+	return (_position.y / LEVEL_CHUNK_HEIGHT);
+}
+
+static inline unsigned int
+level_chunk_offset(struct coordinate _position)
+{
+	unsigned int block = _position.x / LEVEL_BLOCK_WIDTH;
+	unsigned int row = _position.y % LEVEL_CHUNK_HEIGHT;
+	unsigned int column = _position.x % LEVEL_BLOCK_WIDTH;
+
+	return ((block * LEVEL_CHUNK_HEIGHT + row) * LEVEL_BLOCK_WIDTH +
+	    column);
+}
+
+/*
+ * Maps a position to a dense index in [0, chunk_count * chunk_tiles). Arrays
+ * indexed like this (e.g. dijkstra maps) follow the memory layout of the
+ * level.
+ */
+static inline size_t
+level_tile_index(const struct level *_level, struct coordinate _position)
+{
+	return ((size_t)level_chunk_index(_position) * _level->chunk_tiles +
+	    level_chunk_offset(_position));
+}
+
+static inline size_t
+level_tile_index_count(const struct level *_level)
+{
+	return ((size_t)_level->chunk_count * _level->chunk_tiles);
+}
+
+static inline unsigned int
+level_get_flags(const struct level *_level, struct coordinate _position)
+{
+	struct level_chunk *c = _level->chunks[level_chunk_index(_position)];
+
+	return (c->tiles[level_chunk_offset(_position)].flags);
+}
+
+void level_set_flags(
+    struct level *_level, struct coordinate _position, unsigned int _flags);
+
+void level_add_flags(
+    struct level *_level, struct coordinate _position, unsigned int _mask);
+
+void level_remove_flags(
+    struct level *_level, struct coordinate _position, unsigned int _mask);
+
+/*
+ * Sets the flags of _length consecutive tiles of a row, starting at _start.
+ * This is meant for bulk modifications (e.g. dungeon generators), so the
+ * modification is not journaled. Instead the journal is reset, forcing every
+ * consumer to rescan the level.
+ */
+void level_fill_span(struct level *_level, struct coordinate _start,
+    unsigned int _length, unsigned int _flags);
+
+/*
+ * Copy the flags of row _y into or out of _flags, which holds one entry per
+ * column. Like level_fill_span(), level_set_row() is not journaled.
+ */
+void level_get_row(
+    const struct level *_level, unsigned int _y, unsigned int *_flags);
+
+void level_set_row(
+    struct level *_level, unsigned int _y, const unsigned int *_flags);
+
+/*
+ * Returns the changes recorded after the level reached _generation and stores
+ * their number in _count. Returns NULL if the journal does not reach back that
+ * far; the consumer has to rescan the whole level in this case.
+ */
+const struct level_change *level_journal_since(const struct level *_level,
+    unsigned long _generation, unsigned int *_count);
+
+/*
+ * Discards all recorded changes. This is expected to be called once per turn,
+ * after all consumers had the chance to catch up.
+ */
+void level_journal_clear(struct level *_level);
+
+void level_modify_random_floor_tiles(struct level *_level, struct rng *_rng,
+    unsigned int _count, unsigned int _mask);
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include "coordinate.h"
+#include "game.h"
+#include "level.h"
+#include "region.h"
+
+/*
+ * A level ready to be played: the dungeon with its torches and stairs, the
+ * region map of the level, the spawn position of the player (on the stairs up,
+ * below the first level) and the position of the stairs down.
+ */
+struct pregen_level {
+	unsigned int depth;
+	struct level *level;
+	struct region_map *regions;
+	struct coordinate spawn;
+	struct coordinate stairs;
+};
+
+struct pregen;
+
+/*
+ * Starts a background thread that generates the levels of the dungeon one
+ * after another, starting at _depth and always one level ahead of the game.
+ * The level at depth d is generated from the seed + d, so depth 0 is the level
+ * `sn --seed <seed>` always started with.
+ */
+struct pregen *pregen_create(
+    struct game_configuration _config, unsigned int _depth);
+
+void pregen_destroy(struct pregen *_pregen);
+
+/*
+ * Takes the next level and starts generating the one after it. Only waits if
+ * the next level is not finished yet. The caller owns the returned level and
+ * releases it with pregen_release().
+ */
+struct pregen_level *pregen_take(struct pregen *_pregen);
+
+void pregen_release(struct pregen_level *_level);
+
+/*
+ * Generates the level at _depth right away, the same level pregen_take()
+ * returns at that depth.
+ */
+struct pregen_level *pregen_generate(
+    struct game_configuration _config, unsigned int _depth);
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "coordinate.h"
+#include "level.h"
+
+/*
+ * A region map labels every passable (non-wall) tile of a level with the id of
+ * its connected region, so that reachability can be answered in constant time.
+ * Walls have the id 0.
+ *
+ * The labels reflect the level as of the last region_update(). Updates are
+ * read from the level journal: opening a wall merges the neighboring regions
+ * in place, closing one (or a journal that no longer reaches back far enough)
+ * relabels the whole level. Call region_update() before the journal is
+ * cleared.
+ */
+struct region_sets {
+	unsigned int capacity;
+	unsigned int elements;
+	unsigned int *parent;
+};
+
+struct region_map {
+	struct level *level;
+	unsigned long generation;
+	unsigned int count;
+	unsigned int *labels;
+	struct region_sets sets;
+};
+
+struct region_map *region_create(struct level *_level);
+
+void region_destroy(struct region_map *_map);
+
+void region_update(struct region_map *_map);
+
+unsigned int region_get(struct region_map *_map, struct coordinate _position);
+
+bool region_connected(
+    struct region_map *_map, struct coordinate _a, struct coordinate _b);
+
+unsigned int region_count(struct region_map *_map);
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include "game.h"
+#include "ui.h"
+
+/*
+ * A recording holds the configuration of a game, including its seed, and the
+ * actions the game read from its ui, one per call of ui_get_action(). Levels
+ * and gameplay only depend on these, so replaying a recording repeats the
+ * session turn by turn: autoexplore and the bot of a headless game make the
+ * same decisions again.
+ *
+ * On disk, the configuration is followed by runs of equal actions, one byte
+ * each: the action in the high nibble and the length of the run minus one in
+ * the low nibble. An END byte and the number of turns the session lasted
+ * close the file.
+ */
+struct recording;
+
+struct replay;
+
+struct recording *recording_create(
+    const char *_path, struct game_configuration _config);
+
+/*
+ * Closes the recording of a session that lasted _turns turns.
+ */
+void recording_destroy(struct recording *_recording, unsigned long _turns);
+
+void recording_add(struct recording *_recording, UI_ACTION _action);
+
+/*
+ * Opens a recording and overwrites the configuration in _config with the
+ * recorded one, including the number of turns to play.
+ */
+struct replay *replay_create(
+    const char *_path, struct game_configuration *_config);
+
+void replay_destroy(struct replay *_replay);
+
+/*
+ * Returns the next recorded action, UA_QUIT once the recording is used up.
+ */
+UI_ACTION replay_next(struct replay *_replay);
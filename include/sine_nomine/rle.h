@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "level.h"
+
+/*
+ * Run-length encoding of the tiles of a level. The tiles are visited in
+ * row-major order, whatever the memory layout of the level is, and stored as
+ * runs of equal flags: the flags (one byte) followed by the length of the run
+ * as a varint (seven bits per byte, least significant first, the high bit set
+ * if more bytes follow). Runs may span rows.
+ */
+struct rle_buffer {
+	uint8_t *data;
+	size_t size;
+	size_t capacity;
+};
+
+/*
+ * Makes room for _size more bytes.
+ */
+void rle_reserve(struct rle_buffer *_buffer, size_t _size);
+
+/*
+ * Appends the tiles of _level, with only the flags in _mask kept. _mask must
+ * fit in a byte.
+ */
+void rle_encode(struct rle_buffer *_buffer, const struct level *_level,
+    unsigned int _mask);
+
+/*
+ * Decodes the tiles of _level from _data. Returns the number of bytes used, or
+ * 0 if _data is truncated or holds flags outside of _mask.
+ */
+size_t rle_decode(const uint8_t *_data, size_t _size, struct level *_level,
+    unsigned int _mask);
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * A small PCG32 pseudo random number generator with explicit state. Every
+ * seed provides 2^63 independent streams, so subsystems (or threads) seeded
+ * with the same seed but different streams do not influence each other.
+ */
+struct rng {
+	uint64_t state;
+	uint64_t increment;
+};
+
+enum { RNG_STREAM_GENERATION = 1,
+	RNG_STREAM_GAMEPLAY = 2,
+	RNG_STREAM_WORLD = 3,
+};
+
+void rng_seed(struct rng *_rng, uint64_t _seed, uint64_t _stream);
+
+uint32_t rng_next(struct rng *_rng);
+
+/*
+ * Returns a uniformly distributed number in [0, _bound).
+ */
+unsigned int rng_uniform(struct rng *_rng, unsigned int _bound);
+
+/*
+ * Returns the seed of the _index-th of several generators seeded from _seed,
+ * e.g. the floors of a dungeon. Unlike _seed + _index it does not hand the
+ * same seed to neighbouring seeds and indices.
+ */
+uint64_t rng_derive(uint64_t _seed, uint64_t _index);
+
+/*
+ * Returns a seed taken from the operating system.
+ */
+uint64_t rng_entropy(void);
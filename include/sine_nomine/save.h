@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "game.h"
+#include "level.h"
+#include "rng.h"
+#include "structs.h"
+
+/*
+ * Everything needed to continue a game. The regions, the frontier and the
+ * autoexplore path are derived from the level and are rebuilt after loading;
+ * the levels below are generated from the seed as usual.
+ */
+struct save {
+	struct game_configuration config;
+	unsigned int depth;
+	struct player player;
+	struct rng gameplay;
+	bool autoexplore;
+	struct level *level;
+};
+
+/*
+ * Writes the save with a single write to a temporary file, which then replaces
+ * _path. The tiles are stored as runs of equal flags, visibility is not saved.
+ */
+void save_write(const char *_path, const struct save *_save);
+
+/*
+ * Reads a save with a single read. Returns false if there is no file at _path.
+ * Only the saved fields of the configuration are overwritten, the level
+ * belongs to the caller.
+ */
+bool save_read(const char *_path, struct save *_save);
+
+/*
+ * Writes saves in the background. saver_write() only takes a snapshot of the
+ * level (see level_snapshot()) and must be called by the thread that modifies
+ * the level. It waits for the previous save to finish first, as does
+ * saver_destroy().
+ */
+struct saver;
+
+struct saver *saver_create(void);
+
+void saver_destroy(struct saver *_saver);
+
+void saver_write(
+    struct saver *_saver, const char *_path, const struct save *_save);
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+/*
+ * Orders actors by the time of their next action. Times are in ticks, an
+ * action at normal speed takes SCHEDULER_TURN ticks (see scheduler_delay()).
+ *
+ * The queue is a calendar queue: one bucket per tick for the next
+ * SCHEDULER_HORIZON ticks, filled in the order actors were added. As no delay
+ * may reach the horizon, every bucket holds the actors of exactly one tick, so
+ * adding, removing and taking the next actor are O(1) amortized, independent
+ * of the number of actors. Actors due at the same tick act in the order they
+ * were added.
+ *
+ * Actors are small integers chosen by the caller; the scheduler grows with the
+ * largest one.
+ */
+
+enum { SCHEDULER_TURN = 100,
+	SCHEDULER_NORMAL_SPEED = 100,
+	SCHEDULER_HORIZON = 4096,
+};
+
+struct scheduler;
+
+struct scheduler *scheduler_create(void);
+
+void scheduler_destroy(struct scheduler *_scheduler);
+
+/* Schedules _actor, which must not be scheduled yet, _delay ticks from now. */
+void scheduler_add(
+    struct scheduler *_scheduler, unsigned int _actor, unsigned long _delay);
+
+/* Unschedules _actor, if it is scheduled. */
+void scheduler_remove(struct scheduler *_scheduler, unsigned int _actor);
+
+bool scheduler_is_scheduled(struct scheduler *_scheduler, unsigned int _actor);
+
+/*
+ * Takes the actor due next out of the queue and advances the time to its turn.
+ * Returns false if no actor is scheduled.
+ */
+bool scheduler_next(struct scheduler *_scheduler, unsigned int *_actor);
+
+unsigned long scheduler_get_time(struct scheduler *_scheduler);
+
+unsigned int scheduler_count(struct scheduler *_scheduler);
+
+/* The delay of an action at _speed; twice the speed takes half the time. */
+unsigned long scheduler_delay(unsigned int _speed);
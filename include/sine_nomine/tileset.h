@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "coordinate.h"
+
+/*
+ * A set of tile positions with constant time insertion, removal and lookup
+ * (a sparse set). The members are kept densely in an array, so iterating the
+ * set costs time proportional to its size, not to the size of the level.
+ */
+struct tileset {
+	struct coordinate_dimension dimension;
+	unsigned int *slots;
+	unsigned int count;
+	unsigned int capacity;
+	struct coordinate *members;
+};
+
+struct tileset *tileset_create(struct coordinate_dimension _dimension);
+
+void tileset_destroy(struct tileset *_set);
+
+/*
+ * Returns true if the position was not a member before.
+ */
+bool tileset_add(struct tileset *_set, struct coordinate _position);
+
+/*
+ * Returns true if the position was a member before.
+ */
+bool tileset_remove(struct tileset *_set, struct coordinate _position);
+
+bool tileset_contains(struct tileset *_set, struct coordinate _position);
+
+void tileset_clear(struct tileset *_set);
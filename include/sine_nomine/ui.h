@@ -15,6 +15,8 @@
 
 #pragma once
 
+#include <stdbool.h>
+
 #include "level.h"
 #include "structs.h"
 
@@ -26,13 +28,23 @@ typedef enum {
 	UA_LEFT,
 	UA_RIGHT,
 	UA_AUTOEXPLORE,
+	UA_DESCEND,
 	UA_TIMEOUT,
+	UA_ASCEND, /* recordings store the values, append new actions */
+	UA_RESIZE,
 } UI_ACTION;
 
 struct ui_context;
 
 struct ui_context *ui_create(void);
 
+/*
+ * Creates a ui that displays nothing and never waits. ui_get_action() returns
+ * the actions of the keys in _script, one per call, and UA_TIMEOUT once the
+ * script is used up. _script may be NULL.
+ */
+struct ui_context *ui_create_headless(const char *_script);
+
 void ui_destroy(struct ui_context *_context);
 
 void ui_display(
@@ -42,6 +54,13 @@ void ui_timeout(struct ui_context *_context, unsigned int _timeout);
 
 UI_ACTION ui_get_action(struct ui_context *_context);
 
+/*
+ * Returns true if ui_get_action() would return right away with a key, i.e. if
+ * keys are queued up. A headless ui has keys pending until its script is used
+ * up.
+ */
+bool ui_input_pending(struct ui_context *_context);
+
 /*
  * This is deliberately the only ui_* function that needs no explicit
  * ui_context. Call this to exit the ui before emitting error messages.
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "coordinate.h"
+#include "level.h"
+
+/*
+ * An unbounded world made of square chunks. Every chunk is a small level that
+ * is generated deterministically from the world seed and its chunk coordinate,
+ * so chunks can be dropped when the player moves away and generated again when
+ * the player returns. Neighboring chunks agree on gates in their shared border,
+ * which keeps the world connected across chunks.
+ *
+ * A background thread generates the chunks around the player ahead of time
+ * (see world_update()). Reading a tile of a chunk that is not ready yet
+ * generates it on the spot (a stall).
+ *
+ * Chunks are regenerated from scratch, so the world is read only. A world must
+ * only be used by the thread that created it.
+ */
+enum { WORLD_CHUNK_SIZE = 64,
+};
+
+struct world;
+
+struct world_position {
+	int64_t y;
+	int64_t x;
+};
+
+struct world_statistics {
+	unsigned long generated;
+	unsigned long stalls;
+	unsigned long evicted;
+	unsigned int resident;
+};
+
+/*
+ * Chunks within _radius chunks of the player are prefetched, chunks further
+ * away than _radius + 1 are evicted.
+ */
+struct world *world_create(uint64_t _seed, unsigned int _radius);
+
+void world_destroy(struct world *_world);
+
+/*
+ * Moves the player: queues the missing chunks around _player (nearest first)
+ * and evicts the chunks that are too far away.
+ */
+void world_update(struct world *_world, struct world_position _player);
+
+unsigned int world_get_flags(
+    struct world *_world, struct world_position _position);
+
+/*
+ * Copies the part of the world of size _dimension whose top left corner is at
+ * _origin into a new level (e.g. the part a game is played on).
+ */
+struct level *world_window(struct world *_world,
+    struct world_position _origin, struct coordinate_dimension _dimension);
+
+struct world_statistics world_get_statistics(struct world *_world);
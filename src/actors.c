@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <assert.h>
+
+#include <sine_nomine/actors.h>
+#include <sine_nomine/coordinate.h>
+#include <sine_nomine/err.h>
+#include <sine_nomine/level.h>
+#include <sine_nomine/rng.h>
+
+enum { ACTORS_INITIAL_CAPACITY = 64,
+};
+
+static const unsigned int no_slot = UINT_MAX;
+
+static void _grow(struct actors *_actors);
+
+static unsigned int _take_slot(struct actors *_actors);
+
+static void *_resize(void *_array, unsigned int _count, size_t _size);
+
+struct actors *
+actors_create(struct level *level)
+{
+	assert(level != NULL);
+
+	struct actors *a = calloc(1, sizeof(struct actors));
+	if (a == NULL)
+		err("calloc");
+
+	assert(a != NULL);
+
+	a->level = level;
+	a->free_slot = no_slot;
+
+	return (a);
+}
+
+void
+actors_destroy(struct actors *actors)
+{
+	assert(actors != NULL);
+
+	struct actors *a = actors;
+
+	for (unsigned int i = 0; i < a->count; i++)
+		level_remove_flags(a->level, a->positions[i], TA_OCCUPIED);
+
+	free(a->positions);
+	free(a->ranges);
+	free(a->speeds);
+	free(a->states);
+	free(a->rngs);
+	free(a->slots);
+	free(a->actions);
+	free(a->table);
+	free(a);
+}
+
+struct actor_handle
+actors_add(struct actors *actors, struct coordinate position,
+    unsigned int range, unsigned int speed, uint64_t seed)
+{
+	assert(actors != NULL);
+
+	struct actors *a = actors;
+
+	unsigned int flags = level_get_flags(a->level, position);
+	assert(!(flags & (TA_WALL | TA_OCCUPIED)));
+
+	if (a->count == a->capacity)
+		_grow(a);
+
+	unsigned int slot = _take_slot(a);
+	unsigned int i = a->count++;
+
+	a->positions[i] = position;
+	a->ranges[i] = range;
+	a->speeds[i] = speed;
+	a->states[i] = AS_WANDER;
+	rng_seed(&a->rngs[i], seed, RNG_STREAM_GAMEPLAY);
+	a->slots[i] = slot;
+	a->actions[i] = 0;
+	a->table[slot].index = i;
+
+	level_add_flags(a->level, position, TA_OCCUPIED);
+
+	return ((struct actor_handle) { slot, a->table[slot].generation });
+}
+
+void
+actors_remove(struct actors *actors, struct actor_handle handle)
+{
+	assert(actors != NULL);
+	assert(actors_is_valid(actors, handle));
+
+	struct actors *a = actors;
+
+	unsigned int i = a->table[handle.slot].index;
+	unsigned int last = --a->count;
+
+	level_remove_flags(a->level, a->positions[i], TA_OCCUPIED);
+
+	a->positions[i] = a->positions[last];
+	a->ranges[i] = a->ranges[last];
+	a->speeds[i] = a->speeds[last];
+	a->states[i] = a->states[last];
+	a->rngs[i] = a->rngs[last];
+	a->slots[i] = a->slots[last];
+	a->actions[i] = a->actions[last];
+	a->table[a->slots[i]].index = i;
+
+	a->table[handle.slot].generation++;
+	a->table[handle.slot].index = a->free_slot;
+	a->free_slot = handle.slot;
+}
+
+bool
+actors_is_valid(struct actors *actors, struct actor_handle handle)
+{
+	assert(actors != NULL);
+
+	struct actors *a = actors;
+
+	if (handle.slot >= a->table_size)
+		return (false);
+
+	struct actor_slot s = a->table[handle.slot];
+
+	return (s.generation == handle.generation && s.index < a->count &&
+	    a->slots[s.index] == handle.slot);
+}
+
+unsigned int
+actors_get_index(struct actors *actors, struct actor_handle handle)
+{
+	assert(actors_is_valid(actors, handle));
+
+	return (actors->table[handle.slot].index);
+}
+
+struct actor_handle
+actors_get_handle(struct actors *actors, unsigned int index)
+{
+	assert(actors != NULL);
+	assert(index < actors->count);
+
+	unsigned int slot = actors->slots[index];
+
+	return ((struct actor_handle) { slot, actors->table[slot].generation });
+}
+
+void
+actors_move(
+    struct actors *actors, unsigned int index, struct coordinate position)
+{
+	assert(actors != NULL);
+	assert(index < actors->count);
+
+	struct actors *a = actors;
+
+	assert(!(level_get_flags(a->level, position) & TA_OCCUPIED));
+
+	level_remove_flags(a->level, a->positions[index], TA_OCCUPIED);
+	level_add_flags(a->level, position, TA_OCCUPIED);
+	a->positions[index] = position;
+}
+
+/*
+ * Every actor owns a slot, so the table never has to grow past the capacity of
+ * the arrays.
+ */
+static void
+_grow(struct actors *actors)
+{
+	struct actors *a = actors;
+
+	unsigned int n =
+	    a->capacity ? a->capacity * 2 : ACTORS_INITIAL_CAPACITY;
+
+	a->positions = _resize(a->positions, n, sizeof(*a->positions));
+	a->ranges = _resize(a->ranges, n, sizeof(*a->ranges));
+	a->speeds = _resize(a->speeds, n, sizeof(*a->speeds));
+	a->states = _resize(a->states, n, sizeof(*a->states));
+	a->rngs = _resize(a->rngs, n, sizeof(*a->rngs));
+	a->slots = _resize(a->slots, n, sizeof(*a->slots));
+	a->actions = _resize(a->actions, n, sizeof(*a->actions));
+	a->table = _resize(a->table, n, sizeof(*a->table));
+	a->capacity = n;
+}
+
+static unsigned int
+_take_slot(struct actors *actors)
+{
+	struct actors *a = actors;
+
+	if (a->free_slot != no_slot) {
+		unsigned int slot = a->free_slot;
+		a->free_slot = a->table[slot].index;
+
+		return (slot);
+	}
+
+	assert(a->table_size < a->capacity);
+
+	a->table[a->table_size].generation = 0;
+
+	return (a->table_size++);
+}
+
+static void *
+_resize(void *array, unsigned int count, size_t size)
+{
+	void *p = realloc(array, count * size);
+	if (p == NULL)
+		err("realloc");
+
+	assert(p != NULL);
+
+	return (p);
+}
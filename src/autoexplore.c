@@ -0,0 +1,505 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <pthread.h>
+#include <time.h>
+
+#include <sine_nomine/autoexplore.h>
+#include <sine_nomine/coordinate.h>
+#include <sine_nomine/dijkstra.h>
+#include <sine_nomine/err.h>
+#include <sine_nomine/frontier.h>
+#include <sine_nomine/level.h>
+#include <sine_nomine/region.h>
+#include <sine_nomine/tileset.h>
+
+enum { PATH_INITIAL_CAPACITY = 64,
+};
+
+/* The order decides between equally good steps. */
+static const struct coordinate_offset _offsets[4] = { { -1, 0 }, { 0, 1 },
+	{ 1, 0 }, { 0, -1 } };
+
+static void *_worker(void *_autoexplore);
+
+static void _work(struct autoexplore *_autoexplore);
+
+static void _wait(struct autoexplore *_autoexplore);
+
+static bool _cancelled(struct autoexplore *_autoexplore);
+
+static bool _plan(struct autoexplore *_autoexplore, struct coordinate _player,
+    struct coordinate_offset *_step);
+
+static bool _best_neighbor(struct autoexplore *_autoexplore,
+    struct dijkstra_map *_map, struct coordinate _position,
+    struct coordinate_offset *_offset);
+
+static void _append(struct autoexplore *_autoexplore, struct coordinate _c);
+
+static bool _target_value(struct autoexplore *_autoexplore,
+    struct coordinate _position, unsigned int *_value);
+
+static bool _affects_plan(struct autoexplore *_autoexplore,
+    struct coordinate _player, struct coordinate _changed);
+
+static unsigned int _manhattan(struct coordinate _a, struct coordinate _b);
+
+static bool _equal(struct coordinate _a, struct coordinate _b);
+
+static double _now(void);
+
+struct autoexplore *
+autoexplore_create(struct level *level, struct region_map *regions,
+    struct frontier *frontier)
+{
+	assert(level != NULL);
+	assert(regions != NULL);
+	assert(frontier != NULL);
+
+	struct autoexplore *a = calloc(1, sizeof(struct autoexplore));
+	if (a == NULL)
+		err("calloc");
+
+	assert(a != NULL);
+
+	a->level = level;
+	a->regions = regions;
+	a->frontier = frontier;
+	a->stale = true;
+	atomic_init(&a->cancelled, false);
+
+	if (pthread_mutex_init(&a->lock, NULL) != 0)
+		err("pthread_mutex_init");
+	if (pthread_cond_init(&a->started, NULL) != 0)
+		err("pthread_cond_init");
+	if (pthread_cond_init(&a->finished, NULL) != 0)
+		err("pthread_cond_init");
+
+	return (a);
+}
+
+void
+autoexplore_destroy(struct autoexplore *autoexplore)
+{
+	assert(autoexplore != NULL);
+
+	struct autoexplore *a = autoexplore;
+
+	if (a->pending) {
+		double frontier;
+		autoexplore_cancel(a, &frontier);
+	}
+
+	if (a->running) {
+		pthread_mutex_lock(&a->lock);
+		a->quit = true;
+		pthread_cond_signal(&a->started);
+		pthread_mutex_unlock(&a->lock);
+
+		pthread_join(a->thread, NULL);
+	}
+
+	pthread_cond_destroy(&a->finished);
+	pthread_cond_destroy(&a->started);
+	pthread_mutex_destroy(&a->lock);
+	free(a->path);
+	free(a);
+}
+
+void
+autoexplore_observe(struct autoexplore *autoexplore, struct coordinate player)
+{
+	assert(autoexplore != NULL);
+
+	struct autoexplore *a = autoexplore;
+	unsigned long generation = a->generation;
+	a->generation = a->level->generation;
+
+	if (a->stale || generation == a->level->generation)
+		return;
+
+	unsigned int n;
+	const struct level_change *c =
+	    level_journal_since(a->level, generation, &n);
+	if (c == NULL) {
+		a->stale = true;
+		return;
+	}
+
+	for (unsigned int i = 0; i < n && !a->stale; i++) {
+		unsigned int changed = c[i].old_flags ^ c[i].new_flags;
+
+		if (changed & (TA_WALL | TA_FLOOR)) {
+			a->stale = true;
+			break;
+		}
+
+		if (changed & (TA_KNOWN | TA_TORCH))
+			a->stale = _affects_plan(a, player, c[i].position);
+	}
+
+	unsigned int value;
+	struct coordinate target = a->path[a->length - 1];
+	if (!_target_value(a, target, &value))
+		a->stale = true;
+}
+
+bool
+autoexplore_next(struct autoexplore *autoexplore, struct coordinate player,
+    struct coordinate_offset *step)
+{
+	assert(autoexplore != NULL);
+	assert(step != NULL);
+
+	struct autoexplore *a = autoexplore;
+	autoexplore_observe(a, player);
+
+	a->statistics.steps++;
+
+	if (a->stale || !_equal(player, a->path[a->next]) ||
+	    a->next + 1 >= a->length)
+		return (_plan(a, player, step));
+
+	*step = coordinate_get_offset(a->path[a->next + 1], a->path[a->next]);
+	a->next++;
+
+	return (true);
+}
+
+void
+autoexplore_start(struct autoexplore *autoexplore, struct coordinate player)
+{
+	assert(autoexplore != NULL);
+	assert(!autoexplore->pending);
+
+	struct autoexplore *a = autoexplore;
+
+	if (!a->running) {
+		if (pthread_create(&a->thread, NULL, _worker, a) != 0)
+			err("pthread_create");
+
+		a->running = true;
+	}
+
+	pthread_mutex_lock(&a->lock);
+	a->player = player;
+	a->busy = true;
+	pthread_cond_signal(&a->started);
+	pthread_mutex_unlock(&a->lock);
+
+	a->pending = true;
+}
+
+bool
+autoexplore_finish(struct autoexplore *autoexplore,
+    struct coordinate_offset *step, double *frontier)
+{
+	assert(autoexplore != NULL);
+	assert(autoexplore->pending);
+	assert(step != NULL);
+	assert(frontier != NULL);
+
+	_wait(autoexplore);
+
+	*step = autoexplore->step;
+	*frontier = autoexplore->frontier_seconds;
+
+	return (autoexplore->more);
+}
+
+void
+autoexplore_cancel(struct autoexplore *autoexplore, double *frontier)
+{
+	assert(autoexplore != NULL);
+	assert(autoexplore->pending);
+	assert(frontier != NULL);
+
+	atomic_store(&autoexplore->cancelled, true);
+	_wait(autoexplore);
+
+	*frontier = autoexplore->frontier_seconds;
+}
+
+static void *
+_worker(void *arg)
+{
+	struct autoexplore *a = arg;
+
+	pthread_mutex_lock(&a->lock);
+	for (;;) {
+		while (!a->busy && !a->quit)
+			pthread_cond_wait(&a->started, &a->lock);
+		if (a->quit)
+			break;
+
+		pthread_mutex_unlock(&a->lock);
+		_work(a);
+		pthread_mutex_lock(&a->lock);
+
+		a->busy = false;
+		pthread_cond_signal(&a->finished);
+	}
+	pthread_mutex_unlock(&a->lock);
+
+	return (NULL);
+}
+
+/*
+ * The frontier is always brought up to date, it must not be left halfway.
+ * The plan is skipped or abandoned once it is cancelled.
+ */
+static void
+_work(struct autoexplore *autoexplore)
+{
+	struct autoexplore *a = autoexplore;
+
+	double t = _now();
+	frontier_update(a->frontier);
+	a->frontier_seconds = _now() - t;
+
+	a->more = false;
+	a->step = (struct coordinate_offset) { 0, 0 };
+	if (!_cancelled(a))
+		a->more = autoexplore_next(a, a->player, &a->step);
+}
+
+static void
+_wait(struct autoexplore *autoexplore)
+{
+	struct autoexplore *a = autoexplore;
+
+	pthread_mutex_lock(&a->lock);
+	while (a->busy)
+		pthread_cond_wait(&a->finished, &a->lock);
+	pthread_mutex_unlock(&a->lock);
+
+	atomic_store(&a->cancelled, false);
+	a->pending = false;
+}
+
+static bool
+_cancelled(struct autoexplore *autoexplore)
+{
+	return (atomic_load(&autoexplore->cancelled));
+}
+
+/*
+ * Builds the dijkstra map and records the path downhill from the player to the
+ * target it leads to. A cancelled plan stops the flood and drops the map, it
+ * returns false and leaves the planner stale.
+ */
+static bool
+_plan(struct autoexplore *autoexplore, struct coordinate player,
+    struct coordinate_offset *step)
+{
+	struct autoexplore *a = autoexplore;
+
+	a->statistics.plans++;
+	a->stale = true;
+	a->generation = a->level->generation;
+
+	struct dijkstra_map *dm = dijkstra_create(a->level);
+	dijkstra_restrict(dm, a->regions, player);
+	dijkstra_cancel(dm, &a->cancelled);
+
+	struct tileset *edge = a->frontier->edge;
+	for (unsigned int i = 0; i < edge->count && !_cancelled(a); i++) {
+		dijkstra_add_target(
+		    dm, edge->members[i], AUTOEXPLORE_EDGE_PRIORITY);
+	}
+
+	struct tileset *torches = a->frontier->torches;
+	for (unsigned int i = 0; i < torches->count && !_cancelled(a); i++) {
+		dijkstra_add_target(
+		    dm, torches->members[i], AUTOEXPLORE_TORCH_PRIORITY);
+	}
+
+	dijkstra value = dijkstra_get_value(dm, player);
+	if (value == DIJKSTRA_MAX || _cancelled(a)) {
+		dijkstra_destroy(dm);
+		return (false);
+	}
+
+	a->length = 0;
+	a->next = 0;
+	a->value = value;
+	_append(a, player);
+
+	struct coordinate c = player;
+	struct coordinate_offset o;
+	while (_best_neighbor(a, dm, c, &o)) {
+		if (_cancelled(a)) {
+			dijkstra_destroy(dm);
+			return (false);
+		}
+
+		struct coordinate n = coordinate_add_offset(c, o);
+		if (dijkstra_get_value(dm, n) >= dijkstra_get_value(dm, c))
+			break;
+
+		_append(a, n);
+		c = n;
+	}
+
+	/*
+	 * Standing on a target already, just step to the best neighbor and
+	 * plan again next time.
+	 */
+	if (a->length == 1) {
+		bool found = _best_neighbor(a, dm, player, step);
+		dijkstra_destroy(dm);
+
+		return (found);
+	}
+
+	dijkstra_destroy(dm);
+
+	a->stale = false;
+	*step = coordinate_get_offset(a->path[1], a->path[0]);
+	a->next = 1;
+
+	return (true);
+}
+
+/*
+ * Finds the neighbor with the lowest value, the first one in _offsets wins a
+ * tie. Returns false if no neighbor has a value.
+ */
+static bool
+_best_neighbor(struct autoexplore *autoexplore, struct dijkstra_map *map,
+    struct coordinate position, struct coordinate_offset *offset)
+{
+	dijkstra min = DIJKSTRA_MAX;
+
+	for (int i = 0; i < 4; i++) {
+		if (!coordinate_check_bounds_offset(
+			autoexplore->level->dimension, position, _offsets[i]))
+			continue;
+
+		struct coordinate c =
+		    coordinate_add_offset(position, _offsets[i]);
+		if (dijkstra_get_value(map, c) < min) {
+			min = dijkstra_get_value(map, c);
+			*offset = _offsets[i];
+		}
+	}
+
+	return (min != DIJKSTRA_MAX);
+}
+
+static void
+_append(struct autoexplore *autoexplore, struct coordinate c)
+{
+	struct autoexplore *a = autoexplore;
+
+	if (a->length == a->capacity) {
+		a->capacity = a->capacity ? a->capacity * 2
+					  : PATH_INITIAL_CAPACITY;
+
+		a->path = realloc(a->path, a->capacity * sizeof(*a->path));
+		if (a->path == NULL)
+			err("realloc");
+
+		assert(a->path != NULL);
+	}
+
+	a->path[a->length++] = c;
+}
+
+/*
+ * Returns true if the position is a target, along with its priority.
+ */
+static bool
+_target_value(struct autoexplore *autoexplore, struct coordinate position,
+    unsigned int *value)
+{
+	if (tileset_contains(autoexplore->frontier->torches, position)) {
+		*value = AUTOEXPLORE_TORCH_PRIORITY;
+		return (true);
+	}
+
+	if (tileset_contains(autoexplore->frontier->edge, position)) {
+		*value = AUTOEXPLORE_EDGE_PRIORITY;
+		return (true);
+	}
+
+	return (false);
+}
+
+/*
+ * A change can only turn the changed tile or its neighbors into new targets.
+ * A new target t can only make a different step the best one if it could be
+ * as close as the current target, i.e. if its value plus the (lower bound of
+ * the) distance to it does not exceed the value at the player.
+ */
+static bool
+_affects_plan(struct autoexplore *autoexplore, struct coordinate player,
+    struct coordinate changed)
+{
+	struct autoexplore *a = autoexplore;
+	unsigned int remaining = a->value - a->next;
+
+	for (int i = -1; i < 4; i++) {
+		struct coordinate c = changed;
+		if (i >= 0) {
+			if (!coordinate_check_bounds_offset(
+				a->level->dimension, changed, _offsets[i]))
+				continue;
+
+			c = coordinate_add_offset(changed, _offsets[i]);
+		}
+
+		unsigned int value;
+		if (!_target_value(a, c, &value))
+			continue;
+
+		if (value + _manhattan(player, c) <= remaining)
+			return (true);
+	}
+
+	return (false);
+}
+
+static unsigned int
+_manhattan(struct coordinate a, struct coordinate b)
+{
+	unsigned int dy = a.y > b.y ? a.y - b.y : b.y - a.y;
+	unsigned int dx = a.x > b.x ? a.x - b.x : b.x - a.x;
+
+	return (dy + dx);
+}
+
+static bool
+_equal(struct coordinate a, struct coordinate b)
+{
+	return (a.y == b.y && a.x == b.x);
+}
+
+static double
+_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (ts.tv_sec + ts.tv_nsec / 1e9);
+}
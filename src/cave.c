@@ -0,0 +1,445 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <string.h>
+
+#include <sine_nomine/cave.h>
+#include <sine_nomine/coordinate.h>
+#include <sine_nomine/err.h>
+#include <sine_nomine/level.h>
+#include <sine_nomine/rng.h>
+
+enum { RUNS_INITIAL_CAPACITY = 64,
+};
+
+/*
+ * The automaton works on a grid of bits: every row is packed into 64 bit
+ * words, bit b of word w representing the tile at x = w * 64 + b. A set bit is
+ * a wall. The padding bits beyond the level width are kept set, so they act as
+ * walls as well.
+ */
+struct _grid {
+	struct coordinate_dimension dimension;
+	unsigned int words;
+	uint64_t *cells;
+};
+
+/*
+ * A horizontal run of floor tiles [start, end) in row y. Runs are the nodes of
+ * the union-find structure used to find the connected caves.
+ */
+struct _run {
+	unsigned int y;
+	unsigned int start;
+	unsigned int end;
+	unsigned int parent;
+	unsigned long size;
+};
+
+struct _runs {
+	unsigned int capacity;
+	unsigned int elements;
+	struct _run *runs;
+};
+
+static struct _grid *_grid_create(struct coordinate_dimension _dimension);
+
+static void _grid_destroy(struct _grid *_grid);
+
+static uint64_t *_grid_row(struct _grid *_grid, unsigned int _y);
+
+static void _randomize(
+    struct _grid *_grid, struct rng *_rng, unsigned int _fill);
+
+static void _close_borders(struct _grid *_grid);
+
+static void _smooth(struct _grid *_source, struct _grid *_target);
+
+static unsigned int _next_bit(const uint64_t *_row, unsigned int _words,
+    unsigned int _from, bool _value);
+
+static void _collect_runs(
+    struct _grid *_grid, struct _runs *_runs, unsigned int _first[]);
+
+static void _append_run(struct _runs *_runs, unsigned int _y,
+    unsigned int _start, unsigned int _end);
+
+static unsigned int _find(struct _run _runs[], unsigned int _run);
+
+static void _union(struct _run _runs[], unsigned int _a, unsigned int _b);
+
+static void _write_largest_cave(struct level *_level, struct _grid *_grid);
+
+/*
+ * The classic 4-5 rule: a tile becomes a wall if at least five tiles of its
+ * 3x3 neighborhood (including itself) are walls, and a floor otherwise.
+ *
+ * Instead of counting neighbors tile by tile, every smoothing step processes
+ * 64 tiles at once. The nine neighborhood bits are summed with bitwise full
+ * adders (bit slicing), so a step costs a few dozen logical operations per 64
+ * tiles.
+ */
+void
+cave_generate(struct level *level, struct rng *rng, unsigned int fill,
+    unsigned int iterations)
+{
+	assert(level != NULL);
+	assert(rng != NULL);
+	assert(fill <= 100);
+	assert(level->dimension.height >= 3);
+	assert(level->dimension.width >= 3);
+
+	struct _grid *g[2] = { _grid_create(level->dimension),
+		_grid_create(level->dimension) };
+
+	_randomize(g[0], rng, fill);
+	_close_borders(g[0]);
+
+	for (unsigned int i = 0; i < iterations; i++)
+		_smooth(g[i % 2], g[(i + 1) % 2]);
+
+	_write_largest_cave(level, g[iterations % 2]);
+
+	_grid_destroy(g[0]);
+	_grid_destroy(g[1]);
+}
+
+static struct _grid *
+_grid_create(struct coordinate_dimension dimension)
+{
+	struct _grid *g = calloc(1, sizeof(struct _grid));
+	if (g == NULL)
+		err("calloc");
+
+	assert(g != NULL);
+
+	g->dimension = dimension;
+	g->words = (dimension.width + 63) / 64;
+
+	g->cells = calloc((size_t)dimension.height * g->words,
+	    sizeof(*g->cells));
+	if (g->cells == NULL)
+		err("calloc");
+
+	assert(g->cells != NULL);
+
+	return (g);
+}
+
+static void
+_grid_destroy(struct _grid *grid)
+{
+	free(grid->cells);
+	free(grid);
+}
+
+static uint64_t *
+_grid_row(struct _grid *grid, unsigned int y)
+{
+	assert(y < grid->dimension.height);
+
+	return (&grid->cells[(size_t)y * grid->words]);
+}
+
+/*
+ * Sets every bit with a probability of _fill percent (rounded to 1/256). The
+ * probability is built bit by bit from random words: or-ing with a random word
+ * moves it halfway towards one, and-ing halfway towards zero. Starting at the
+ * least significant bit of the fraction, eight random words yield 64 tiles.
+ */
+static void
+_randomize(struct _grid *grid, struct rng *rng, unsigned int fill)
+{
+	unsigned int p = (fill * 256 + 50) / 100;
+	size_t n = (size_t)grid->dimension.height * grid->words;
+
+	for (size_t i = 0; i < n; i++) {
+		if (p >= 256) {
+			grid->cells[i] = ~UINT64_C(0);
+			continue;
+		}
+
+		uint64_t w = 0;
+		for (unsigned int b = 0; b < 8; b++) {
+			uint64_t r = rng_next(rng);
+			r = (r << 32) | rng_next(rng);
+
+			w = (p & (1U << b)) ? (w | r) : (w & r);
+		}
+
+		grid->cells[i] = w;
+	}
+}
+
+static void
+_close_borders(struct _grid *grid)
+{
+	unsigned int width = grid->dimension.width;
+	unsigned int height = grid->dimension.height;
+
+	uint64_t padding = (width % 64) ? ~UINT64_C(0) << (width % 64) : 0;
+	uint64_t right = UINT64_C(1) << ((width - 1) % 64);
+
+	memset(_grid_row(grid, 0), 0xff, grid->words * sizeof(uint64_t));
+	memset(_grid_row(grid, height - 1), 0xff,
+	    grid->words * sizeof(uint64_t));
+
+	for (unsigned int y = 1; y < height - 1; y++) {
+		uint64_t *row = _grid_row(grid, y);
+
+		row[0] |= 1;
+		row[(width - 1) / 64] |= right;
+		row[grid->words - 1] |= padding;
+	}
+}
+
+static void
+_smooth(struct _grid *source, struct _grid *target)
+{
+	assert(source->dimension.height == target->dimension.height);
+	assert(source->words == target->words);
+
+	unsigned int words = source->words;
+
+	for (unsigned int y = 1; y < source->dimension.height - 1; y++) {
+		const uint64_t *rows[3] = { _grid_row(source, y - 1),
+			_grid_row(source, y), _grid_row(source, y + 1) };
+		uint64_t *t = _grid_row(target, y);
+
+		for (unsigned int w = 0; w < words; w++) {
+			/*
+			 * Sum the three horizontal neighbors of every row into
+			 * a two bit number (s + 2k).
+			 */
+			uint64_t s[3], k[3];
+			for (int r = 0; r < 3; r++) {
+				uint64_t c = rows[r][w];
+				uint64_t left = (c << 1) |
+				    (w > 0 ? rows[r][w - 1] >> 63 : 1);
+				uint64_t right = (c >> 1) |
+				    ((w + 1 < words ? rows[r][w + 1]
+						    : ~UINT64_C(0))
+					<< 63);
+
+				s[r] = left ^ c ^ right;
+				k[r] = (left & c) | (right & (left ^ c));
+			}
+
+			/*
+			 * Add up the rows: the total is
+			 * ones + 2 * twos + 4 * fours + 8 * eights.
+			 */
+			uint64_t ones = s[0] ^ s[1] ^ s[2];
+			uint64_t carry = (s[0] & s[1]) | (s[2] & (s[0] ^ s[1]));
+
+			uint64_t x = k[0] ^ k[1] ^ k[2];
+			uint64_t y4 = (k[0] & k[1]) | (k[2] & (k[0] ^ k[1]));
+
+			uint64_t twos = x ^ carry;
+			uint64_t z4 = x & carry;
+
+			uint64_t fours = y4 ^ z4;
+			uint64_t eights = y4 & z4;
+
+			t[w] = eights | (fours & (ones | twos));
+		}
+	}
+
+	_close_borders(target);
+}
+
+/*
+ * Returns the position of the next bit with the given value at or after
+ * _from, or the number of bits in the row if there is none.
+ */
+static unsigned int
+_next_bit(const uint64_t *row, unsigned int words, unsigned int from,
+    bool value)
+{
+	unsigned int w = from / 64;
+	if (w >= words)
+		return (words * 64);
+
+	uint64_t m = (value ? row[w] : ~row[w]) & (~UINT64_C(0) << (from % 64));
+	while (m == 0) {
+		if (++w == words)
+			return (words * 64);
+
+		m = value ? row[w] : ~row[w];
+	}
+
+	return (w * 64 + __builtin_ctzll(m));
+}
+
+/*
+ * Collects the floor runs of all rows. The runs of row y are found at the
+ * indices [_first[y], _first[y + 1]).
+ */
+static void
+_collect_runs(struct _grid *grid, struct _runs *runs, unsigned int first[])
+{
+	for (unsigned int y = 0; y < grid->dimension.height; y++) {
+		const uint64_t *row = _grid_row(grid, y);
+
+		first[y] = runs->elements;
+
+		unsigned int x = 0;
+		for (;;) {
+			unsigned int start =
+			    _next_bit(row, grid->words, x, false);
+			if (start >= grid->dimension.width)
+				break;
+
+			unsigned int end =
+			    _next_bit(row, grid->words, start, true);
+			_append_run(runs, y, start, end);
+
+			x = end;
+		}
+	}
+
+	first[grid->dimension.height] = runs->elements;
+}
+
+static void
+_append_run(
+    struct _runs *runs, unsigned int y, unsigned int start, unsigned int end)
+{
+	if (runs->elements == runs->capacity) {
+		runs->capacity = runs->capacity ? runs->capacity * 2
+						: RUNS_INITIAL_CAPACITY;
+
+		runs->runs =
+		    realloc(runs->runs, runs->capacity * sizeof(*runs->runs));
+		if (runs->runs == NULL)
+			err("realloc");
+
+		assert(runs->runs != NULL);
+	}
+
+	runs->runs[runs->elements] = (struct _run) { .y = y,
+		.start = start,
+		.end = end,
+		.parent = runs->elements,
+		.size = end - start };
+	runs->elements++;
+}
+
+static unsigned int
+_find(struct _run runs[], unsigned int run)
+{
+	while (runs[run].parent != run) {
+		runs[run].parent = runs[runs[run].parent].parent;
+		run = runs[run].parent;
+	}
+
+	return (run);
+}
+
+static void
+_union(struct _run runs[], unsigned int a, unsigned int b)
+{
+	a = _find(runs, a);
+	b = _find(runs, b);
+	if (a == b)
+		return;
+
+	if (runs[a].size < runs[b].size) {
+		unsigned int t = a;
+		a = b;
+		b = t;
+	}
+
+	runs[b].parent = a;
+	runs[a].size += runs[b].size;
+}
+
+/*
+ * Labels the caves by merging the floor runs of neighboring rows that share a
+ * column, and writes the largest cave into the level. Everything else becomes
+ * wall.
+ */
+static void
+_write_largest_cave(struct level *level, struct _grid *grid)
+{
+	struct coordinate_dimension d = grid->dimension;
+
+	struct _runs runs = { 0 };
+	unsigned int *first = calloc(d.height + 1, sizeof(*first));
+	if (first == NULL)
+		err("calloc");
+
+	assert(first != NULL);
+
+	_collect_runs(grid, &runs, first);
+
+	for (unsigned int y = 1; y < d.height; y++) {
+		unsigned int i = first[y - 1];
+		unsigned int j = first[y];
+
+		while (i < first[y] && j < first[y + 1]) {
+			struct _run *a = &runs.runs[i];
+			struct _run *b = &runs.runs[j];
+
+			if (a->start < b->end && b->start < a->end)
+				_union(runs.runs, i, j);
+
+			if (a->end < b->end)
+				i++;
+			else
+				j++;
+		}
+	}
+
+	unsigned int largest = 0;
+	unsigned long size = 0;
+	for (unsigned int i = 0; i < runs.elements; i++) {
+		if (runs.runs[i].parent == i && runs.runs[i].size > size) {
+			largest = i;
+			size = runs.runs[i].size;
+		}
+	}
+
+	for (unsigned int y = 0; y < d.height; y++) {
+		struct coordinate c = { y, 0 };
+		level_fill_span(level, c, d.width, TA_WALL);
+	}
+
+	for (unsigned int i = 0; i < runs.elements; i++) {
+		struct _run *r = &runs.runs[i];
+		if (_find(runs.runs, i) != largest)
+			continue;
+
+		struct coordinate c = { r->y, r->start };
+		level_fill_span(level, c, r->end - r->start, TA_FLOOR);
+	}
+
+	/*
+	 * The automaton may leave no floor at all on tiny levels or with a very
+	 * high fill. Keep the level playable with a single floor tile.
+	 */
+	if (runs.elements == 0) {
+		struct coordinate c = { d.height / 2, d.width / 2 };
+		level_fill_span(level, c, 1, TA_FLOOR);
+	}
+
+	free(first);
+	free(runs.runs);
+}
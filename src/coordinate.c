@@ -14,6 +14,9 @@
  */
 
 #include <stdbool.h>
+#include <stddef.h>
+
+#include <assert.h>
 
 #include <sine_nomine/coordinate.h>
 
@@ -62,3 +65,26 @@ coordinate_get_offset(struct coordinate a, struct coordinate b)
 	struct coordinate_offset off = { a.y - b.y, a.x - b.x };
 	return (off);
 }
+
+void
+coordinate_clip(unsigned int length, unsigned int window, int offset,
+    unsigned int *first, unsigned int *last)
+{
+	assert(first != NULL);
+	assert(last != NULL);
+
+	long begin = -(long)offset;
+	long end = (long)window - offset;
+
+	if (begin < 0)
+		begin = 0;
+	if (begin > (long)length)
+		begin = length;
+	if (end > (long)length)
+		end = length;
+	if (end < begin)
+		end = begin;
+
+	*first = begin;
+	*last = end;
+}
@@ -14,6 +14,7 @@
  */
 
 #include <stdbool.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 
 #include <assert.h>
@@ -21,18 +22,28 @@
 #include <sine_nomine/dijkstra.h>
 #include <sine_nomine/err.h>
 #include <sine_nomine/level.h>
+#include <sine_nomine/region.h>
 #include <sine_nomine/structs.h>
 
 struct dijkstra_map {
 	/*
-	 * The dijkstra map holds a pointer to the level. This might be a
-	 * problem, as the dijkstra map is a snapshot of a specific point in
-	 * time, but the level moves on. I am reluctant to create a snapshot of
-	 * the level for the dijkstra map, but it might be necessary once
-	 * things get more complex. Better to keep this in mind.
+	 * The dijkstra map holds a pointer to the level, but the level moves
+	 * on. Callers that keep a map around, or build it on another thread,
+	 * should pass a snapshot (see level_snapshot()) instead of the live
+	 * level.
 	 */
 	struct level *level;
 	dijkstra *values;
+
+	/* See dijkstra_restrict(), NULL if the map is not restricted. */
+	struct region_map *regions;
+	unsigned int region;
+
+	/* See dijkstra_limit(). */
+	dijkstra limit;
+
+	/* See dijkstra_cancel(), NULL if the flood cannot be cancelled. */
+	atomic_bool *cancelled;
 };
 
 struct _queue {
@@ -45,6 +56,8 @@ struct _queue {
 
 static struct dijkstra_map *_allocate_map(struct level *_level);
 
+static bool _reachable(struct dijkstra_map *_map, struct coordinate _position);
+
 static struct _queue *_queue_create(unsigned int _capacity);
 
 static void _queue_destroy(struct _queue *_queue);
@@ -57,7 +70,7 @@ static bool _queue_empty(struct _queue *_queue);
 
 static unsigned int _queue_increment(unsigned int _index, struct _queue *_queue);
 
-unsigned int _index(struct dijkstra_map *_map, struct coordinate _position);
+size_t _index(struct dijkstra_map *_map, struct coordinate _position);
 
 struct dijkstra_map *
 dijkstra_create(struct level *level)
@@ -66,13 +79,11 @@ dijkstra_create(struct level *level)
 
 	struct dijkstra_map *m = _allocate_map(level);
 	m->level = level;
+	m->limit = DIJKSTRA_MAX;
 
-	for (unsigned int y = 0; y < m->level->dimension.height; y++) {
-		for (unsigned int x = 0; x < m->level->dimension.width; x++) {
-			struct coordinate c = { y, x };
-			m->values[_index(m, c)] = DIJKSTRA_MAX;
-		}
-	}
+	size_t n = level_tile_index_count(m->level);
+	for (size_t i = 0; i < n; i++)
+		m->values[i] = DIJKSTRA_MAX;
 
 	return (m);
 }
@@ -86,6 +97,35 @@ dijkstra_destroy(struct dijkstra_map *map)
 	free(map);
 }
 
+void
+dijkstra_restrict(struct dijkstra_map *map, struct region_map *regions,
+    struct coordinate origin)
+{
+	assert(map != NULL);
+	assert(regions != NULL);
+	assert(coordinate_check_bounds(regions->level->dimension, origin));
+	assert(coordinate_check_bounds(map->level->dimension, origin));
+
+	map->region = region_get(regions, origin);
+	map->regions = map->region != 0 ? regions : NULL;
+}
+
+void
+dijkstra_limit(struct dijkstra_map *map, dijkstra limit)
+{
+	assert(map != NULL);
+
+	map->limit = limit;
+}
+
+void
+dijkstra_cancel(struct dijkstra_map *map, atomic_bool *cancelled)
+{
+	assert(map != NULL);
+
+	map->cancelled = cancelled;
+}
+
 void
 dijkstra_add_target(
     struct dijkstra_map *map, struct coordinate position, dijkstra value)
@@ -96,12 +136,23 @@ dijkstra_add_target(
 	if (map->values[_index(map, position)] <= value)
 		return;
 
+	if (!_reachable(map, position))
+		return;
+
 	struct _queue *q = _queue_create(10);
 	_enqueue(q, position);
 	map->values[_index(map, position)] = value;
 
+	unsigned int flooded = 0;
 	while (!_queue_empty(q)) {
+		if (map->cancelled != NULL &&
+		    ++flooded % DIJKSTRA_CANCEL_INTERVAL == 0 &&
+		    atomic_load(map->cancelled))
+			break;
+
 		struct coordinate c = _dequeue(q);
+		if (map->values[_index(map, c)] >= map->limit)
+			continue;
 
 		struct coordinate_offset off[4] = { { -1, 0 }, { 0, 1 },
 			{ 1, 0 }, { 0, -1 } };
@@ -117,7 +168,11 @@ dijkstra_add_target(
 			    map->values[_index(map, c)] + 1)
 				continue;
 
-			if (map->level->tiles[ct.y][ct.x].flags & TA_WALL)
+			if (level_get_flags(map->level, ct) & TA_WALL)
+				continue;
+
+			if (map->regions != NULL &&
+			    region_get(map->regions, ct) != map->region)
 				continue;
 
 			_enqueue(q, ct);
@@ -138,6 +193,38 @@ dijkstra_get_value(struct dijkstra_map *map, struct coordinate position)
 	return (map->values[_index(map, position)]);
 }
 
+/*
+ * A target is reachable if it lies in the region of the map, or if it is a wall
+ * next to the region (walls can be targets, e.g. unexplored ones).
+ */
+static bool
+_reachable(struct dijkstra_map *map, struct coordinate position)
+{
+	if (map->regions == NULL)
+		return (true);
+
+	if (region_get(map->regions, position) == map->region)
+		return (true);
+
+	if (!(level_get_flags(map->level, position) & TA_WALL))
+		return (false);
+
+	struct coordinate_offset off[4] = { { -1, 0 }, { 0, 1 }, { 1, 0 },
+		{ 0, -1 } };
+
+	for (int i = 0; i < 4; i++) {
+		if (!coordinate_check_bounds_offset(
+			map->level->dimension, position, off[i]))
+			continue;
+
+		struct coordinate c = coordinate_add_offset(position, off[i]);
+		if (region_get(map->regions, c) == map->region)
+			return (true);
+	}
+
+	return (false);
+}
+
 static struct dijkstra_map *
 _allocate_map(struct level *level)
 {
@@ -147,8 +234,11 @@ _allocate_map(struct level *level)
 
 	assert(m != NULL);
 
-	m->values = calloc(level->dimension.height * level->dimension.width,
-	    sizeof(*m->values));
+	m->values = calloc(level_tile_index_count(level), sizeof(*m->values));
+	if (m->values == NULL)
+		err("calloc");
+
+	assert(m->values != NULL);
 
 	return (m);
 }
@@ -242,8 +332,12 @@ _queue_increment(unsigned int index, struct _queue *queue)
 	return ((index + 1) % queue->capacity);
 }
 
-unsigned int
+/*
+ * The values follow the memory layout of the level, so that the flood fill
+ * touches neighboring values and tiles in the same cache lines.
+ */
+size_t
 _index(struct dijkstra_map *map, struct coordinate position)
 {
-	return (position.y * map->level->dimension.width + position.x);
+	return (level_tile_index(map->level, position));
 }
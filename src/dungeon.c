@@ -13,31 +13,68 @@
  * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 #include <assert.h>
+#include <string.h>
 
 #include <sine_nomine/coordinate.h>
 #include <sine_nomine/dungeon.h>
+#include <sine_nomine/err.h>
 #include <sine_nomine/level.h>
+#include <sine_nomine/rng.h>
 
-static void _carve_room(struct level *_level, struct coordinate *_anchor,
+enum { LOOP_INTERVAL = 8,
+};
+
+struct _area {
+	struct coordinate origin;
+	struct coordinate_dimension dimension;
+};
+
+struct _partition {
+	struct _area area;
+	unsigned int children[2];
+	struct coordinate anchor;
+};
+
+static void _carve_room(struct level *_level, struct rng *_rng,
+    struct coordinate *_anchor, struct _area _area,
     struct coordinate_dimension _room_min,
     struct coordinate_dimension _room_max);
 
-static void _connect_anchors(
-    struct level *_level, unsigned int _rooms, struct coordinate _anchors[]);
+static bool _split_partition(struct rng *_rng, struct _partition *_partition,
+    struct _area _halves[2], struct coordinate_dimension _room_min,
+    struct coordinate_dimension _room_max);
+
+struct _corridor {
+	unsigned int from;
+	unsigned int to;
+};
+
+static unsigned int _plan_corridors(unsigned int _rooms,
+    struct coordinate _anchors[], struct _corridor _corridors[]);
+
+static void _sort_by_curve(
+    unsigned int _rooms, struct coordinate _anchors[], unsigned int _order[]);
+
+static uint32_t _morton_key(struct coordinate _position);
+
+static void _carve_corridor(
+    struct level *_level, struct coordinate _start, struct coordinate _stop);
 
 /*
  * Applies a trivial dungeon generator to the level.
  *
  * 1. Carve out a number of rectangular room (they may overlap)
  * 2. Define a anchor in every room.
- * 3. Iterate the rooms and carve a floor from the anchor of the current room to
- *    the anchor of the next room.
+ * 3. Connect the anchors of rooms that are close to each other with L shaped
+ *    corridors (see _plan_corridors()).
  */
 void
-dungeon_generate(struct level *level, unsigned int rooms,
+dungeon_generate(struct level *level, struct rng *rng, unsigned int rooms,
     struct coordinate_dimension room_min, struct coordinate_dimension room_max)
 {
 	assert(rooms > 0);
@@ -47,41 +84,163 @@ dungeon_generate(struct level *level, unsigned int rooms,
 	assert(room_max.height <= level->dimension.height - 2 /*borders*/);
 
 	for (unsigned int y = 0; y < level->dimension.height; y++) {
-		for (unsigned int x = 0; x < level->dimension.width; x++)
-			level->tiles[y][x].flags = TA_WALL;
+		struct coordinate c = { y, 0 };
+		level_fill_span(level, c, level->dimension.width, TA_WALL);
 	}
 
-	struct coordinate anchors[rooms];
-	for (unsigned int i = 0; i < rooms; i++)
-		_carve_room(level, &anchors[i], room_min, room_max);
+	struct coordinate *anchors = calloc(rooms, sizeof(*anchors));
+	if (anchors == NULL)
+		err("calloc");
+
+	assert(anchors != NULL);
+
+	struct _area interior = { { 1, 1 },
+		{ level->dimension.height - 2, level->dimension.width - 2 } };
+
+	for (unsigned int i = 0; i < rooms; i++) {
+		_carve_room(
+		    level, rng, &anchors[i], interior, room_min, room_max);
+	}
+
+	struct _corridor *corridors =
+	    calloc(rooms + rooms / LOOP_INTERVAL, sizeof(*corridors));
+	if (corridors == NULL)
+		err("calloc");
+
+	assert(corridors != NULL);
 
-	for (unsigned int i = 0; i < rooms - 1; i++)
-		_connect_anchors(level, rooms, anchors);
+	unsigned int n = _plan_corridors(rooms, anchors, corridors);
+	for (unsigned int i = 0; i < n; i++) {
+		_carve_corridor(level, anchors[corridors[i].from],
+		    anchors[corridors[i].to]);
+	}
+
+	free(corridors);
+	free(anchors);
 }
 
-static void
-_carve_room(struct level *level, struct coordinate *anchor,
+/*
+ * Generates a dungeon by recursively splitting the level into disjoint
+ * partitions (binary space partitioning), placing a room into every leaf and
+ * connecting the two halves of every split with a corridor.
+ *
+ * A partition is split as long as it is too large for a single room and both
+ * halves can still hold a room of at least _room_min. Rooms keep a wall
+ * towards the neighboring partitions, so they never overlap or touch. The
+ * partitions are kept in a flat array, parents before children, so no
+ * recursion is needed and the work is linear in the number of rooms.
+ */
+void
+dungeon_generate_bsp(struct level *level, struct rng *rng,
     struct coordinate_dimension room_min, struct coordinate_dimension room_max)
+{
+	assert(room_min.height > 0);
+	assert(room_min.width > 0);
+	assert(room_min.height <= room_max.height);
+	assert(room_min.width <= room_max.width);
+	assert(room_min.width + 1 <= level->dimension.width - 2 /* borders */);
+	assert(room_min.height + 1 <= level->dimension.height - 2 /*borders*/);
+
+	for (unsigned int y = 0; y < level->dimension.height; y++) {
+		struct coordinate c = { y, 0 };
+		level_fill_span(level, c, level->dimension.width, TA_WALL);
+	}
+
+	unsigned int capacity = 64;
+	struct _partition *p = calloc(capacity, sizeof(*p));
+	if (p == NULL)
+		err("calloc");
+
+	assert(p != NULL);
+
+	/*
+	 * Every partition reserves its last row and column as a wall, so the
+	 * root covers the level without the top and left border.
+	 */
+	unsigned int n = 1;
+	p[0].area = (struct _area) { { 1, 1 },
+		{ level->dimension.height - 1, level->dimension.width - 1 } };
+
+	for (unsigned int i = 0; i < n; i++) {
+		struct _area halves[2];
+		if (!_split_partition(rng, &p[i], halves, room_min, room_max))
+			continue;
+
+		if (n + 2 > capacity) {
+			capacity *= 2;
+
+			p = realloc(p, capacity * sizeof(*p));
+			if (p == NULL)
+				err("realloc");
+
+			assert(p != NULL);
+		}
+
+		for (int h = 0; h < 2; h++) {
+			p[i].children[h] = n;
+			p[n++] = (struct _partition) { .area = halves[h] };
+		}
+	}
+
+	/* Children come after their parents, so walk backwards. */
+	for (unsigned int i = n; i-- > 0;) {
+		if (p[i].children[0] == 0) {
+			struct _area a = p[i].area;
+			a.dimension.height--;
+			a.dimension.width--;
+
+			struct coordinate_dimension max = room_max;
+			if (max.height > a.dimension.height)
+				max.height = a.dimension.height;
+			if (max.width > a.dimension.width)
+				max.width = a.dimension.width;
+
+			_carve_room(level, rng, &p[i].anchor, a, room_min, max);
+			continue;
+		}
+
+		struct coordinate a = p[p[i].children[0]].anchor;
+		struct coordinate b = p[p[i].children[1]].anchor;
+
+		_carve_corridor(level, a, b);
+		p[i].anchor = rng_uniform(rng, 2) ? a : b;
+	}
+
+	free(p);
+}
+
+/*
+ * Carves a random room of at least _room_min and at most _room_max into the
+ * area and picks a random anchor inside the room.
+ */
+static void
+_carve_room(struct level *level, struct rng *rng, struct coordinate *anchor,
+    struct _area area, struct coordinate_dimension room_min,
+    struct coordinate_dimension room_max)
 {
 	unsigned int height =
-	    (rand() % (room_max.height - room_min.height + 1)) +
+	    rng_uniform(rng, room_max.height - room_min.height + 1) +
 	    room_min.height;
 
 	unsigned int width =
-	    (rand() % (room_max.width - room_min.width + 1)) + room_min.width;
+	    rng_uniform(rng, room_max.width - room_min.width + 1) +
+	    room_min.width;
 
 	assert(height > 0);
 	assert(height >= room_min.height);
 	assert(height <= room_max.height);
-	assert(height <= level->dimension.height - 2 /* borders */);
+	assert(height <= area.dimension.height);
 
 	assert(width > 0);
 	assert(width >= room_min.width);
 	assert(width <= room_max.width);
-	assert(width <= level->dimension.width - 2 /* borders */);
+	assert(width <= area.dimension.width);
 
-	unsigned int oy = (rand() % (level->dimension.height - height - 1)) + 1;
-	unsigned int ox = (rand() % (level->dimension.width - width - 1)) + 1;
+	unsigned int oy =
+	    rng_uniform(rng, area.dimension.height - height + 1) +
+	    area.origin.y;
+	unsigned int ox =
+	    rng_uniform(rng, area.dimension.width - width + 1) + area.origin.x;
 
 	assert(oy > 0);
 	assert(oy < level->dimension.height - 1);
@@ -89,62 +248,204 @@ _carve_room(struct level *level, struct coordinate *anchor,
 	assert(ox > 0);
 	assert(ox < level->dimension.width - 1);
 
+	assert(ox + width < level->dimension.width);
+	assert(oy + height < level->dimension.height);
+
 	for (unsigned int y = 0; y < height; y++) {
-		for (unsigned int x = 0; x < width; x++) {
-			struct coordinate c = { oy + y, ox + x };
+		struct coordinate c = { oy + y, ox };
+		level_fill_span(level, c, width, TA_FLOOR);
+	}
 
-			level->tiles[c.y][c.x].flags = TA_FLOOR;
+	anchor->y = oy + rng_uniform(rng, height);
+	anchor->x = ox + rng_uniform(rng, width);
 
-			assert(c.x > 0);
-			assert(c.x < level->dimension.width - 1);
+	assert(level_get_flags(level, *anchor) & TA_FLOOR);
+}
 
-			assert(c.y > 0);
-			assert(c.y < level->dimension.height - 1);
-		}
+/*
+ * Splits the partition into two halves if it is too large for a room in one
+ * dimension and both halves can hold a room. Splits across the dimension that
+ * exceeds the maximum room size the most. Returns false for leaves.
+ */
+static bool
+_split_partition(struct rng *rng, struct _partition *partition,
+    struct _area halves[2], struct coordinate_dimension room_min,
+    struct coordinate_dimension room_max)
+{
+	struct coordinate_dimension d = partition->area.dimension;
+
+	/* Room size including the wall reserved by every partition. */
+	unsigned int min_h = room_min.height + 1;
+	unsigned int min_w = room_min.width + 1;
+
+	bool split_h = d.height > room_max.height + 1 && d.height >= 2 * min_h;
+	bool split_w = d.width > room_max.width + 1 && d.width >= 2 * min_w;
+
+	if (split_h && split_w) {
+		if (d.height * room_max.width > d.width * room_max.height)
+			split_w = false;
+		else
+			split_h = false;
+	}
+
+	halves[0] = halves[1] = partition->area;
+
+	if (split_h) {
+		unsigned int cut =
+		    min_h + rng_uniform(rng, d.height - 2 * min_h + 1);
+
+		halves[0].dimension.height = cut;
+		halves[1].origin.y += cut;
+		halves[1].dimension.height -= cut;
+
+		return (true);
+	}
+
+	if (split_w) {
+		unsigned int cut =
+		    min_w + rng_uniform(rng, d.width - 2 * min_w + 1);
+
+		halves[0].dimension.width = cut;
+		halves[1].origin.x += cut;
+		halves[1].dimension.width -= cut;
+
+		return (true);
 	}
 
-	anchor->y = oy + (rand() % height);
-	anchor->x = ox + (rand() % width);
+	return (false);
+}
+
+/*
+ * Builds the connection graph of the rooms and stores its edges in _corridors,
+ * which has to have room for _rooms + _rooms / LOOP_INTERVAL elements. Returns
+ * the number of edges.
+ *
+ * The rooms are ordered along a Z-order curve over their anchors and every
+ * room is connected to its successor. This is a spanning tree whose
+ * corridors are mostly short, built in linear time. Additionally every
+ * LOOP_INTERVAL-th room is connected to the room two steps ahead, which
+ * introduces a few loops.
+ */
+static unsigned int
+_plan_corridors(unsigned int rooms, struct coordinate anchors[],
+    struct _corridor corridors[])
+{
+	unsigned int *order = calloc(rooms, sizeof(*order));
+	if (order == NULL)
+		err("calloc");
+
+	assert(order != NULL);
 
-	assert(level->tiles[anchor->y][anchor->x].flags & TA_FLOOR);
+	_sort_by_curve(rooms, anchors, order);
+
+	unsigned int n = 0;
+	for (unsigned int i = 0; i + 1 < rooms; i++)
+		corridors[n++] = (struct _corridor) { order[i], order[i + 1] };
+
+	for (unsigned int i = 0; i + 2 < rooms; i += LOOP_INTERVAL)
+		corridors[n++] = (struct _corridor) { order[i], order[i + 2] };
+
+	assert(n <= rooms + rooms / LOOP_INTERVAL);
+
+	free(order);
+
+	return (n);
 }
 
+/*
+ * Stores the indices of the rooms in Z-order of their anchors in _order. This
+ * is a least significant digit radix sort, so it runs in linear time.
+ */
 static void
-_connect_anchors(
-    struct level *level, unsigned int rooms, struct coordinate anchors[])
+_sort_by_curve(
+    unsigned int rooms, struct coordinate anchors[], unsigned int order[])
 {
-	for (unsigned int i = 0; i < rooms - 1; i++) {
-		struct coordinate start = anchors[i];
-		struct coordinate stop = anchors[i + 1];
+	uint32_t *keys = calloc(rooms, sizeof(*keys));
+	unsigned int *sorted = calloc(rooms, sizeof(*sorted));
+	if (keys == NULL || sorted == NULL)
+		err("calloc");
 
-		unsigned int ay = start.y;
-		unsigned int by = stop.y;
+	assert(keys != NULL);
+	assert(sorted != NULL);
 
-		if (ay > by) {
-			ay = stop.y;
-			by = start.y;
-		}
+	for (unsigned int i = 0; i < rooms; i++) {
+		keys[i] = _morton_key(anchors[i]);
+		order[i] = i;
+	}
 
-		unsigned int ax = start.x;
-		unsigned int bx = stop.x;
+	for (unsigned int shift = 0; shift < 32; shift += 8) {
+		unsigned int offsets[257] = { 0 };
 
-		if (ax > bx) {
-			ax = stop.x;
-			bx = start.x;
-		}
+		for (unsigned int i = 0; i < rooms; i++)
+			offsets[((keys[order[i]] >> shift) & 0xff) + 1]++;
 
-		for (unsigned int x = ax; x <= bx; x++) {
-			level->tiles[start.y][x].flags = TA_FLOOR;
+		for (unsigned int d = 0; d < 256; d++)
+			offsets[d + 1] += offsets[d];
 
-			assert(x > 0);
-			assert(x < level->dimension.width - 1);
+		for (unsigned int i = 0; i < rooms; i++) {
+			unsigned int d = (keys[order[i]] >> shift) & 0xff;
+			sorted[offsets[d]++] = order[i];
 		}
 
-		for (unsigned int y = ay; y <= by; y++) {
-			level->tiles[y][stop.x].flags = TA_FLOOR;
+		memcpy(order, sorted, rooms * sizeof(*order));
+	}
 
-			assert(y > 0);
-			assert(y < level->dimension.height - 1);
-		}
+	free(sorted);
+	free(keys);
+}
+
+/*
+ * Interleaves the lower 16 bits of both coordinates. Larger levels still work,
+ * they just get a less local order.
+ */
+static uint32_t
+_morton_key(struct coordinate position)
+{
+	uint32_t key = 0;
+
+	for (unsigned int bit = 0; bit < 16; bit++) {
+		key |= ((position.x >> bit) & 1U) << (2 * bit);
+		key |= ((position.y >> bit) & 1U) << (2 * bit + 1);
+	}
+
+	return (key);
+}
+
+/*
+ * Carves an L shaped corridor: horizontally along the row of _start, then
+ * vertically along the column of _stop.
+ */
+static void
+_carve_corridor(
+    struct level *level, struct coordinate start, struct coordinate stop)
+{
+	unsigned int ay = start.y;
+	unsigned int by = stop.y;
+
+	if (ay > by) {
+		ay = stop.y;
+		by = start.y;
+	}
+
+	unsigned int ax = start.x;
+	unsigned int bx = stop.x;
+
+	if (ax > bx) {
+		ax = stop.x;
+		bx = start.x;
+	}
+
+	assert(ax > 0);
+	assert(bx < level->dimension.width - 1);
+
+	struct coordinate c = { start.y, ax };
+	level_fill_span(level, c, bx - ax + 1, TA_FLOOR);
+
+	for (unsigned int y = ay; y <= by; y++) {
+		c = (struct coordinate) { y, stop.x };
+		level_fill_span(level, c, 1, TA_FLOOR);
+
+		assert(y > 0);
+		assert(y < level->dimension.height - 1);
 	}
 }
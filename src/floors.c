@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <assert.h>
+
+#include <sine_nomine/coordinate.h>
+#include <sine_nomine/err.h>
+#include <sine_nomine/floors.h>
+#include <sine_nomine/game.h>
+#include <sine_nomine/level.h>
+#include <sine_nomine/pregen.h>
+#include <sine_nomine/region.h>
+#include <sine_nomine/rle.h>
+
+/* Visibility belongs to the floor the player is on. */
+enum { COMPRESSED_FLAGS = UINT8_MAX & ~TA_VISIBLE,
+};
+
+/*
+ * A floor is either active (level != NULL), compressed (compressed.data !=
+ * NULL) or not visited yet.
+ */
+struct floor {
+	struct pregen_level *level;
+	struct rle_buffer compressed;
+	struct coordinate spawn;
+	struct coordinate stairs;
+	unsigned long used;
+};
+
+struct floors {
+	struct game_configuration config;
+	struct pregen *pregen;
+	unsigned int next; /* the depth pregen delivers next */
+	unsigned int active;
+
+	unsigned int count;
+	struct floor *floors;
+	unsigned long clock;
+
+	struct floors_statistics statistics;
+};
+
+static struct floor *_floor(struct floors *_floors, unsigned int _depth);
+
+static void _activate(struct floors *_floors, struct floor *_floor,
+    struct pregen_level *_level);
+
+static void _compress(struct floors *_floors, struct floor *_floor);
+
+static struct pregen_level *_decompress(
+    struct floors *_floors, struct floor *_floor, unsigned int _depth);
+
+struct floors *
+floors_create(
+    struct game_configuration config, unsigned int active, unsigned int depth)
+{
+	assert(active > 0);
+
+	struct floors *f = calloc(1, sizeof(struct floors));
+	if (f == NULL)
+		err("calloc");
+
+	assert(f != NULL);
+
+	f->config = config;
+	f->pregen = pregen_create(config, depth);
+	f->next = depth;
+	f->active = active;
+
+	return (f);
+}
+
+void
+floors_destroy(struct floors *floors)
+{
+	assert(floors != NULL);
+
+	for (unsigned int i = 0; i < floors->count; i++) {
+		if (floors->floors[i].level != NULL)
+			pregen_release(floors->floors[i].level);
+
+		free(floors->floors[i].compressed.data);
+	}
+
+	pregen_destroy(floors->pregen);
+	free(floors->floors);
+	free(floors);
+}
+
+struct pregen_level *
+floors_get(struct floors *floors, unsigned int depth)
+{
+	assert(floors != NULL);
+	assert(depth <= floors->next);
+
+	struct floor *f = _floor(floors, depth);
+	f->used = ++floors->clock;
+
+	if (f->level != NULL)
+		return (f->level);
+
+	struct pregen_level *l;
+	if (f->compressed.data != NULL) {
+		l = _decompress(floors, f, depth);
+	} else if (depth == floors->next) {
+		l = pregen_take(floors->pregen);
+		floors->next++;
+		floors->statistics.generated++;
+	} else {
+		l = pregen_generate(floors->config, depth);
+		floors->statistics.generated++;
+	}
+
+	_activate(floors, f, l);
+
+	return (l);
+}
+
+void
+floors_add(struct floors *floors, struct pregen_level *level)
+{
+	assert(floors != NULL);
+	assert(level != NULL);
+
+	struct floor *f = _floor(floors, level->depth);
+	assert(f->level == NULL && f->compressed.data == NULL);
+
+	f->used = ++floors->clock;
+	_activate(floors, f, level);
+}
+
+struct floors_statistics
+floors_get_statistics(struct floors *floors)
+{
+	assert(floors != NULL);
+
+	return (floors->statistics);
+}
+
+static struct floor *
+_floor(struct floors *floors, unsigned int depth)
+{
+	if (depth >= floors->count) {
+		unsigned int count = floors->count ? floors->count : 8;
+		while (count <= depth)
+			count *= 2;
+
+		floors->floors =
+		    realloc(floors->floors, count * sizeof(struct floor));
+		if (floors->floors == NULL)
+			err("realloc");
+
+		assert(floors->floors != NULL);
+
+		memset(floors->floors + floors->count, 0,
+		    (count - floors->count) * sizeof(struct floor));
+		floors->count = count;
+	}
+
+	return (&floors->floors[depth]);
+}
+
+/*
+ * Makes the floor active and compresses the least recently used floors beyond
+ * the number of active floors.
+ */
+static void
+_activate(
+    struct floors *floors, struct floor *floor, struct pregen_level *level)
+{
+	floor->level = level;
+	floors->statistics.active++;
+
+	while (floors->statistics.active > floors->active) {
+		struct floor *lru = NULL;
+
+		for (unsigned int i = 0; i < floors->count; i++) {
+			struct floor *f = &floors->floors[i];
+			if (f->level == NULL || f == floor)
+				continue;
+
+			if (lru == NULL || f->used < lru->used)
+				lru = f;
+		}
+
+		assert(lru != NULL);
+		_compress(floors, lru);
+	}
+}
+
+static void
+_compress(struct floors *floors, struct floor *floor)
+{
+	struct pregen_level *l = floor->level;
+
+	floor->spawn = l->spawn;
+	floor->stairs = l->stairs;
+	rle_encode(&floor->compressed, l->level, COMPRESSED_FLAGS);
+
+	/* The buffer grows in steps, give back what was not used. */
+	struct rle_buffer *c = &floor->compressed;
+	uint8_t *data = realloc(c->data, c->size);
+	if (data != NULL) {
+		c->data = data;
+		c->capacity = c->size;
+	}
+
+	pregen_release(l);
+	floor->level = NULL;
+
+	floors->statistics.active--;
+	floors->statistics.compressed++;
+	floors->statistics.compressed_bytes += floor->compressed.size;
+}
+
+static struct pregen_level *
+_decompress(struct floors *floors, struct floor *floor, unsigned int depth)
+{
+	struct pregen_level *l = calloc(1, sizeof(struct pregen_level));
+	if (l == NULL)
+		err("calloc");
+
+	assert(l != NULL);
+
+	struct coordinate_dimension d = { floors->config.height,
+		floors->config.width };
+
+	l->depth = depth;
+	l->level = level_create(d);
+	l->spawn = floor->spawn;
+	l->stairs = floor->stairs;
+
+	size_t n = rle_decode(floor->compressed.data, floor->compressed.size,
+	    l->level, COMPRESSED_FLAGS);
+	assert(n == floor->compressed.size);
+
+	l->regions = region_create(l->level);
+
+	floors->statistics.compressed--;
+	floors->statistics.compressed_bytes -= floor->compressed.size;
+	floors->statistics.decompressed++;
+
+	free(floor->compressed.data);
+	floor->compressed = (struct rle_buffer) { NULL, 0, 0 };
+
+	return (l);
+}
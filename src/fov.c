@@ -13,24 +13,82 @@
  * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <stdbool.h>
 #include <stdlib.h>
 
+#include <assert.h>
 #include <math.h>
 
 #include <sine_nomine/bresenham.h>
+#include <sine_nomine/err.h>
 #include <sine_nomine/fov.h>
 #include <sine_nomine/game.h>
 #include <sine_nomine/level.h>
 #include <sine_nomine/structs.h>
 
+static void _clear_level(struct fov *_fov, struct player _player);
+
+static void _clear_box(struct fov *_fov, struct player _player);
+
+static bool _out_of_sight(
+    struct fov *_fov, struct player _player, struct coordinate _c);
+
+static bool _in_box(struct player _player, struct coordinate _c);
+
+static unsigned int _box_index(struct player _player, struct coordinate _c);
+
+struct fov *
+fov_create(struct level *level)
+{
+	assert(level != NULL);
+
+	struct fov *f = calloc(1, sizeof(struct fov));
+	if (f == NULL)
+		err("calloc");
+
+	assert(f != NULL);
+
+	f->level = level;
+
+	return (f);
+}
+
 void
-fov_calculate(struct player player, struct level *level)
+fov_destroy(struct fov *fov)
 {
-	for (unsigned int y = 0; y < level->dimension.height; y++) {
-		for (unsigned int x = 0; x < level->dimension.width; x++)
-			level->tiles[y][x].flags &= ~TA_VISIBLE;
+	assert(fov != NULL);
+
+	free(fov->visible);
+	free(fov);
+}
+
+/*
+ * The visible area is computed into the box around the player first, so that
+ * only tiles whose visibility actually changed are modified (and thus
+ * journaled) afterwards.
+ */
+void
+fov_calculate(struct fov *fov, struct player player)
+{
+	assert(fov != NULL);
+
+	struct level *level = fov->level;
+	unsigned int side = 2 * player.range + 1;
+
+	if (side * side > fov->capacity) {
+		free(fov->visible);
+		fov->capacity = side * side;
+		fov->visible = calloc(fov->capacity, sizeof(*fov->visible));
+		if (fov->visible == NULL)
+			err("calloc");
 	}
 
+	bool *visible = fov->visible;
+	assert(visible != NULL);
+
+	for (unsigned int i = 0; i < side * side; i++)
+		visible[i] = false;
+
 	for (int yoff = -player.range;
 	     yoff < 0 || (unsigned int)yoff <= player.range; yoff++) {
 
@@ -58,14 +116,102 @@ fov_calculate(struct player player, struct level *level)
 
 			for (unsigned int i = 0; i < l->elements; i++) {
 				struct coordinate v = l->points[i];
-				level->tiles[v.y][v.x].flags |=
-				    (TA_VISIBLE | TA_KNOWN);
+				visible[_box_index(player, v)] = true;
 
-				if (level->tiles[v.y][v.x].flags & TA_WALL)
+				if (level_get_flags(level, v) & TA_WALL)
 					break;
 			}
 
 			bresenham_free_line(l);
 		}
 	}
+
+	if (fov->valid)
+		_clear_box(fov, player);
+	else
+		_clear_level(fov, player);
+
+	for (unsigned int i = 0; i < side * side; i++) {
+		if (!visible[i])
+			continue;
+
+		struct coordinate c = { player.position.y + i / side -
+			    player.range,
+			player.position.x + i % side - player.range };
+		level_add_flags(level, c, TA_VISIBLE | TA_KNOWN);
+	}
+
+	fov->valid = true;
+	fov->position = player.position;
+	fov->range = player.range;
+}
+
+static void
+_clear_level(struct fov *fov, struct player player)
+{
+	struct level *level = fov->level;
+
+	for (unsigned int y = 0; y < level->dimension.height; y++) {
+		for (unsigned int x = 0; x < level->dimension.width; x++) {
+			struct coordinate c = { y, x };
+			if (_out_of_sight(fov, player, c))
+				level_remove_flags(level, c, TA_VISIBLE);
+		}
+	}
+}
+
+/*
+ * Like _clear_level(), but only looks at the box of the last call, clipped to
+ * the level.
+ */
+static void
+_clear_box(struct fov *fov, struct player player)
+{
+	struct coordinate_dimension d = fov->level->dimension;
+	struct coordinate p = fov->position;
+	unsigned int r = fov->range;
+
+	unsigned int top = p.y > r ? p.y - r : 0;
+	unsigned int left = p.x > r ? p.x - r : 0;
+	unsigned int bottom = p.y + r < d.height ? p.y + r + 1 : d.height;
+	unsigned int right = p.x + r < d.width ? p.x + r + 1 : d.width;
+
+	for (unsigned int y = top; y < bottom; y++) {
+		for (unsigned int x = left; x < right; x++) {
+			struct coordinate c = { y, x };
+			if (_out_of_sight(fov, player, c))
+				level_remove_flags(fov->level, c, TA_VISIBLE);
+		}
+	}
+}
+
+/*
+ * Returns true if _c is marked visible but is not visible from the player
+ * anymore.
+ */
+static bool
+_out_of_sight(struct fov *fov, struct player player, struct coordinate c)
+{
+	if (!(level_get_flags(fov->level, c) & TA_VISIBLE))
+		return (false);
+
+	return (!_in_box(player, c) || !fov->visible[_box_index(player, c)]);
+}
+
+static bool
+_in_box(struct player player, struct coordinate c)
+{
+	return (c.y + player.range >= player.position.y &&
+	    c.y <= player.position.y + player.range &&
+	    c.x + player.range >= player.position.x &&
+	    c.x <= player.position.x + player.range);
+}
+
+static unsigned int
+_box_index(struct player player, struct coordinate c)
+{
+	unsigned int side = 2 * player.range + 1;
+
+	return ((c.y + player.range - player.position.y) * side +
+	    (c.x + player.range - player.position.x));
 }
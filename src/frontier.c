@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <assert.h>
+
+#include <sine_nomine/coordinate.h>
+#include <sine_nomine/err.h>
+#include <sine_nomine/frontier.h>
+#include <sine_nomine/level.h>
+#include <sine_nomine/tileset.h>
+
+static void _rebuild(struct frontier *_frontier);
+
+static void _evaluate(struct frontier *_frontier, struct coordinate _position);
+
+static void _evaluate_around(
+    struct frontier *_frontier, struct coordinate _position);
+
+static bool _is_edge(struct level *_level, struct coordinate _position);
+
+static bool _is_known_torch(unsigned int _flags);
+
+static bool _is_known_passable(unsigned int _flags);
+
+struct frontier *
+frontier_create(struct level *level)
+{
+	assert(level != NULL);
+
+	struct frontier *f = calloc(1, sizeof(struct frontier));
+	if (f == NULL)
+		err("calloc");
+
+	assert(f != NULL);
+
+	f->level = level;
+	f->edge = tileset_create(level->dimension);
+	f->torches = tileset_create(level->dimension);
+
+	_rebuild(f);
+
+	return (f);
+}
+
+void
+frontier_destroy(struct frontier *frontier)
+{
+	assert(frontier != NULL);
+
+	tileset_destroy(frontier->torches);
+	tileset_destroy(frontier->edge);
+	free(frontier);
+}
+
+void
+frontier_update(struct frontier *frontier)
+{
+	assert(frontier != NULL);
+
+	if (frontier->generation == frontier->level->generation)
+		return;
+
+	unsigned int n;
+	const struct level_change *c =
+	    level_journal_since(frontier->level, frontier->generation, &n);
+	if (c == NULL) {
+		_rebuild(frontier);
+		return;
+	}
+
+	/* Visibility changes dominate the journal, skip them early. */
+	unsigned int relevant = TA_FLOOR | TA_WALL | TA_KNOWN | TA_TORCH;
+
+	for (unsigned int i = 0; i < n; i++) {
+		if (((c[i].old_flags ^ c[i].new_flags) & relevant) == 0)
+			continue;
+
+		_evaluate_around(frontier, c[i].position);
+	}
+
+	frontier->generation = frontier->level->generation;
+}
+
+static void
+_rebuild(struct frontier *frontier)
+{
+	struct level *l = frontier->level;
+
+	tileset_clear(frontier->edge);
+	tileset_clear(frontier->torches);
+
+	for (unsigned int y = 0; y < l->dimension.height; y++) {
+		for (unsigned int x = 0; x < l->dimension.width; x++) {
+			struct coordinate c = { y, x };
+			_evaluate(frontier, c);
+		}
+	}
+
+	frontier->generation = l->generation;
+}
+
+/*
+ * A change of a tile affects its own membership and the edge membership of its
+ * neighbors.
+ */
+static void
+_evaluate_around(struct frontier *frontier, struct coordinate position)
+{
+	_evaluate(frontier, position);
+
+	struct coordinate_offset off[4] = { { -1, 0 }, { 0, 1 }, { 1, 0 },
+		{ 0, -1 } };
+
+	for (int i = 0; i < 4; i++) {
+		if (!coordinate_check_bounds_offset(
+			frontier->level->dimension, position, off[i]))
+			continue;
+
+		_evaluate(frontier, coordinate_add_offset(position, off[i]));
+	}
+}
+
+static void
+_evaluate(struct frontier *frontier, struct coordinate position)
+{
+	unsigned int flags = level_get_flags(frontier->level, position);
+
+	if (_is_edge(frontier->level, position))
+		tileset_add(frontier->edge, position);
+	else
+		tileset_remove(frontier->edge, position);
+
+	if (_is_known_torch(flags))
+		tileset_add(frontier->torches, position);
+	else
+		tileset_remove(frontier->torches, position);
+}
+
+static bool
+_is_edge(struct level *level, struct coordinate position)
+{
+	if (level_get_flags(level, position) & TA_KNOWN)
+		return (false);
+
+	struct coordinate_offset off[4] = { { -1, 0 }, { 0, 1 }, { 1, 0 },
+		{ 0, -1 } };
+
+	for (int i = 0; i < 4; i++) {
+		if (!coordinate_check_bounds_offset(
+			level->dimension, position, off[i]))
+			continue;
+
+		struct coordinate c = coordinate_add_offset(position, off[i]);
+		if (_is_known_passable(level_get_flags(level, c)))
+			return (true);
+	}
+
+	return (false);
+}
+
+static bool
+_is_known_torch(unsigned int flags)
+{
+	unsigned int mask = TA_FLOOR | TA_KNOWN | TA_TORCH;
+
+	return ((flags & mask) == mask);
+}
+
+static bool
+_is_known_passable(unsigned int flags)
+{
+	return ((flags & TA_KNOWN) && !(flags & TA_WALL));
+}
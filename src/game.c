@@ -13,75 +13,265 @@
  * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdbool.h>
 #include <stdlib.h>
 
+#include <assert.h>
+#include <limits.h>
+#include <time.h>
+
+#include <sine_nomine/actors.h>
+#include <sine_nomine/autoexplore.h>
 #include <sine_nomine/dijkstra.h>
-#include <sine_nomine/dungeon.h>
+#include <sine_nomine/err.h>
+#include <sine_nomine/floors.h>
 #include <sine_nomine/fov.h>
+#include <sine_nomine/frontier.h>
 #include <sine_nomine/game.h>
+#include <sine_nomine/goalcache.h>
+#include <sine_nomine/jobs.h>
+#include <sine_nomine/pregen.h>
+#include <sine_nomine/region.h>
+#include <sine_nomine/replay.h>
+#include <sine_nomine/rng.h>
+#include <sine_nomine/save.h>
+#include <sine_nomine/scheduler.h>
 #include <sine_nomine/structs.h>
 #include <sine_nomine/ui.h>
+#include <sine_nomine/world.h>
 
 enum { autoexplore_delay = 100,
+	active_floors = 3,
+	player_actor = 0,
+	player_speed = SCHEDULER_NORMAL_SPEED,
+	monster_density = 100,
+	monster_range = 6,
+	monster_speed_min = SCHEDULER_NORMAL_SPEED / 2,
+	monster_speed_max = SCHEDULER_NORMAL_SPEED * 3 / 2,
+	goal_maps = 4,
+	hunt_limit = 4 * monster_range,
+	decide_grain = 256,
+	input_burst = 8,
+	window_chunks = 3,
+	world_radius = 2,
+};
+
+/*
+ * The steps a monster would like to take, best first. Zero steps are left
+ * out.
+ */
+struct monster_plan {
+	struct coordinate_offset steps[2];
+};
+
+/*
+ * The field of view last calculated. Nothing needs to be calculated or drawn
+ * as long as the player stays where it is, sees as far as before, and the
+ * level did not change. drawn tells if the screen shows the view, and skipped
+ * counts the views not drawn in a row.
+ */
+struct view {
+	bool valid;
+	struct coordinate position;
+	unsigned int range;
+	unsigned long generation;
+	bool drawn;
+	unsigned int skipped;
+};
+
+struct decide_context {
+	struct game *game;
+	unsigned long generation;
+	unsigned int round;
 };
 
 struct game {
+	struct game_configuration config;
+	struct floors *floors;
+	struct world *world;
+	struct world_position origin; /* of the level in the world */
+	unsigned long entry_stalls;
+	struct pregen_level *current;
 	struct level *level;
+	struct region_map *regions;
+	struct frontier *frontier;
+	struct autoexplore *planner;
+	struct fov *fov;
+	struct actors *monsters;
+	struct goal_cache *goals;
+	struct jobs *jobs;
+	struct monster_plan *plans;
+	unsigned int plans_capacity;
 	struct player player;
+	struct view view;
+	struct scheduler *scheduler;
 	struct ui_context *ui;
+	struct recording *recording;
+	struct replay *replay;
+	const char *save;
+	struct saver *saver;
 	bool autoexplore;
+	double step_due; /* when autoexplore takes its next step */
+	struct rng gameplay;
+
+	bool headless;
+	unsigned long turns;
+	bool explored;
+	struct dijkstra_map *stairs;
+	struct game_statistics statistics;
 };
 
+static void _enter_level(struct game *_game, unsigned int _depth);
+
+static void _leave_level(struct game *_game);
+
+static void _set_level(struct game *_game, struct pregen_level *_level);
+
+static void _enter_world(struct game *_game);
+
+static void _follow_player(struct game *_game);
+
+static void _move_window(struct game *_game, struct world_position _origin);
+
+static void _carry_known(
+    struct level *_from, struct level *_to, struct coordinate_offset _shift);
+
+static struct actors *_carry_monsters(struct game *_game, struct level *_to,
+    struct coordinate_offset _shift);
+
+static struct coordinate _find_flags(
+    struct level *_level, unsigned int _flags, struct coordinate _fallback);
+
+static void _save(struct game *_game);
+
+static void _render(struct game *_game);
+
 static bool _validate_player_position(
     struct coordinate _candidate, struct level *_level);
 
 static void _apply_effects(struct game *_game);
 
+static bool _is_monster(struct game *_game, struct coordinate _position);
+
+static void _displace_monster(struct game *_game, struct coordinate _position);
+
+static void _populate(struct game *_game, unsigned int _avoid);
+
+static void _wait_for_player(struct game *_game);
+
+static void _monsters_act(struct game *_game);
+
+static void _decide(void *_context, unsigned int _begin, unsigned int _end);
+
+static struct monster_plan _monster_plan(
+    struct game *_game, unsigned int _index, unsigned long _generation);
+
+static void _hunt_steps(struct dijkstra_map *_map, struct level *_level,
+    struct coordinate _position, struct coordinate_offset *_steps);
+
+static bool _monster_can_enter(
+    struct game *_game, struct coordinate _position);
+
+static UI_ACTION _input(struct game *_game);
+
+static void _start_autoexplore(struct game *_game);
+
 static UI_ACTION _autoexplore(struct game *_game);
 
+static void _lap_frontier(struct game *_game, double _seconds, double _waited);
+
+static UI_ACTION _bot(struct game *_game);
+
+static struct dijkstra_map *_stairs_map(struct game *_game);
+
+static bool _downhill(struct game *_game, struct dijkstra_map *_map,
+    struct coordinate_offset *_step);
+
+static UI_ACTION _step_action(struct coordinate_offset _step);
+
+static double _now(void);
+
+static double _lap(
+    struct game *_game, GAME_SUBSYSTEM _subsystem, double _since);
+
 struct game *
 game_create(struct game_configuration config)
 {
-	sranddev();
-
 	struct game *g = calloc(1, sizeof(struct game));
-	g->ui = ui_create();
 
-	struct coordinate_dimension d = { config.height, config.width };
-	struct coordinate_dimension min = { config.roomsize.min,
-		config.roomsize.min };
-	struct coordinate_dimension max = { config.roomsize.max,
-		config.roomsize.max };
+	struct save save = { .config = config };
+	bool resume = config.save != NULL && save_read(config.save, &save);
+	if (resume)
+		config = save.config;
 
-	g->player = (struct player) { .range = config.range };
-	g->level = level_create(d);
-	dungeon_generate(g->level, config.rooms, min, max);
+	if (config.replay != NULL) {
+		g->replay = replay_create(config.replay, &config);
+		config.headless = true;
+		config.script = NULL;
+	}
+	if (config.record != NULL)
+		g->recording = recording_create(config.record, config);
 
-	g->autoexplore = false;
+	if (config.headless)
+		g->ui = ui_create_headless(config.script);
+	else
+		g->ui = ui_create();
 
-	unsigned int torches =
-	    rand() % (config.torches.max - config.torches.min + 1) +
-	    config.torches.min;
-	level_modify_random_floor_tiles(g->level, torches, TA_TORCH);
+	g->config = config;
+	g->headless = config.headless;
+	g->turns = config.turns;
+	g->save = config.save;
+	if (config.save != NULL)
+		g->saver = saver_create();
 
 	/*
-	 * Place player somewhere on the floor. The starting position should be
-	 * determined by the dungeon generation algorithm. This in not yet
-	 * implemented.
+	 * Gameplay draws from its own stream, levels are generated from the
+	 * generation stream (see pregen.c).
 	 */
-	for (;;) {
-		unsigned int y = rand() % (g->level->dimension.height);
-		unsigned int x = rand() % (g->level->dimension.width);
+	rng_seed(&g->gameplay, config.seed, RNG_STREAM_GAMEPLAY);
 
-		if (g->level->tiles[y][x].flags & TA_FLOOR) {
-			g->player.position.y = y;
-			g->player.position.x = x;
+	g->player = (struct player) { .range = config.range };
+	g->scheduler = scheduler_create();
+	g->jobs = jobs_create(config.jobs);
 
-			break;
-		}
+	if (config.generator == DG_WORLD) {
+		_enter_world(g);
+
+		return (g);
 	}
 
+	if (!resume) {
+		g->floors = floors_create(config, active_floors, 0);
+		_enter_level(g, 0);
+		g->player.position = g->current->spawn;
+
+		return (g);
+	}
+
+	g->gameplay = save.gameplay;
+	g->player = save.player;
+	g->floors = floors_create(config, active_floors, save.depth + 1);
+
+	struct pregen_level *l = calloc(1, sizeof(struct pregen_level));
+	if (l == NULL)
+		err("calloc");
+
+	assert(l != NULL);
+
+	l->depth = save.depth;
+	l->level = save.level;
+	l->regions = region_create(save.level);
+	l->spawn = _find_flags(save.level, TA_UPSTAIRS, save.player.position);
+	l->stairs = _find_flags(save.level, TA_STAIRS, save.player.position);
+	floors_add(g->floors, l);
+	_set_level(g, l);
+	_populate(g, 0);
+
+	if (save.autoexplore)
+		_start_autoexplore(g);
+
 	return (g);
 }
 
@@ -89,53 +279,125 @@ void
 game_destroy(struct game *game)
 {
 	ui_destroy(game->ui);
-	level_destroy(game->level);
+	if (game->saver != NULL)
+		saver_destroy(game->saver);
+	if (game->recording != NULL)
+		recording_destroy(game->recording, game->statistics.turns);
+	if (game->replay != NULL)
+		replay_destroy(game->replay);
+	struct pregen_level *window = game->current;
+	_leave_level(game);
+	if (game->world != NULL) {
+		pregen_release(window);
+		world_destroy(game->world);
+	} else {
+		floors_destroy(game->floors);
+	}
+	scheduler_destroy(game->scheduler);
+	jobs_destroy(game->jobs);
+	free(game->plans);
 	free(game);
 }
 
 void
 game_loop(struct game *game)
 {
+	double start = _now();
+
 	bool running = true;
 	while (running) {
-		fov_calculate(game->player, game->level);
-		ui_display(game->ui, game->player, game->level);
+		double t = _now();
+
+		/* Consumers of the journal catch up before it is cleared. */
+		region_update(game->regions);
+		t = _lap(game, GS_REGIONS, t);
+		frontier_update(game->frontier);
+		t = _lap(game, GS_FRONTIER, t);
+		autoexplore_observe(game->planner, game->player.position);
+		t = _lap(game, GS_AUTOEXPLORE, t);
+		level_journal_clear(game->level);
+
+		_render(game);
 
 		struct coordinate np = game->player.position;
+		bool acted = false;
 
 		UI_ACTION ua;
-		if (game->autoexplore)
+		if (game->autoexplore) {
 			ua = _autoexplore(game);
-		else
-			ua = ui_get_action(game->ui);
+		} else {
+			t = _now();
+			ua = _input(game);
+			t = _lap(game, GS_UI, t);
+
+			if (game->headless && ua == UA_TIMEOUT) {
+				ua = _bot(game);
+				_lap(game, GS_BOT, t);
+			}
+		}
 
 		/* Get user input and act on it. */
 		switch (ua) {
 		case UA_UP:
 			np.y--;
+			acted = true;
 			break;
 
 		case UA_DOWN:
 			np.y++;
+			acted = true;
 			break;
 
 		case UA_LEFT:
 			np.x--;
+			acted = true;
 			break;
 
 		case UA_RIGHT:
 			np.x++;
+			acted = true;
+			break;
+
+		case UA_DESCEND:
+			if (level_get_flags(game->level, np) & TA_STAIRS) {
+				t = _now();
+				_enter_level(game, game->current->depth + 1);
+				_lap(game, GS_LEVELS, t);
+
+				game->statistics.levels++;
+				np = game->current->spawn;
+				game->player.position = np;
+				acted = true;
+				_save(game);
+			}
+			break;
+
+		case UA_ASCEND:
+			if (level_get_flags(game->level, np) & TA_UPSTAIRS) {
+				t = _now();
+				_enter_level(game, game->current->depth - 1);
+				_lap(game, GS_LEVELS, t);
+
+				game->statistics.levels++;
+				np = game->current->stairs;
+				game->player.position = np;
+				acted = true;
+				_save(game);
+			}
 			break;
 
 		case UA_AUTOEXPLORE:
-			ui_timeout(game->ui, autoexplore_delay);
-			game->autoexplore = true;
+			_start_autoexplore(game);
 			break;
 
 		case UA_QUIT:
 			running = false;
 			break;
 
+		case UA_RESIZE:
+			game->view.valid = false;
+			break;
+
 		case UA_TIMEOUT:
 		case UA_UNKNOWN:
 			break;
@@ -143,9 +405,397 @@ game_loop(struct game *game)
 
 		if (_validate_player_position(np, game->level))
 			game->player.position = np;
+		else if (_is_monster(game, np))
+			_displace_monster(game, np);
+		else
+			acted = false;
 
 		_apply_effects(game);
+
+		if (game->world != NULL) {
+			t = _now();
+			_follow_player(game);
+			_lap(game, GS_LEVELS, t);
+		}
+
+		/*
+		 * Only actions that take time end the player's turn, the
+		 * monsters act until it is the player's turn again.
+		 */
+		if (acted) {
+			t = _now();
+			scheduler_add(game->scheduler, player_actor,
+			    scheduler_delay(player_speed));
+			_wait_for_player(game);
+			_monsters_act(game);
+			_lap(game, GS_ACTORS, t);
+		}
+
+		game->statistics.turns++;
+		if (game->turns != 0 && game->statistics.turns >= game->turns)
+			running = false;
+	}
+
+	_save(game);
+
+	game->statistics.seconds += _now() - start;
+}
+
+struct game_statistics
+game_get_statistics(struct game *game)
+{
+	struct game_statistics s = game->statistics;
+	s.seed = game->config.seed;
+
+	if (game->goals != NULL) {
+		struct goal_cache_statistics g =
+		    goal_cache_get_statistics(game->goals);
+		s.goal_hits += g.hits;
+		s.goal_misses += g.misses;
+	}
+
+	if (game->world != NULL) {
+		struct world_statistics w = world_get_statistics(game->world);
+		s.chunks = w.generated;
+		s.stalls = w.stalls - game->entry_stalls;
+	}
+
+	return (s);
+}
+
+const struct actors *
+game_get_monsters(struct game *game)
+{
+	return (game->monsters);
+}
+
+/*
+ * Replaces the current level by the one at _depth. A level not visited before
+ * usually has been generated in the background already. The player is placed
+ * by the caller.
+ */
+static void
+_enter_level(struct game *game, unsigned int depth)
+{
+	_leave_level(game);
+	_set_level(game, floors_get(game->floors, depth));
+	_populate(game, 0);
+}
+
+/*
+ * Drops everything that refers to the current level. The level itself stays
+ * with the floors.
+ */
+static void
+_leave_level(struct game *game)
+{
+	if (game->current == NULL)
+		return;
+
+	/* The monsters stay behind, they are not kept with the floor. */
+	struct actors *m = game->monsters;
+	for (unsigned int i = 0; i < m->count; i++)
+		scheduler_remove(game->scheduler, m->slots[i] + 1);
+	actors_destroy(m);
+
+	struct goal_cache_statistics g = goal_cache_get_statistics(game->goals);
+	game->statistics.goal_hits += g.hits;
+	game->statistics.goal_misses += g.misses;
+	goal_cache_destroy(game->goals);
+	game->goals = NULL;
+
+	autoexplore_destroy(game->planner);
+	fov_destroy(game->fov);
+	frontier_destroy(game->frontier);
+	game->current = NULL;
+
+	if (game->stairs != NULL) {
+		dijkstra_destroy(game->stairs);
+		game->stairs = NULL;
+	}
+}
+
+static void
+_set_level(struct game *game, struct pregen_level *level)
+{
+	game->explored = false;
+	game->view.valid = false;
+
+	game->current = level;
+	game->level = level->level;
+	game->regions = level->regions;
+	game->frontier = frontier_create(game->level);
+	game->planner = autoexplore_create(
+	    game->level, game->regions, game->frontier);
+	game->fov = fov_create(game->level);
+	game->monsters = actors_create(game->level);
+	game->goals = goal_cache_create(game->level, goal_maps, hunt_limit);
+}
+
+/*
+ * On the world the game is played on a window of window_chunks x window_chunks
+ * chunks, with the player in the middle chunk. Once the player steps into
+ * another chunk the window moves along by a chunk. The chunks the window moves
+ * onto have been generated in the background while the player approached.
+ */
+static void
+_enter_world(struct game *game)
+{
+	game->world = world_create(game->config.seed, world_radius);
+
+	struct world_position origin = { -WORLD_CHUNK_SIZE,
+		-WORLD_CHUNK_SIZE };
+	world_update(game->world, (struct world_position) { 0, 0 });
+
+	/* The player starts on the floor tile nearest to the middle. */
+	unsigned int middle = window_chunks * WORLD_CHUNK_SIZE / 2;
+	struct level *l = world_window(game->world, origin,
+	    (struct coordinate_dimension) { middle * 2, middle * 2 });
+
+	unsigned int best = UINT_MAX;
+	for (unsigned int y = 0; y < l->dimension.height; y++) {
+		for (unsigned int x = 0; x < l->dimension.width; x++) {
+			struct coordinate c = { y, x };
+			unsigned int d = abs((int)y - (int)middle) +
+			    abs((int)x - (int)middle);
+
+			if ((level_get_flags(l, c) & TA_FLOOR) && d < best) {
+				best = d;
+				game->player.position = c;
+			}
+		}
+	}
+	level_destroy(l);
+
+	_move_window(game, origin);
+
+	/* Nothing is ready yet when the game starts. */
+	game->entry_stalls = world_get_statistics(game->world).stalls;
+}
+
+/*
+ * Prefetches the chunks around the player and moves the window once the player
+ * left the middle chunk.
+ */
+static void
+_follow_player(struct game *game)
+{
+	struct coordinate p = game->player.position;
+	struct world_position w = { game->origin.y + p.y,
+		game->origin.x + p.x };
+	world_update(game->world, w);
+
+	int dy = (int)(p.y / WORLD_CHUNK_SIZE) - window_chunks / 2;
+	int dx = (int)(p.x / WORLD_CHUNK_SIZE) - window_chunks / 2;
+	if (dy == 0 && dx == 0)
+		return;
+
+	struct world_position origin = {
+		game->origin.y + (int64_t)dy * WORLD_CHUNK_SIZE,
+		game->origin.x + (int64_t)dx * WORLD_CHUNK_SIZE,
+	};
+	_move_window(game, origin);
+}
+
+/*
+ * Replaces the level by the window at _origin. The monsters and what the
+ * player knows move along as far as they are still inside the window; tiles
+ * that left it are forgotten, the world cannot store anything. The window is
+ * filled up with new monsters on tiles the player does not know.
+ */
+static void
+_move_window(struct game *game, struct world_position origin)
+{
+	unsigned int side = window_chunks * WORLD_CHUNK_SIZE;
+	struct level *l = world_window(
+	    game->world, origin, (struct coordinate_dimension) { side, side });
+
+	struct coordinate_offset shift = { game->origin.y - origin.y,
+		game->origin.x - origin.x };
+
+	struct actors *monsters = NULL;
+	struct pregen_level *old = game->current;
+	if (old != NULL) {
+		_carry_known(game->level, l, shift);
+		monsters = _carry_monsters(game, l, shift);
+		game->player.position =
+		    coordinate_add_offset(game->player.position, shift);
+
+		_leave_level(game);
+		pregen_release(old);
+	}
+
+	struct pregen_level *p = calloc(1, sizeof(struct pregen_level));
+	if (p == NULL)
+		err("calloc");
+
+	assert(p != NULL);
+
+	p->level = l;
+	p->regions = region_create(l);
+	p->spawn = game->player.position;
+	p->stairs = game->player.position;
+
+	game->origin = origin;
+	_set_level(game, p);
+
+	if (monsters != NULL) {
+		actors_destroy(game->monsters);
+		game->monsters = monsters;
+
+		for (unsigned int i = 0; i < monsters->count; i++) {
+			unsigned int speed = monsters->speeds[i];
+			scheduler_add(game->scheduler, monsters->slots[i] + 1,
+			    rng_uniform(
+				&game->gameplay, scheduler_delay(speed)));
+		}
+	}
+
+	_populate(game, TA_KNOWN);
+}
+
+static void
+_carry_known(
+    struct level *from, struct level *to, struct coordinate_offset shift)
+{
+	struct coordinate_dimension d = to->dimension;
+	assert(from->dimension.height == d.height);
+	assert(from->dimension.width == d.width);
+
+	unsigned int *old = calloc(d.width, sizeof(*old));
+	unsigned int *row = calloc(d.width, sizeof(*row));
+	if (old == NULL || row == NULL)
+		err("calloc");
+
+	assert(old != NULL);
+	assert(row != NULL);
+
+	for (unsigned int y = 0; y < d.height; y++) {
+		long ny = (long)y + shift.y;
+		if (ny < 0 || ny >= (long)d.height)
+			continue;
+
+		level_get_row(from, y, old);
+		level_get_row(to, ny, row);
+
+		for (unsigned int x = 0; x < d.width; x++) {
+			long nx = (long)x + shift.x;
+			if (nx >= 0 && nx < (long)d.width)
+				row[nx] |= old[x] & TA_KNOWN;
+		}
+
+		level_set_row(to, ny, row);
+	}
+
+	free(row);
+	free(old);
+}
+
+/*
+ * Returns the monsters of the current level that are inside _to after moving
+ * by _shift, placed on _to.
+ */
+static struct actors *
+_carry_monsters(
+    struct game *game, struct level *to, struct coordinate_offset shift)
+{
+	struct actors *from = game->monsters;
+	struct actors *a = actors_create(to);
+
+	for (unsigned int i = 0; i < from->count; i++) {
+		if (!coordinate_check_bounds_offset(
+			to->dimension, from->positions[i], shift))
+			continue;
+
+		struct coordinate c =
+		    coordinate_add_offset(from->positions[i], shift);
+		struct actor_handle h = actors_add(
+		    a, c, from->ranges[i], from->speeds[i], 0);
+
+		unsigned int j = actors_get_index(a, h);
+		a->states[j] = from->states[i];
+		a->rngs[j] = from->rngs[i];
+	}
+
+	return (a);
+}
+
+static struct coordinate
+_find_flags(
+    struct level *level, unsigned int flags, struct coordinate fallback)
+{
+	for (unsigned int y = 0; y < level->dimension.height; y++) {
+		for (unsigned int x = 0; x < level->dimension.width; x++) {
+			struct coordinate p = { y, x };
+			if ((level_get_flags(level, p) & flags) == flags)
+				return (p);
+		}
+	}
+
+	return (fallback);
+}
+
+static void
+_save(struct game *game)
+{
+	if (game->save == NULL)
+		return;
+
+	double t = _now();
+
+	struct save save = {
+		.config = game->config,
+		.depth = game->current->depth,
+		.player = game->player,
+		.gameplay = game->gameplay,
+		.autoexplore = game->autoexplore,
+		.level = game->level,
+	};
+	saver_write(game->saver, game->save, &save);
+
+	_lap(game, GS_SAVE, t);
+}
+
+/*
+ * Updates the field of view and redraws the screen, unless the view is still
+ * current. While keys are queued up, they are acted on first and the screen is
+ * only redrawn once they are used up, or after input_burst views in a row were
+ * not drawn. The field of view is updated after every action all the same: the
+ * game must not play differently depending on how fast keys come in.
+ */
+static void
+_render(struct game *game)
+{
+	struct view *v = &game->view;
+	struct player p = game->player;
+
+	double t = _now();
+	if (!v->valid || v->position.y != p.position.y ||
+	    v->position.x != p.position.x || v->range != p.range ||
+	    v->generation != game->level->generation) {
+		fov_calculate(game->fov, p);
+		t = _lap(game, GS_FOV, t);
+
+		/* The view includes the changes of the field of view. */
+		*v = (struct view) { true, p.position, p.range,
+			game->level->generation, false, v->skipped };
+	}
+
+	if (v->drawn)
+		return;
+
+	if (v->skipped < input_burst && ui_input_pending(game->ui)) {
+		v->skipped++;
+		_lap(game, GS_UI, t);
+		return;
 	}
+
+	ui_display(game->ui, p, game->level);
+	_lap(game, GS_UI, t);
+
+	v->drawn = true;
+	v->skipped = 0;
+	game->statistics.frames++;
 }
 
 static bool
@@ -154,7 +804,7 @@ _validate_player_position(struct coordinate candidate, struct level *level)
 	if (!coordinate_check_bounds(level->dimension, candidate))
 		return false;
 
-	if (level->tiles[candidate.y][candidate.x].flags & TA_WALL)
+	if (level_get_flags(level, candidate) & (TA_WALL | TA_OCCUPIED))
 		return false;
 
 	return true;
@@ -163,100 +813,478 @@ _validate_player_position(struct coordinate candidate, struct level *level)
 static void
 _apply_effects(struct game *game)
 {
-	struct level_tile **tiles = game->level->tiles;
 	struct player player = game->player;
 
-	if (tiles[player.position.y][player.position.x].flags & TA_TORCH) {
-		tiles[player.position.y][player.position.x].flags &= ~TA_TORCH;
+	if (level_get_flags(game->level, player.position) & TA_TORCH) {
+		level_remove_flags(game->level, player.position, TA_TORCH);
 		player.range++;
 	}
 
 	game->player = player;
 }
 
-static UI_ACTION
-_autoexplore(struct game *game)
+static bool
+_is_monster(struct game *game, struct coordinate position)
 {
-	struct dijkstra_map *dm = dijkstra_create(game->level);
+	if (!coordinate_check_bounds(game->level->dimension, position))
+		return (false);
 
-	/*
-	 * Set all unvisited floor tiles as low priority targets.
-	 */
-	unsigned int targets = 0;
-	for (unsigned int y = 0; y < game->level->dimension.height; y++) {
-		for (unsigned int x = 0; x < game->level->dimension.height;
-		     x++) {
-			if (game->level->tiles[y][x].flags & TA_KNOWN)
+	return (level_get_flags(game->level, position) & TA_OCCUPIED);
+}
+
+/*
+ * Without a way to fight, a monster in the way would block a corridor for
+ * good: the player trades places with it instead.
+ */
+static void
+_displace_monster(struct game *game, struct coordinate position)
+{
+	struct actors *m = game->monsters;
+
+	for (unsigned int i = 0; i < m->count; i++) {
+		if (m->positions[i].y != position.y ||
+		    m->positions[i].x != position.x)
+			continue;
+
+		actors_move(m, i, game->player.position);
+		game->player.position = position;
+
+		return;
+	}
+}
+
+/*
+ * Places monsters of random speed on random floor tiles of a level just
+ * entered, until there is one per monster_density tiles. Stairs, the tile the
+ * player arrives at and tiles with any of the _avoid flags are kept free.
+ */
+static void
+_populate(struct game *game, unsigned int avoid)
+{
+	struct level *l = game->level;
+	struct coordinate_dimension d = l->dimension;
+	unsigned int n = d.height * d.width / monster_density;
+	unsigned int blocked =
+	    TA_WALL | TA_OCCUPIED | TA_STAIRS | TA_UPSTAIRS | avoid;
+
+	n -= n < game->monsters->count ? n : game->monsters->count;
+
+	for (unsigned int tries = 0; tries < 4 * n && n > 0; tries++) {
+		struct coordinate c = { rng_uniform(&game->gameplay, d.height),
+			rng_uniform(&game->gameplay, d.width) };
+
+		unsigned int flags = level_get_flags(l, c);
+		if (!(flags & TA_FLOOR) || (flags & blocked))
+			continue;
+
+		if ((c.y == game->current->spawn.y &&
+			c.x == game->current->spawn.x) ||
+		    (c.y == game->player.position.y &&
+			c.x == game->player.position.x))
+			continue;
+
+		unsigned int speed = monster_speed_min +
+		    rng_uniform(&game->gameplay,
+			monster_speed_max - monster_speed_min + 1);
+		struct actor_handle h = actors_add(game->monsters, c,
+		    monster_range, speed, rng_next(&game->gameplay));
+
+		/* Spread the first actions over one action. */
+		scheduler_add(game->scheduler, h.slot + 1,
+		    rng_uniform(&game->gameplay, scheduler_delay(speed)));
+
+		n--;
+	}
+}
+
+/*
+ * Takes the actors due before the player's next turn from the scheduler. Each
+ * monster taken is scheduled again right away, and its actions are counted;
+ * they are carried out by _monsters_act(). The scheduler knows the player as
+ * player_actor and a monster by its slot plus one.
+ */
+static void
+_wait_for_player(struct game *game)
+{
+	struct actors *m = game->monsters;
+
+	unsigned int actor;
+	while (scheduler_next(game->scheduler, &actor)) {
+		if (actor == player_actor)
+			return;
+
+		unsigned int i = m->table[actor - 1].index;
+		m->actions[i]++;
+		scheduler_add(
+		    game->scheduler, actor, scheduler_delay(m->speeds[i]));
+	}
+}
+
+/*
+ * Monsters act in rounds, the first action due of every monster in the first
+ * round and so on. Every round the monsters decide in parallel, looking at the
+ * level as it was before the round; the moves are then carried out in the
+ * order the monsters are stored. A move into a tile taken in the meantime
+ * falls back to the second best step, or the monster stays. The result does
+ * not depend on the number of threads.
+ *
+ * Hunters plan with the level as it was before the first monster moved, so
+ * that they share their maps (moving monsters do not change the way).
+ */
+static void
+_monsters_act(struct game *game)
+{
+	struct actors *m = game->monsters;
+
+	unsigned int rounds = 0;
+	for (unsigned int i = 0; i < m->count; i++)
+		rounds = m->actions[i] > rounds ? m->actions[i] : rounds;
+
+	if (m->count > game->plans_capacity) {
+		game->plans_capacity = m->capacity;
+		game->plans = realloc(game->plans,
+		    game->plans_capacity * sizeof(*game->plans));
+		if (game->plans == NULL)
+			err("realloc");
+
+		assert(game->plans != NULL);
+	}
+
+	struct decide_context context = { game, game->level->generation, 0 };
+
+	for (context.round = 1; context.round <= rounds; context.round++) {
+		jobs_run(game->jobs, _decide, &context, m->count, decide_grain);
+
+		for (unsigned int i = 0; i < m->count; i++) {
+			if (m->actions[i] < context.round)
 				continue;
 
-			struct coordinate c = { y, x };
-			dijkstra_add_target(dm, c, 20);
-			targets++;
+			for (int j = 0; j < 2; j++) {
+				struct coordinate_offset o =
+				    game->plans[i].steps[j];
+				if (o.y == 0 && o.x == 0)
+					continue;
+
+				struct coordinate c =
+				    coordinate_add_offset(m->positions[i], o);
+				if (_monster_can_enter(game, c)) {
+					actors_move(m, i, c);
+					break;
+				}
+			}
 		}
 	}
 
-	/*
-	 * Set known torches as high priority targets.
-	 */
-	for (unsigned int y = 0; y < game->level->dimension.height; y++) {
-		for (unsigned int x = 0; x < game->level->dimension.height;
-		     x++) {
-			if (!(game->level->tiles[y][x].flags & TA_FLOOR))
-				continue;
+	for (unsigned int i = 0; i < m->count; i++)
+		m->actions[i] = 0;
+}
 
-			if (!(game->level->tiles[y][x].flags & TA_KNOWN))
-				continue;
+/*
+ * Plans the monsters [_begin, _end) that act in the current round. Runs on any
+ * thread: it reads the level and the player, and writes nothing but the plans
+ * and the state of its own monsters.
+ */
+static void
+_decide(void *context, unsigned int begin, unsigned int end)
+{
+	struct decide_context *c = context;
+	struct game *game = c->game;
+	struct actors *m = game->monsters;
 
-			if (!(game->level->tiles[y][x].flags & TA_TORCH))
-				continue;
+	for (unsigned int i = begin; i < end; i++) {
+		if (m->actions[i] < c->round) {
+			game->plans[i] = (struct monster_plan) { 0 };
+			continue;
+		}
 
-			struct coordinate c = { y, x };
-			dijkstra_add_target(dm, c, 0);
-			targets++;
+		game->plans[i] = _monster_plan(game, i, c->generation);
+	}
+}
+
+/*
+ * A monster sees the player if the player sees the monster and the player is
+ * in its range; it hunts the player then, along the map all hunters share.
+ * Otherwise it wanders around, drawing from its own generator.
+ */
+static struct monster_plan
+_monster_plan(struct game *game, unsigned int index, unsigned long generation)
+{
+	struct actors *m = game->monsters;
+	struct coordinate p = m->positions[index];
+	struct coordinate_offset d =
+	    coordinate_get_offset(game->player.position, p);
+
+	unsigned int dy = abs(d.y);
+	unsigned int dx = abs(d.x);
+	unsigned int distance = dy > dx ? dy : dx;
+
+	bool sees = (level_get_flags(game->level, p) & TA_VISIBLE) &&
+	    distance <= m->ranges[index];
+	m->states[index] = sees ? AS_HUNT : AS_WANDER;
+
+	struct monster_plan plan = { 0 };
+	if (sees) {
+		struct dijkstra_map *map = goal_cache_acquire(
+		    game->goals, &game->player.position, 1, generation);
+		_hunt_steps(map, game->level, p, plan.steps);
+		goal_cache_release(game->goals, map);
+	} else {
+		struct coordinate_offset off[4] = { { -1, 0 }, { 0, 1 },
+			{ 1, 0 }, { 0, -1 } };
+
+		plan.steps[0] = off[rng_uniform(&m->rngs[index], 4)];
+	}
+
+	for (int i = 0; i < 2; i++) {
+		if (!coordinate_check_bounds_offset(
+			game->level->dimension, p, plan.steps[i]))
+			plan.steps[i] = (struct coordinate_offset) { 0, 0 };
+	}
+
+	return (plan);
+}
+
+/*
+ * Stores the two best steps down the map from _position, zero steps if there
+ * are less.
+ */
+static void
+_hunt_steps(struct dijkstra_map *map, struct level *level,
+    struct coordinate position, struct coordinate_offset *steps)
+{
+	dijkstra here = dijkstra_get_value(map, position);
+	dijkstra best[2] = { here, here };
+
+	struct coordinate_offset off[4] = { { -1, 0 }, { 0, 1 }, { 1, 0 },
+		{ 0, -1 } };
+
+	for (int i = 0; i < 4; i++) {
+		if (!coordinate_check_bounds_offset(
+			level->dimension, position, off[i]))
+			continue;
+
+		dijkstra v = dijkstra_get_value(
+		    map, coordinate_add_offset(position, off[i]));
+
+		if (v < best[0]) {
+			best[1] = best[0];
+			steps[1] = steps[0];
+			best[0] = v;
+			steps[0] = off[i];
+		} else if (v < best[1]) {
+			best[1] = v;
+			steps[1] = off[i];
 		}
 	}
+}
 
-	struct coordinate p = game->player.position;
+static bool
+_monster_can_enter(struct game *game, struct coordinate position)
+{
+	if (position.y == game->player.position.y &&
+	    position.x == game->player.position.x)
+		return (false);
 
-	if (dijkstra_get_value(dm, p) == DIJKSTRA_MAX ||
-	    ui_get_action(game->ui) != UA_TIMEOUT) {
+	unsigned int flags = level_get_flags(game->level, position);
+
+	return ((flags & TA_FLOOR) && !(flags & (TA_WALL | TA_OCCUPIED)));
+}
+
+/*
+ * Reads the next action from the ui, or from the replay, and records it.
+ */
+static UI_ACTION
+_input(struct game *game)
+{
+	UI_ACTION ua;
+	if (game->replay != NULL)
+		ua = replay_next(game->replay);
+	else
+		ua = ui_get_action(game->ui);
+
+	if (game->recording != NULL)
+		recording_add(game->recording, ua);
+
+	return (ua);
+}
+
+static void
+_start_autoexplore(struct game *game)
+{
+	game->autoexplore = true;
+	game->step_due = _now() + autoexplore_delay / 1000.0;
+}
+
+/*
+ * The next step is planned while waiting for a key that interrupts
+ * autoexplore, so the steps are autoexplore_delay apart unless planning takes
+ * longer than that. Exactly one action is read per step, replays take the
+ * same steps.
+ */
+static UI_ACTION
+_autoexplore(struct game *game)
+{
+	autoexplore_start(game->planner, game->player.position);
+
+	double start = _now();
+	double wait = game->step_due - start;
+	ui_timeout(game->ui, wait > 0 ? wait * 1000 + 0.5 : 0);
+
+	bool interrupted = _input(game) != UA_TIMEOUT;
+	double t = _lap(game, GS_UI, start);
+	double waited = t - start;
+	double frontier;
+
+	if (interrupted) {
+		autoexplore_cancel(game->planner, &frontier);
+		_lap(game, GS_AUTOEXPLORE, t);
+		_lap_frontier(game, frontier, waited);
+		game->autoexplore = false;
+		ui_timeout(game->ui, -1);
+		return UA_UNKNOWN;
+	}
+
+	struct coordinate_offset step = { 0, 0 };
+	bool more = autoexplore_finish(game->planner, &step, &frontier);
+	t = _lap(game, GS_AUTOEXPLORE, t);
+	_lap_frontier(game, frontier, waited);
+
+	if (!more) {
+		game->explored = true;
 		game->autoexplore = false;
 		ui_timeout(game->ui, -1);
 		return UA_UNKNOWN;
 	}
 
-	dijkstra min_dijkstra = DIJKSTRA_MAX;
-	struct coordinate_offset min_offset = { 0, 0 };
+	game->step_due += autoexplore_delay / 1000.0;
+	if (game->step_due < t)
+		game->step_due = t;
+
+	return (_step_action(step));
+}
+
+/*
+ * The worker updates the frontier first thing, for _seconds while the game
+ * waited _waited seconds for input and then for the plan. That time is moved
+ * from the waits to GS_FRONTIER, the subsystems still add up to the wall clock.
+ */
+static void
+_lap_frontier(struct game *game, double seconds, double waited)
+{
+	double *s = game->statistics.subsystems;
+	double during_input = seconds < waited ? seconds : waited;
+
+	s[GS_UI] -= during_input;
+	s[GS_AUTOEXPLORE] -= seconds - during_input;
+	s[GS_FRONTIER] += seconds;
+}
+
+/*
+ * Input of a headless game once its script is used up: explore the level, walk
+ * to the stairs and descend. Quits if the stairs cannot be reached.
+ */
+static UI_ACTION
+_bot(struct game *game)
+{
+	if (!game->explored)
+		return (UA_AUTOEXPLORE);
+
+	if (level_get_flags(game->level, game->player.position) & TA_STAIRS)
+		return (UA_DESCEND);
+
+	if (game->stairs == NULL)
+		game->stairs = _stairs_map(game);
+
+	struct coordinate_offset step;
+	if (!_downhill(game, game->stairs, &step))
+		return (UA_QUIT);
+
+	return (_step_action(step));
+}
+
+static struct dijkstra_map *
+_stairs_map(struct game *game)
+{
+	struct dijkstra_map *dm = dijkstra_create(game->level);
+	dijkstra_restrict(dm, game->regions, game->player.position);
+
+	struct coordinate_dimension d = game->level->dimension;
+	for (unsigned int y = 0; y < d.height; y++) {
+		for (unsigned int x = 0; x < d.width; x++) {
+			struct coordinate c = { y, x };
+			unsigned int flags = level_get_flags(game->level, c);
+
+			if ((flags & TA_KNOWN) && (flags & TA_STAIRS))
+				dijkstra_add_target(dm, c, 0);
+		}
+	}
+
+	return (dm);
+}
 
+/*
+ * Finds the step to the neighbor of the player with the lowest value. Returns
+ * false if no neighbor has a value.
+ */
+static bool
+_downhill(struct game *game, struct dijkstra_map *map,
+    struct coordinate_offset *step)
+{
 	struct coordinate_offset off[] = { { -1, 0 }, { 0, 1 }, { 1, 0 },
 		{ 0, -1 } };
+	struct coordinate p = game->player.position;
+
+	dijkstra min = DIJKSTRA_MAX;
 	for (int i = 0; i < 4; i++) {
 		if (!coordinate_check_bounds_offset(
-			game->level->dimension, game->player.position, off[i]))
+			game->level->dimension, p, off[i]))
 			continue;
 
-		struct coordinate c =
-		    coordinate_add_offset(game->player.position, off[i]);
-
-		if (dijkstra_get_value(dm, c) < min_dijkstra) {
-			min_dijkstra = dijkstra_get_value(dm, c);
-			min_offset = off[i];
+		struct coordinate c = coordinate_add_offset(p, off[i]);
+		if (dijkstra_get_value(map, c) < min) {
+			min = dijkstra_get_value(map, c);
+			*step = off[i];
 		}
 	}
 
-	dijkstra_destroy(dm);
+	return (min != DIJKSTRA_MAX);
+}
 
-	if (min_offset.y == -1)
+static UI_ACTION
+_step_action(struct coordinate_offset step)
+{
+	if (step.y == -1)
 		return UA_UP;
 
-	if (min_offset.y == 1)
+	if (step.y == 1)
 		return UA_DOWN;
 
-	if (min_offset.x == -1)
+	if (step.x == -1)
 		return UA_LEFT;
 
-	if (min_offset.x == 1)
+	if (step.x == 1)
 		return UA_RIGHT;
 
 	return UA_UNKNOWN;
 }
+
+static double
+_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+/*
+ * Adds the time since _since to the subsystem and returns the current time.
+ */
+static double
+_lap(struct game *game, GAME_SUBSYSTEM subsystem, double since)
+{
+	double now = _now();
+	game->statistics.subsystems[subsystem] += now - since;
+
+	return (now);
+}
@@ -0,0 +1,330 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <assert.h>
+#include <pthread.h>
+
+#include <sine_nomine/coordinate.h>
+#include <sine_nomine/dijkstra.h>
+#include <sine_nomine/err.h>
+#include <sine_nomine/goalcache.h>
+#include <sine_nomine/level.h>
+
+enum { ENTRIES_INITIAL_CAPACITY = 8,
+};
+
+/*
+ * The goals of an entry are sorted, see _compare(). An entry without a map is
+ * being built, it is referenced by its builder until _built is signalled.
+ */
+struct entry {
+	struct coordinate *goals;
+	unsigned int count;
+	unsigned long generation;
+	struct dijkstra_map *map;
+	pthread_cond_t built;
+	unsigned int references;
+	unsigned long used;
+};
+
+struct goal_cache {
+	pthread_mutex_t lock;
+	struct level *level;
+	unsigned int capacity;
+	dijkstra limit;
+
+	/* Entries are allocated one by one, builders keep pointers to them. */
+	struct entry **entries;
+	unsigned int count;
+	unsigned int allocated;
+
+	/* Advances with every acquisition, for the LRU order. */
+	unsigned long clock;
+
+	struct goal_cache_statistics statistics;
+};
+
+static struct entry *_find(struct goal_cache *_cache,
+    const struct coordinate *_goals, unsigned int _count,
+    unsigned long _generation);
+
+static struct entry *_insert(struct goal_cache *_cache,
+    const struct coordinate *_goals, unsigned int _count,
+    unsigned long _generation);
+
+static void _build(struct goal_cache *_cache, struct entry *_entry);
+
+static void _evict(struct goal_cache *_cache);
+
+static void _destroy(struct entry *_entry);
+
+static int _compare(const void *_a, const void *_b);
+
+struct goal_cache *
+goal_cache_create(struct level *level, unsigned int capacity, dijkstra limit)
+{
+	assert(level != NULL);
+
+	struct goal_cache *c = calloc(1, sizeof(struct goal_cache));
+	if (c == NULL)
+		err("calloc");
+
+	assert(c != NULL);
+
+	if (pthread_mutex_init(&c->lock, NULL) != 0)
+		err("pthread_mutex_init");
+
+	c->level = level;
+	c->capacity = capacity;
+	c->limit = limit;
+
+	return (c);
+}
+
+void
+goal_cache_destroy(struct goal_cache *cache)
+{
+	assert(cache != NULL);
+
+	for (unsigned int i = 0; i < cache->count; i++) {
+		assert(cache->entries[i]->references == 0);
+
+		_destroy(cache->entries[i]);
+	}
+
+	pthread_mutex_destroy(&cache->lock);
+	free(cache->entries);
+	free(cache);
+}
+
+struct dijkstra_map *
+goal_cache_acquire(struct goal_cache *cache, const struct coordinate *goals,
+    unsigned int count, unsigned long generation)
+{
+	assert(cache != NULL);
+	assert(goals != NULL || count == 0);
+
+	pthread_mutex_lock(&cache->lock);
+
+	struct entry *e = _find(cache, goals, count, generation);
+	if (e != NULL) {
+		cache->statistics.hits++;
+		e->references++;
+		e->used = ++cache->clock;
+
+		while (e->map == NULL)
+			pthread_cond_wait(&e->built, &cache->lock);
+	} else {
+		cache->statistics.misses++;
+		e = _insert(cache, goals, count, generation);
+		e->references++;
+		e->used = ++cache->clock;
+
+		_build(cache, e);
+	}
+
+	struct dijkstra_map *map = e->map;
+
+	_evict(cache);
+
+	pthread_mutex_unlock(&cache->lock);
+
+	return (map);
+}
+
+void
+goal_cache_release(struct goal_cache *cache, struct dijkstra_map *map)
+{
+	assert(cache != NULL);
+	assert(map != NULL);
+
+	pthread_mutex_lock(&cache->lock);
+
+	bool found = false;
+	for (unsigned int i = 0; i < cache->count && !found; i++) {
+		struct entry *e = cache->entries[i];
+		if (e->map != map)
+			continue;
+
+		assert(e->references > 0);
+		e->references--;
+		found = true;
+	}
+
+	assert(found);
+	_evict(cache);
+
+	pthread_mutex_unlock(&cache->lock);
+}
+
+struct goal_cache_statistics
+goal_cache_get_statistics(struct goal_cache *cache)
+{
+	assert(cache != NULL);
+
+	pthread_mutex_lock(&cache->lock);
+	struct goal_cache_statistics s = cache->statistics;
+	pthread_mutex_unlock(&cache->lock);
+
+	return (s);
+}
+
+/*
+ * The cache is meant to hold a handful of maps, a linear search is all it
+ * takes. _goals does not need to be sorted.
+ */
+static struct entry *
+_find(struct goal_cache *cache, const struct coordinate *goals,
+    unsigned int count, unsigned long generation)
+{
+	for (unsigned int i = 0; i < cache->count; i++) {
+		struct entry *e = cache->entries[i];
+		if (e->generation != generation || e->count != count)
+			continue;
+
+		bool same = true;
+		for (unsigned int j = 0; j < count && same; j++) {
+			same = bsearch(&goals[j], e->goals, e->count,
+				   sizeof(*e->goals), _compare) != NULL;
+		}
+
+		if (same)
+			return (e);
+	}
+
+	return (NULL);
+}
+
+static struct entry *
+_insert(struct goal_cache *cache, const struct coordinate *goals,
+    unsigned int count, unsigned long generation)
+{
+	struct goal_cache *c = cache;
+
+	if (c->count == c->allocated) {
+		c->allocated = c->allocated ? c->allocated * 2
+					    : ENTRIES_INITIAL_CAPACITY;
+
+		c->entries =
+		    realloc(c->entries, c->allocated * sizeof(*c->entries));
+		if (c->entries == NULL)
+			err("realloc");
+
+		assert(c->entries != NULL);
+	}
+
+	struct entry *e = calloc(1, sizeof(struct entry));
+	if (e == NULL)
+		err("calloc");
+
+	assert(e != NULL);
+
+	e->count = count;
+	e->generation = generation;
+	if (pthread_cond_init(&e->built, NULL) != 0)
+		err("pthread_cond_init");
+
+	e->goals = calloc(count > 0 ? count : 1, sizeof(*e->goals));
+	if (e->goals == NULL)
+		err("calloc");
+
+	assert(e->goals != NULL);
+
+	memcpy(e->goals, goals, count * sizeof(*e->goals));
+	qsort(e->goals, count, sizeof(*e->goals), _compare);
+
+	c->entries[c->count++] = e;
+
+	return (e);
+}
+
+/*
+ * Called and returns with the cache locked, but floods the map without the
+ * lock held. The entry is referenced, so it is neither evicted nor moved.
+ */
+static void
+_build(struct goal_cache *cache, struct entry *entry)
+{
+	pthread_mutex_unlock(&cache->lock);
+
+	struct dijkstra_map *m = dijkstra_create(cache->level);
+	dijkstra_limit(m, cache->limit);
+	for (unsigned int i = 0; i < entry->count; i++)
+		dijkstra_add_target(m, entry->goals[i], 0);
+
+	pthread_mutex_lock(&cache->lock);
+
+	entry->map = m;
+	pthread_cond_broadcast(&entry->built);
+}
+
+/*
+ * Destroys the least recently used unreferenced maps until the cache is back
+ * to its capacity, or only referenced maps are left.
+ */
+static void
+_evict(struct goal_cache *cache)
+{
+	struct goal_cache *c = cache;
+
+	while (c->count > c->capacity) {
+		unsigned int oldest = c->count;
+		for (unsigned int i = 0; i < c->count; i++) {
+			struct entry *e = c->entries[i];
+			if (e->references > 0)
+				continue;
+
+			if (oldest == c->count ||
+			    e->used < c->entries[oldest]->used)
+				oldest = i;
+		}
+
+		if (oldest == c->count)
+			return;
+
+		_destroy(c->entries[oldest]);
+		c->entries[oldest] = c->entries[--c->count];
+		c->statistics.evictions++;
+	}
+}
+
+static void
+_destroy(struct entry *entry)
+{
+	dijkstra_destroy(entry->map);
+	pthread_cond_destroy(&entry->built);
+	free(entry->goals);
+	free(entry);
+}
+
+static int
+_compare(const void *a, const void *b)
+{
+	const struct coordinate *ca = a;
+	const struct coordinate *cb = b;
+
+	if (ca->y != cb->y)
+		return (ca->y < cb->y ? -1 : 1);
+	if (ca->x != cb->x)
+		return (ca->x < cb->x ? -1 : 1);
+
+	return (0);
+}
@@ -0,0 +1,305 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <sine_nomine/err.h>
+#include <sine_nomine/jobs.h>
+
+struct chunk {
+	unsigned int begin;
+	unsigned int end;
+};
+
+/*
+ * The chunks of one thread. The owner takes chunks from the tail, thieves from
+ * the head.
+ */
+struct deque {
+	pthread_mutex_t lock;
+	struct chunk *chunks;
+	unsigned int capacity;
+	unsigned int head;
+	unsigned int tail;
+};
+
+struct worker {
+	struct jobs *jobs;
+	unsigned int id;
+	pthread_t thread;
+};
+
+struct jobs {
+	unsigned int threads;
+	struct worker *workers;
+	struct deque *deques;
+
+	/* Guards everything below. */
+	pthread_mutex_t lock;
+	pthread_cond_t started;
+	pthread_cond_t finished;
+	unsigned long run;
+	unsigned int busy;
+	bool quit;
+	job_function function;
+	void *context;
+};
+
+static void *_worker(void *_worker);
+
+static void _work(struct jobs *_jobs, unsigned int _id);
+
+static void _fill(struct deque *_deque, unsigned int _first,
+    unsigned int _last, unsigned int _count, unsigned int _grain);
+
+static bool _take(struct deque *_deque, bool _tail, struct chunk *_chunk);
+
+struct jobs *
+jobs_create(unsigned int threads)
+{
+	if (threads == 0) {
+		long n = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = n > 0 ? n : 1;
+	}
+
+	struct jobs *j = calloc(1, sizeof(struct jobs));
+	if (j == NULL)
+		err("calloc");
+
+	assert(j != NULL);
+
+	j->threads = threads;
+	j->workers = calloc(threads, sizeof(*j->workers));
+	j->deques = calloc(threads, sizeof(*j->deques));
+	if (j->workers == NULL || j->deques == NULL)
+		err("calloc");
+
+	assert(j->workers != NULL);
+	assert(j->deques != NULL);
+
+	if (pthread_mutex_init(&j->lock, NULL) != 0)
+		err("pthread_mutex_init");
+	if (pthread_cond_init(&j->started, NULL) != 0)
+		err("pthread_cond_init");
+	if (pthread_cond_init(&j->finished, NULL) != 0)
+		err("pthread_cond_init");
+
+	for (unsigned int i = 0; i < threads; i++) {
+		if (pthread_mutex_init(&j->deques[i].lock, NULL) != 0)
+			err("pthread_mutex_init");
+
+		j->workers[i] = (struct worker) { .jobs = j, .id = i };
+	}
+
+	/* The calling thread is worker 0. */
+	for (unsigned int i = 1; i < threads; i++) {
+		if (pthread_create(&j->workers[i].thread, NULL, _worker,
+			&j->workers[i]) != 0)
+			err("pthread_create");
+	}
+
+	return (j);
+}
+
+void
+jobs_destroy(struct jobs *jobs)
+{
+	assert(jobs != NULL);
+
+	struct jobs *j = jobs;
+
+	pthread_mutex_lock(&j->lock);
+	j->quit = true;
+	pthread_cond_broadcast(&j->started);
+	pthread_mutex_unlock(&j->lock);
+
+	for (unsigned int i = 1; i < j->threads; i++)
+		pthread_join(j->workers[i].thread, NULL);
+
+	for (unsigned int i = 0; i < j->threads; i++) {
+		pthread_mutex_destroy(&j->deques[i].lock);
+		free(j->deques[i].chunks);
+	}
+
+	pthread_cond_destroy(&j->finished);
+	pthread_cond_destroy(&j->started);
+	pthread_mutex_destroy(&j->lock);
+	free(j->deques);
+	free(j->workers);
+	free(j);
+}
+
+unsigned int
+jobs_threads(struct jobs *jobs)
+{
+	assert(jobs != NULL);
+
+	return (jobs->threads);
+}
+
+void
+jobs_run(struct jobs *jobs, job_function function, void *context,
+    unsigned int count, unsigned int grain)
+{
+	assert(jobs != NULL);
+	assert(function != NULL);
+	assert(grain > 0);
+
+	struct jobs *j = jobs;
+
+	unsigned int chunks = count / grain + (count % grain != 0);
+	if (chunks <= 1 || j->threads == 1) {
+		if (count > 0)
+			function(context, 0, count);
+		return;
+	}
+
+	/* No thread touches the deques between runs. */
+	unsigned int threads = chunks < j->threads ? chunks : j->threads;
+	for (unsigned int i = 0; i < j->threads; i++) {
+		unsigned int first = (unsigned long)chunks * i / threads;
+		unsigned int last = (unsigned long)chunks * (i + 1) / threads;
+		if (i >= threads)
+			first = last = chunks;
+
+		_fill(&j->deques[i], first, last, count, grain);
+	}
+
+	pthread_mutex_lock(&j->lock);
+	j->function = function;
+	j->context = context;
+	j->busy = j->threads - 1;
+	j->run++;
+	pthread_cond_broadcast(&j->started);
+	pthread_mutex_unlock(&j->lock);
+
+	_work(j, 0);
+
+	pthread_mutex_lock(&j->lock);
+	while (j->busy > 0)
+		pthread_cond_wait(&j->finished, &j->lock);
+	pthread_mutex_unlock(&j->lock);
+}
+
+static void *
+_worker(void *arg)
+{
+	struct worker *w = arg;
+	struct jobs *j = w->jobs;
+
+	unsigned long run = 0;
+	for (;;) {
+		pthread_mutex_lock(&j->lock);
+		while (j->run == run && !j->quit)
+			pthread_cond_wait(&j->started, &j->lock);
+		if (j->quit) {
+			pthread_mutex_unlock(&j->lock);
+			break;
+		}
+		run = j->run;
+		pthread_mutex_unlock(&j->lock);
+
+		_work(j, w->id);
+
+		pthread_mutex_lock(&j->lock);
+		if (--j->busy == 0)
+			pthread_cond_signal(&j->finished);
+		pthread_mutex_unlock(&j->lock);
+	}
+
+	return (NULL);
+}
+
+/*
+ * Runs the own chunks, then steals from the others until no chunk is left
+ * anywhere. Chunks are only added before a run starts, so once a full round
+ * over all deques came up empty the thread is done.
+ */
+static void
+_work(struct jobs *jobs, unsigned int id)
+{
+	struct jobs *j = jobs;
+	struct chunk c;
+
+	for (;;) {
+		if (_take(&j->deques[id], true, &c)) {
+			j->function(j->context, c.begin, c.end);
+			continue;
+		}
+
+		bool stolen = false;
+		for (unsigned int i = 1; i < j->threads && !stolen; i++) {
+			unsigned int victim = (id + i) % j->threads;
+			stolen = _take(&j->deques[victim], false, &c);
+		}
+
+		if (!stolen)
+			return;
+
+		j->function(j->context, c.begin, c.end);
+	}
+}
+
+/* Hands chunks [_first, _last) of a run over _count indices to _deque. */
+static void
+_fill(struct deque *deque, unsigned int first, unsigned int last,
+    unsigned int count, unsigned int grain)
+{
+	struct deque *d = deque;
+
+	if (last - first > d->capacity) {
+		d->capacity = last - first;
+		d->chunks =
+		    realloc(d->chunks, d->capacity * sizeof(*d->chunks));
+		if (d->chunks == NULL)
+			err("realloc");
+
+		assert(d->chunks != NULL);
+	}
+
+	d->head = 0;
+	d->tail = 0;
+	for (unsigned int i = first; i < last; i++) {
+		unsigned int begin = i * grain;
+		unsigned int end = begin + grain;
+		if (end > count || end < begin)
+			end = count;
+
+		d->chunks[d->tail++] = (struct chunk) { begin, end };
+	}
+}
+
+static bool
+_take(struct deque *deque, bool tail, struct chunk *chunk)
+{
+	struct deque *d = deque;
+	bool taken = false;
+
+	pthread_mutex_lock(&d->lock);
+	if (d->head < d->tail) {
+		*chunk = tail ? d->chunks[--d->tail] : d->chunks[d->head++];
+		taken = true;
+	}
+	pthread_mutex_unlock(&d->lock);
+
+	return (taken);
+}
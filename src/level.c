@@ -16,68 +16,310 @@
 #include <stdlib.h>
 
 #include <assert.h>
+#include <string.h>
 
 #include <sine_nomine/err.h>
 #include <sine_nomine/level.h>
+#include <sine_nomine/rng.h>
 #include <sine_nomine/structs.h>
 
+enum { JOURNAL_INITIAL_CAPACITY = 64,
+};
+
+static struct level *_allocate_level(struct coordinate_dimension _dimension);
+
+static size_t _chunk_size(struct level *_level);
+
+static struct level_chunk *_writable_chunk(
+    struct level *_level, unsigned int _index);
+
+static void _release_chunk(struct level_chunk *_chunk);
+
+static void _journal_append(struct level *_level, struct coordinate _position,
+    unsigned int _old_flags, unsigned int _new_flags);
+
+static void _journal_reset(struct level *_level);
+
 struct level *
 level_create(struct coordinate_dimension d)
 {
 	assert(d.height > 0);
 	assert(d.width > 0);
 
-	struct level *l = calloc(1, sizeof(struct level));
-	if (l == NULL)
-		err("calloc");
+	struct level *l = _allocate_level(d);
 
-	assert(l != NULL);
+	for (unsigned int i = 0; i < l->chunk_count; i++) {
+		l->chunks[i] = calloc(1, _chunk_size(l));
+		if (l->chunks[i] == NULL)
+			err("calloc");
 
-	l->dimension = d;
+		assert(l->chunks[i] != NULL);
 
-	l->tiles = calloc(l->dimension.height, sizeof(*l->tiles));
-	if (l->tiles == NULL)
-		err("calloc");
+		atomic_init(&l->chunks[i]->references, 1);
+	}
 
-	assert(l->tiles != NULL);
+	return (l);
+}
 
-	for (unsigned int y = 0; y < l->dimension.height; y++) {
-		l->tiles[y] = calloc(l->dimension.width, sizeof(**l->tiles));
-		if (l->tiles[y] == NULL)
-			err("calloc");
+void
+level_destroy(struct level *level)
+{
+	assert(level != NULL);
+
+	for (unsigned int i = 0; i < level->chunk_count; i++)
+		_release_chunk(level->chunks[i]);
 
-		assert(l->tiles[y] != NULL);
+	free(level->chunks);
+	free(level->journal.changes);
+	free(level);
+}
+
+struct level *
+level_snapshot(struct level *level)
+{
+	assert(level != NULL);
+
+	struct level *s = _allocate_level(level->dimension);
+
+	for (unsigned int i = 0; i < level->chunk_count; i++) {
+		atomic_fetch_add(&level->chunks[i]->references, 1);
+		s->chunks[i] = level->chunks[i];
 	}
 
-	return (l);
+	s->generation = level->generation;
+	s->journal.base = level->generation;
+
+	return (s);
 }
 
 void
-level_destroy(struct level *level)
+level_set_flags(
+    struct level *level, struct coordinate position, unsigned int flags)
 {
 	assert(level != NULL);
+	assert(coordinate_check_bounds(level->dimension, position));
+
+	if (level_get_flags(level, position) == flags)
+		return;
+
+	struct level_chunk *c =
+	    _writable_chunk(level, level_chunk_index(position));
+	struct level_tile *t = &c->tiles[level_chunk_offset(position)];
+
+	_journal_append(level, position, t->flags, flags);
+	t->flags = flags;
+}
+
+void
+level_add_flags(
+    struct level *level, struct coordinate position, unsigned int mask)
+{
+	level_set_flags(
+	    level, position, level_get_flags(level, position) | mask);
+}
+
+void
+level_remove_flags(
+    struct level *level, struct coordinate position, unsigned int mask)
+{
+	level_set_flags(
+	    level, position, level_get_flags(level, position) & ~mask);
+}
 
-	for (unsigned int y = 0; y < level->dimension.height; y++) {
-		free(level->tiles[y]);
+void
+level_fill_span(struct level *level, struct coordinate start,
+    unsigned int length, unsigned int flags)
+{
+	assert(level != NULL);
+	assert(coordinate_check_bounds(level->dimension, start));
+	assert(start.x + length <= level->dimension.width);
+
+	struct level_chunk *c =
+	    _writable_chunk(level, level_chunk_index(start));
+	for (unsigned int x = start.x; x < start.x + length; x++) {
+		struct coordinate p = { start.y, x };
+		c->tiles[level_chunk_offset(p)].flags = flags;
 	}
 
-	free(level->tiles);
-	free(level);
+	level->generation++;
+	_journal_reset(level);
+}
+
+void
+level_get_row(const struct level *level, unsigned int y, unsigned int *flags)
+{
+	assert(level != NULL);
+	assert(y < level->dimension.height);
+	assert(flags != NULL);
+
+	struct coordinate p = { y, 0 };
+	const struct level_chunk *c = level->chunks[level_chunk_index(p)];
+	for (p.x = 0; p.x < level->dimension.width; p.x++)
+		flags[p.x] = c->tiles[level_chunk_offset(p)].flags;
+}
+
+void
+level_set_row(struct level *level, unsigned int y, const unsigned int *flags)
+{
+	assert(level != NULL);
+	assert(y < level->dimension.height);
+	assert(flags != NULL);
+
+	struct coordinate p = { y, 0 };
+	struct level_chunk *c = _writable_chunk(level, level_chunk_index(p));
+	for (p.x = 0; p.x < level->dimension.width; p.x++)
+		c->tiles[level_chunk_offset(p)].flags = flags[p.x];
+
+	level->generation++;
+	_journal_reset(level);
+}
+
+const struct level_change *
+level_journal_since(
+    const struct level *level, unsigned long generation, unsigned int *count)
+{
+	assert(level != NULL);
+	assert(count != NULL);
+	assert(generation <= level->generation);
+
+	if (generation < level->journal.base)
+		return (NULL);
+
+	*count = level->generation - generation;
+
+	return (&level->journal.changes[generation - level->journal.base]);
 }
 
 void
-level_modify_random_floor_tiles(
-    struct level *level, unsigned int count, unsigned int mask)
+level_journal_clear(struct level *level)
+{
+	assert(level != NULL);
+
+	_journal_reset(level);
+}
+
+void
+level_modify_random_floor_tiles(struct level *level, struct rng *rng,
+    unsigned int count, unsigned int mask)
 {
 	for (unsigned int i = 1; i < count; i++) {
 		for (;;) {
-			unsigned int y = rand() % (level->dimension.height);
-			unsigned int x = rand() % (level->dimension.width);
+			/* Two statements, the evaluation order matters. */
+			struct coordinate c;
+			c.y = rng_uniform(rng, level->dimension.height);
+			c.x = rng_uniform(rng, level->dimension.width);
 
-			if (level->tiles[y][x].flags & TA_FLOOR) {
-				level->tiles[y][x].flags |= mask;
+			if (level_get_flags(level, c) & TA_FLOOR) {
+				level_add_flags(level, c, mask);
 				break;
 			}
 		}
 	}
 }
+
+static struct level *
+_allocate_level(struct coordinate_dimension dimension)
+{
+	struct level *l = calloc(1, sizeof(struct level));
+	if (l == NULL)
+		err("calloc");
+
+	assert(l != NULL);
+
+	l->dimension = dimension;
+
+	unsigned int blocks = (l->dimension.width + LEVEL_BLOCK_WIDTH - 1) /
+	    LEVEL_BLOCK_WIDTH;
+
+	l->chunk_count = (l->dimension.height + LEVEL_CHUNK_HEIGHT - 1) /
+	    LEVEL_CHUNK_HEIGHT;
+	l->chunk_tiles = blocks * LEVEL_BLOCK_WIDTH * LEVEL_CHUNK_HEIGHT;
+
+	l->chunks = calloc(l->chunk_count, sizeof(*l->chunks));
+	if (l->chunks == NULL)
+		err("calloc");
+
+	assert(l->chunks != NULL);
+
+	l->journal.capacity = JOURNAL_INITIAL_CAPACITY;
+	l->journal.changes =
+	    calloc(l->journal.capacity, sizeof(*l->journal.changes));
+	if (l->journal.changes == NULL)
+		err("calloc");
+
+	assert(l->journal.changes != NULL);
+
+	return (l);
+}
+
+static size_t
+_chunk_size(struct level *level)
+{
+	return (sizeof(struct level_chunk) +
+	    level->chunk_tiles * sizeof(struct level_tile));
+}
+
+/*
+ * Returns the chunk _index of the level, ready to be modified. A chunk that is
+ * shared with a snapshot is copied first.
+ */
+static struct level_chunk *
+_writable_chunk(struct level *level, unsigned int index)
+{
+	struct level_chunk *o = level->chunks[index];
+
+	if (atomic_load(&o->references) == 1)
+		return (o);
+
+	struct level_chunk *c = malloc(_chunk_size(level));
+	if (c == NULL)
+		err("malloc");
+
+	assert(c != NULL);
+
+	atomic_init(&c->references, 1);
+	memcpy(c->tiles, o->tiles, level->chunk_tiles * sizeof(*c->tiles));
+
+	_release_chunk(o);
+	level->chunks[index] = c;
+
+	return (c);
+}
+
+static void
+_release_chunk(struct level_chunk *chunk)
+{
+	if (atomic_fetch_sub(&chunk->references, 1) == 1)
+		free(chunk);
+}
+
+static void
+_journal_append(struct level *level, struct coordinate position,
+    unsigned int old_flags, unsigned int new_flags)
+{
+	struct level_journal *j = &level->journal;
+
+	if (j->elements == j->capacity) {
+		j->capacity *= 2;
+
+		j->changes =
+		    realloc(j->changes, j->capacity * sizeof(*j->changes));
+		if (j->changes == NULL)
+			err("realloc");
+
+		assert(j->changes != NULL);
+	}
+
+	j->changes[j->elements++] =
+	    (struct level_change) { position, old_flags, new_flags };
+	level->generation++;
+
+	assert(level->generation == j->base + j->elements);
+}
+
+static void
+_journal_reset(struct level *level)
+{
+	level->journal.base = level->generation;
+	level->journal.elements = 0;
+}
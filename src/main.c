@@ -14,12 +14,19 @@
  */
 
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
 
+#include <ctype.h>
+#include <errno.h>
 #include <getopt.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <string.h>
 
 #include <sine_nomine/err.h>
 #include <sine_nomine/game.h>
+#include <sine_nomine/rng.h>
 #include <sine_nomine/structs.h>
 
 enum { HEIGHT = 100,
@@ -30,21 +37,48 @@ enum { HEIGHT = 100,
 	ROOMMAXSIZE = 20,
 	TORCHESMIN = 5,
 	TORCHESMAX = 20,
+	HEADLESSTURNS = 100000,
+	JOBS_MAX = 1024,
 };
 
 /* clang-format off */
 static struct option long_options[] = {
-	{ "help",   no_argument,       0,    1},
-	{ "rooms",  required_argument, 0,    2},
-	{ "height", required_argument, 0,    3},
-	{ "width",  required_argument, 0,    4},
-	{ "range",  required_argument, 0,    5},
-	{ NULL,     0,                 NULL, 0}
+	{ "help",      no_argument,       0,    1},
+	{ "rooms",     required_argument, 0,    2},
+	{ "height",    required_argument, 0,    3},
+	{ "width",     required_argument, 0,    4},
+	{ "range",     required_argument, 0,    5},
+	{ "seed",      required_argument, 0,    6},
+	{ "generator", required_argument, 0,    7},
+	{ "headless",  no_argument,       0,    8},
+	{ "script",    required_argument, 0,    9},
+	{ "turns",     required_argument, 0,    10},
+	{ "record",    required_argument, 0,    11},
+	{ "replay",    required_argument, 0,    12},
+	{ "save",      required_argument, 0,    13},
+	{ "jobs",      required_argument, 0,    14},
+	{ NULL,        0,                 NULL, 0}
 };
 /* clang-format on */
 
+static const char *subsystems[GS_COUNT] = {
+	[GS_REGIONS] = "regions",
+	[GS_FRONTIER] = "frontier",
+	[GS_AUTOEXPLORE] = "autoexplore",
+	[GS_FOV] = "fov",
+	[GS_UI] = "ui",
+	[GS_BOT] = "bot",
+	[GS_LEVELS] = "levels",
+	[GS_SAVE] = "save",
+	[GS_ACTORS] = "actors",
+};
+
+static uint64_t _parse_number(char **_argv, const char *_text, uint64_t _max);
+
 static void _print_help(char **_argv);
 
+static void _print_statistics(struct game_statistics _statistics);
+
 int
 main(int argc, char **argv)
 {
@@ -55,6 +89,7 @@ main(int argc, char **argv)
 		.rooms = ROOMS,
 		.roomsize = (struct range) { ROOMMINSIZE, ROOMMAXSIZE },
 		.torches = (struct range) { TORCHESMIN, TORCHESMAX },
+		.seed = rng_entropy(),
 	};
 
 	/* options parsing */
@@ -77,6 +112,42 @@ main(int argc, char **argv)
 		case 5:
 			config.range = strtol(optarg, NULL, 10);
 			break;
+		case 6:
+			config.seed = _parse_number(argv, optarg, UINT64_MAX);
+			break;
+		case 7:
+			if (strcmp(optarg, "rooms") == 0)
+				config.generator = DG_ROOMS;
+			else if (strcmp(optarg, "bsp") == 0)
+				config.generator = DG_BSP;
+			else if (strcmp(optarg, "cave") == 0)
+				config.generator = DG_CAVE;
+			else if (strcmp(optarg, "world") == 0)
+				config.generator = DG_WORLD;
+			else
+				die("error: unknown generator '%s'\n", optarg);
+			break;
+		case 8:
+			config.headless = true;
+			break;
+		case 9:
+			config.script = optarg;
+			break;
+		case 10:
+			config.turns = _parse_number(argv, optarg, ULONG_MAX);
+			break;
+		case 11:
+			config.record = optarg;
+			break;
+		case 12:
+			config.replay = optarg;
+			break;
+		case 13:
+			config.save = optarg;
+			break;
+		case 14:
+			config.jobs = _parse_number(argv, optarg, JOBS_MAX);
+			break;
 		default:
 			_print_help(argv);
 			exit(EXIT_FAILURE);
@@ -86,14 +157,50 @@ main(int argc, char **argv)
 		die("error: width must not be smaller than 25\n");
 	if (config.height < 25)
 		die("error: height must not be smaller than 25\n");
+	if (config.headless && config.turns == 0)
+		config.turns = HEADLESSTURNS;
+	if (config.record != NULL && config.replay != NULL &&
+	    strcmp(config.record, config.replay) == 0)
+		die("error: cannot record to the replayed file\n");
+	if (config.save != NULL &&
+	    (config.record != NULL || config.replay != NULL))
+		die("error: --save cannot be combined with recordings\n");
+	if (config.save != NULL && config.generator == DG_WORLD)
+		die("error: --save cannot be combined with the world\n");
 
 	struct game *game = game_create(config);
 	game_loop(game);
+	struct game_statistics statistics = game_get_statistics(game);
 	game_destroy(game);
 
+	printf("seed %" PRIu64 "\n", statistics.seed);
+	if (config.headless || config.replay != NULL)
+		_print_statistics(statistics);
+
 	return (EXIT_SUCCESS);
 }
 
+/*
+ * Returns the decimal number _text, or prints the help and exits if _text is
+ * anything else, or the number is larger than _max.
+ */
+static uint64_t
+_parse_number(char **argv, const char *text, uint64_t max)
+{
+	char *end;
+	errno = 0;
+	unsigned long long n = strtoull(text, &end, 10);
+
+	/* strtoull() accepts signs and leading space, numbers do not. */
+	if (!isdigit((unsigned char)text[0]) || errno != 0 || *end != '\0' ||
+	    n > max) {
+		_print_help(argv);
+		exit(EXIT_FAILURE);
+	}
+
+	return (n);
+}
+
 static void
 _print_help(char **argv)
 {
@@ -104,5 +211,47 @@ _print_help(char **argv)
 	printf("       --height <number>      height of the full map\n");
 	printf("       --width  <number>      width of the full map\n");
 	printf("       --range  <number>      FOV range for the player to start with\n");
+	printf("       --seed   <number>      seed for the random number generator\n");
+	printf("       --generator <name>     dungeon generator: rooms (default), bsp or cave\n");
+	printf("                              or world, an endless dungeon without stairs\n");
+	printf("       --headless             run without terminal, let a bot play\n");
+	printf("       --script <keys>        keys to play before the bot takes over\n");
+	printf("       --turns  <number>      stop after this many turns (headless: %d)\n",
+	    HEADLESSTURNS);
+	printf("       --record <file>        record seed and input to a file\n");
+	printf("       --replay <file>        replay a recording headless\n");
+	printf("       --save   <file>        continue and save the game in a file\n");
+	printf("       --jobs   <number>      threads for the monsters (default: one per CPU)\n");
 	/* clang-format on */
 }
+
+static void
+_print_statistics(struct game_statistics statistics)
+{
+	double seconds = statistics.seconds;
+	double other = seconds;
+
+	printf("%lu turns, %lu frames, %lu levels in %.3f s: %.0f turns/s\n",
+	    statistics.turns, statistics.frames, statistics.levels, seconds,
+	    seconds > 0 ? statistics.turns / seconds : 0);
+
+	unsigned long lookups = statistics.goal_hits + statistics.goal_misses;
+	printf("goal maps: %lu hits, %lu misses: %.1f %% hit rate\n",
+	    statistics.goal_hits, statistics.goal_misses,
+	    lookups > 0 ? 100.0 * statistics.goal_hits / lookups : 0);
+
+	if (statistics.chunks > 0)
+		printf("world: %lu chunks generated, %lu stalls\n",
+		    statistics.chunks, statistics.stalls);
+
+	for (int i = 0; i < GS_COUNT; i++) {
+		double s = statistics.subsystems[i];
+		other -= s;
+
+		printf("%-12s %10.3f s %6.1f %%\n", subsystems[i], s,
+		    seconds > 0 ? 100 * s / seconds : 0);
+	}
+
+	printf("%-12s %10.3f s %6.1f %%\n", "other", other,
+	    seconds > 0 ? 100 * other / seconds : 0);
+}
@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include <sine_nomine/cave.h>
+#include <sine_nomine/coordinate.h>
+#include <sine_nomine/dungeon.h>
+#include <sine_nomine/err.h>
+#include <sine_nomine/game.h>
+#include <sine_nomine/level.h>
+#include <sine_nomine/pregen.h>
+#include <sine_nomine/region.h>
+#include <sine_nomine/rng.h>
+
+/*
+ * The finished level is handed over through a single atomic pointer: the
+ * worker publishes it with a release store, the game takes it with an acquire
+ * exchange. The semaphores only put the threads to sleep while there is
+ * nothing to do: "wanted" counts the levels the worker should generate,
+ * "produced" the levels waiting in the handoff.
+ */
+struct pregen {
+	struct game_configuration config;
+	unsigned int depth;
+
+	_Atomic(struct pregen_level *) ready;
+	atomic_bool quit;
+
+	sem_t wanted;
+	sem_t produced;
+	pthread_t worker;
+};
+
+static void *_worker(void *_pregen);
+
+static struct coordinate _random_floor(struct level *_level, struct rng *_rng);
+
+struct pregen *
+pregen_create(struct game_configuration config, unsigned int depth)
+{
+	struct pregen *p = calloc(1, sizeof(struct pregen));
+	if (p == NULL)
+		err("calloc");
+
+	assert(p != NULL);
+
+	p->config = config;
+	p->depth = depth;
+	atomic_init(&p->ready, NULL);
+	atomic_init(&p->quit, false);
+
+	if (sem_init(&p->wanted, 0, 1) != 0)
+		err("sem_init");
+	if (sem_init(&p->produced, 0, 0) != 0)
+		err("sem_init");
+	if (pthread_create(&p->worker, NULL, _worker, p) != 0)
+		err("pthread_create");
+
+	return (p);
+}
+
+void
+pregen_destroy(struct pregen *pregen)
+{
+	assert(pregen != NULL);
+
+	atomic_store(&pregen->quit, true);
+	sem_post(&pregen->wanted);
+	pthread_join(pregen->worker, NULL);
+
+	struct pregen_level *l = atomic_exchange(&pregen->ready, NULL);
+	if (l != NULL)
+		pregen_release(l);
+
+	sem_destroy(&pregen->produced);
+	sem_destroy(&pregen->wanted);
+	free(pregen);
+}
+
+struct pregen_level *
+pregen_take(struct pregen *pregen)
+{
+	assert(pregen != NULL);
+
+	while (sem_wait(&pregen->produced) != 0)
+		; /* interrupted by a signal */
+
+	struct pregen_level *l = atomic_exchange_explicit(
+	    &pregen->ready, NULL, memory_order_acquire);
+	assert(l != NULL);
+
+	sem_post(&pregen->wanted);
+
+	return (l);
+}
+
+void
+pregen_release(struct pregen_level *level)
+{
+	assert(level != NULL);
+
+	region_destroy(level->regions);
+	level_destroy(level->level);
+	free(level);
+}
+
+struct pregen_level *
+pregen_generate(struct game_configuration config, unsigned int depth)
+{
+	struct pregen_level *l = calloc(1, sizeof(struct pregen_level));
+	if (l == NULL)
+		err("calloc");
+
+	assert(l != NULL);
+
+	/*
+	 * Generation draws from its own stream, so that the same seed always
+	 * produces the same levels, no matter what happens during play.
+	 */
+	struct rng rng;
+	rng_seed(&rng, rng_derive(config.seed, depth), RNG_STREAM_GENERATION);
+
+	struct coordinate_dimension d = { config.height, config.width };
+	struct coordinate_dimension min = { config.roomsize.min,
+		config.roomsize.min };
+	struct coordinate_dimension max = { config.roomsize.max,
+		config.roomsize.max };
+
+	l->depth = depth;
+	l->level = level_create(d);
+
+	switch (config.generator) {
+	case DG_ROOMS:
+		dungeon_generate(l->level, &rng, config.rooms, min, max);
+		break;
+
+	case DG_BSP:
+		dungeon_generate_bsp(l->level, &rng, min, max);
+		break;
+
+	case DG_CAVE:
+		cave_generate(l->level, &rng, CAVE_FILL, CAVE_ITERATIONS);
+		break;
+
+	case DG_WORLD:
+		/* The world has no floors. */
+		assert(config.generator != DG_WORLD);
+		break;
+	}
+
+	unsigned int torches =
+	    rng_uniform(&rng, config.torches.max - config.torches.min + 1) +
+	    config.torches.min;
+	level_modify_random_floor_tiles(l->level, &rng, torches, TA_TORCH);
+
+	/*
+	 * The spawn point and the stairs are placed at random. This should
+	 * rather be determined by the dungeon generation algorithm.
+	 */
+	l->spawn = _random_floor(l->level, &rng);
+	if (depth > 0)
+		level_add_flags(l->level, l->spawn, TA_UPSTAIRS);
+
+	/* A level with a single floor tile has no room for stairs. */
+	l->stairs = l->spawn;
+	for (int tries = 0; tries < 1000; tries++) {
+		struct coordinate c = _random_floor(l->level, &rng);
+		if (c.y == l->spawn.y && c.x == l->spawn.x)
+			continue;
+
+		level_add_flags(l->level, c, TA_STAIRS);
+		l->stairs = c;
+		break;
+	}
+
+	l->regions = region_create(l->level);
+
+	return (l);
+}
+
+static void *
+_worker(void *arg)
+{
+	struct pregen *p = arg;
+
+	for (;;) {
+		while (sem_wait(&p->wanted) != 0)
+			; /* interrupted by a signal */
+
+		if (atomic_load(&p->quit))
+			break;
+
+		struct pregen_level *l = pregen_generate(p->config, p->depth++);
+
+		assert(atomic_load(&p->ready) == NULL);
+		atomic_store_explicit(&p->ready, l, memory_order_release);
+		sem_post(&p->produced);
+	}
+
+	return (NULL);
+}
+
+static struct coordinate
+_random_floor(struct level *level, struct rng *rng)
+{
+	for (;;) {
+		/* Two statements, the evaluation order matters. */
+		struct coordinate c;
+		c.y = rng_uniform(rng, level->dimension.height);
+		c.x = rng_uniform(rng, level->dimension.width);
+
+		if (level_get_flags(level, c) & TA_FLOOR)
+			return (c);
+	}
+}
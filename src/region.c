@@ -0,0 +1,310 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <assert.h>
+
+#include <sine_nomine/coordinate.h>
+#include <sine_nomine/err.h>
+#include <sine_nomine/level.h>
+#include <sine_nomine/region.h>
+
+enum { SETS_INITIAL_CAPACITY = 64,
+};
+
+static void _label(struct region_map *_map);
+
+static void _open(struct region_map *_map, struct coordinate _position);
+
+static bool _passable(unsigned int _flags);
+
+static unsigned int _make_set(struct region_sets *_sets);
+
+static unsigned int _find(struct region_sets *_sets, unsigned int _label);
+
+static bool _union(struct region_sets *_sets, unsigned int _a, unsigned int _b);
+
+struct region_map *
+region_create(struct level *level)
+{
+	assert(level != NULL);
+
+	struct region_map *m = calloc(1, sizeof(struct region_map));
+	if (m == NULL)
+		err("calloc");
+
+	assert(m != NULL);
+
+	m->level = level;
+	m->labels = calloc(level_tile_index_count(level), sizeof(*m->labels));
+	if (m->labels == NULL)
+		err("calloc");
+
+	assert(m->labels != NULL);
+
+	_label(m);
+
+	return (m);
+}
+
+void
+region_destroy(struct region_map *map)
+{
+	assert(map != NULL);
+
+	free(map->sets.parent);
+	free(map->labels);
+	free(map);
+}
+
+void
+region_update(struct region_map *map)
+{
+	assert(map != NULL);
+
+	if (map->generation == map->level->generation)
+		return;
+
+	unsigned int n;
+	const struct level_change *c =
+	    level_journal_since(map->level, map->generation, &n);
+	if (c == NULL) {
+		_label(map);
+		return;
+	}
+
+	for (unsigned int i = 0; i < n; i++) {
+		bool before = _passable(c[i].old_flags);
+		bool after = _passable(c[i].new_flags);
+
+		/* A new wall may split a region, start over. */
+		if (before && !after) {
+			_label(map);
+			return;
+		}
+
+		if (!before && after)
+			_open(map, c[i].position);
+	}
+
+	map->generation = map->level->generation;
+}
+
+unsigned int
+region_get(struct region_map *map, struct coordinate position)
+{
+	assert(map != NULL);
+	assert(coordinate_check_bounds(map->level->dimension, position));
+
+	size_t i = level_tile_index(map->level, position);
+	unsigned int label = map->labels[i];
+	if (label == 0)
+		return (0);
+
+	return (_find(&map->sets, label));
+}
+
+bool
+region_connected(
+    struct region_map *map, struct coordinate a, struct coordinate b)
+{
+	unsigned int r = region_get(map, a);
+
+	return (r != 0 && r == region_get(map, b));
+}
+
+unsigned int
+region_count(struct region_map *map)
+{
+	assert(map != NULL);
+
+	return (map->count);
+}
+
+/*
+ * Two pass connected component labeling. The first pass scans the level row by
+ * row and gives every passable tile the label of its upper or left neighbor (or
+ * a new one), recording labels that turn out to be connected in a union-find
+ * structure. The second pass replaces every label by a compact region id.
+ */
+static void
+_label(struct region_map *map)
+{
+	struct level *l = map->level;
+	struct region_sets *s = &map->sets;
+
+	s->elements = 0;
+	_make_set(s); /* 0 is reserved for walls */
+
+	for (unsigned int y = 0; y < l->dimension.height; y++) {
+		for (unsigned int x = 0; x < l->dimension.width; x++) {
+			struct coordinate c = { y, x };
+			size_t i = level_tile_index(l, c);
+
+			if (!_passable(level_get_flags(l, c))) {
+				map->labels[i] = 0;
+				continue;
+			}
+
+			unsigned int up = 0;
+			if (y > 0) {
+				struct coordinate u = { y - 1, x };
+				up = map->labels[level_tile_index(l, u)];
+			}
+
+			unsigned int left = 0;
+			if (x > 0) {
+				struct coordinate w = { y, x - 1 };
+				left = map->labels[level_tile_index(l, w)];
+			}
+
+			if (up == 0 && left == 0) {
+				map->labels[i] = _make_set(s);
+			} else if (up == 0) {
+				map->labels[i] = left;
+			} else {
+				map->labels[i] = up;
+				if (left != 0)
+					_union(s, up, left);
+			}
+		}
+	}
+
+	unsigned int *ids = calloc(s->elements, sizeof(*ids));
+	if (ids == NULL)
+		err("calloc");
+
+	assert(ids != NULL);
+
+	unsigned int count = 0;
+	for (unsigned int i = 1; i < s->elements; i++) {
+		if (_find(s, i) == i)
+			ids[i] = ++count;
+	}
+
+	size_t n = level_tile_index_count(l);
+	for (size_t i = 0; i < n; i++) {
+		if (map->labels[i] != 0)
+			map->labels[i] = ids[_find(s, map->labels[i])];
+	}
+
+	free(ids);
+
+	s->elements = count + 1;
+	for (unsigned int i = 0; i < s->elements; i++)
+		s->parent[i] = i;
+
+	map->count = count;
+	map->generation = l->generation;
+}
+
+/*
+ * A wall was opened: the tile joins (and merges) the regions of its neighbors,
+ * or starts a new region.
+ */
+static void
+_open(struct region_map *map, struct coordinate position)
+{
+	struct level *l = map->level;
+	unsigned int label = 0;
+
+	struct coordinate_offset off[4] = { { -1, 0 }, { 0, 1 }, { 1, 0 },
+		{ 0, -1 } };
+
+	for (int i = 0; i < 4; i++) {
+		if (!coordinate_check_bounds_offset(
+			l->dimension, position, off[i]))
+			continue;
+
+		struct coordinate c = coordinate_add_offset(position, off[i]);
+		unsigned int n = map->labels[level_tile_index(l, c)];
+		if (n == 0)
+			continue;
+
+		if (label == 0)
+			label = n;
+		else if (_union(&map->sets, label, n))
+			map->count--;
+	}
+
+	if (label == 0) {
+		label = _make_set(&map->sets);
+		map->count++;
+	}
+
+	map->labels[level_tile_index(l, position)] = label;
+}
+
+static bool
+_passable(unsigned int flags)
+{
+	return (!(flags & TA_WALL));
+}
+
+static unsigned int
+_make_set(struct region_sets *sets)
+{
+	if (sets->elements == sets->capacity) {
+		sets->capacity = sets->capacity ? sets->capacity * 2
+						: SETS_INITIAL_CAPACITY;
+
+		sets->parent = realloc(
+		    sets->parent, sets->capacity * sizeof(*sets->parent));
+		if (sets->parent == NULL)
+			err("realloc");
+
+		assert(sets->parent != NULL);
+	}
+
+	unsigned int label = sets->elements++;
+	sets->parent[label] = label;
+
+	return (label);
+}
+
+static unsigned int
+_find(struct region_sets *sets, unsigned int label)
+{
+	assert(label < sets->elements);
+
+	while (sets->parent[label] != label) {
+		sets->parent[label] = sets->parent[sets->parent[label]];
+		label = sets->parent[label];
+	}
+
+	return (label);
+}
+
+/*
+ * Merges the sets of _a and _b, the smaller label becomes the root. Returns
+ * false if both already were in the same set.
+ */
+static bool
+_union(struct region_sets *sets, unsigned int a, unsigned int b)
+{
+	a = _find(sets, a);
+	b = _find(sets, b);
+	if (a == b)
+		return (false);
+
+	if (a < b)
+		sets->parent[b] = a;
+	else
+		sets->parent[a] = b;
+
+	return (true);
+}
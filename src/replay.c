@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <string.h>
+
+#include <sine_nomine/err.h>
+#include <sine_nomine/game.h>
+#include <sine_nomine/replay.h>
+#include <sine_nomine/ui.h>
+
+enum { RUN_MAX = 16,
+	VERSION = 3,
+	END = 0xff,
+	TRAILER_SIZE = 9,
+};
+
+static const char _magic[4] = { 'S', 'N', 'R', 'P' };
+
+struct recording {
+	FILE *file;
+	const char *path;
+	UI_ACTION action;
+	unsigned int run;
+};
+
+struct replay {
+	FILE *file;
+	const char *path;
+	UI_ACTION action;
+	unsigned int run;
+};
+
+static void _flush(struct recording *_recording);
+
+static void _write_u32(FILE *_file, uint32_t _value);
+
+static void _write_u64(FILE *_file, uint64_t _value);
+
+static uint32_t _read_u32(struct replay *_replay);
+
+static uint64_t _read_u64(struct replay *_replay);
+
+static int _read_byte(struct replay *_replay);
+
+struct recording *
+recording_create(const char *path, struct game_configuration config)
+{
+	assert(path != NULL);
+
+	struct recording *r = calloc(1, sizeof(struct recording));
+	if (r == NULL)
+		err("calloc");
+
+	assert(r != NULL);
+
+	r->path = path;
+	r->file = fopen(path, "wb");
+	if (r->file == NULL)
+		err("fopen %s", path);
+
+	fwrite(_magic, sizeof(_magic), 1, r->file);
+	fputc(VERSION, r->file);
+
+	_write_u64(r->file, config.seed);
+	_write_u32(r->file, config.height);
+	_write_u32(r->file, config.width);
+	_write_u32(r->file, config.rooms);
+	_write_u32(r->file, config.range);
+	_write_u32(r->file, config.roomsize.min);
+	_write_u32(r->file, config.roomsize.max);
+	_write_u32(r->file, config.torches.min);
+	_write_u32(r->file, config.torches.max);
+	_write_u32(r->file, config.generator);
+
+	return (r);
+}
+
+void
+recording_destroy(struct recording *recording, unsigned long turns)
+{
+	assert(recording != NULL);
+
+	_flush(recording);
+	fputc(END, recording->file);
+	_write_u64(recording->file, turns);
+
+	if (fclose(recording->file) != 0)
+		err("fclose %s", recording->path);
+
+	free(recording);
+}
+
+void
+recording_add(struct recording *recording, UI_ACTION action)
+{
+	assert(recording != NULL);
+	assert(action <= UA_RESIZE);
+
+	struct recording *r = recording;
+
+	if (r->run > 0 && (r->action != action || r->run == RUN_MAX))
+		_flush(r);
+
+	r->action = action;
+	r->run++;
+}
+
+struct replay *
+replay_create(const char *path, struct game_configuration *config)
+{
+	assert(path != NULL);
+	assert(config != NULL);
+
+	struct replay *r = calloc(1, sizeof(struct replay));
+	if (r == NULL)
+		err("calloc");
+
+	assert(r != NULL);
+
+	r->path = path;
+	r->file = fopen(path, "rb");
+	if (r->file == NULL)
+		err("fopen %s", path);
+
+	char magic[sizeof(_magic)];
+	if (fread(magic, sizeof(magic), 1, r->file) != 1 ||
+	    memcmp(magic, _magic, sizeof(magic)) != 0 ||
+	    _read_byte(r) != VERSION)
+		die("error: %s is no recording\n", path);
+
+	config->seed = _read_u64(r);
+	config->height = _read_u32(r);
+	config->width = _read_u32(r);
+	config->rooms = _read_u32(r);
+	config->range = _read_u32(r);
+	config->roomsize.min = _read_u32(r);
+	config->roomsize.max = _read_u32(r);
+	config->torches.min = _read_u32(r);
+	config->torches.max = _read_u32(r);
+	config->generator = _read_u32(r);
+
+	long actions = ftell(r->file);
+	if (actions < 0 || fseek(r->file, -TRAILER_SIZE, SEEK_END) != 0 ||
+	    ftell(r->file) < actions || _read_byte(r) != END)
+		die("error: %s is truncated\n", path);
+
+	config->turns = _read_u64(r);
+
+	if (fseek(r->file, actions, SEEK_SET) != 0)
+		err("fseek %s", path);
+
+	return (r);
+}
+
+void
+replay_destroy(struct replay *replay)
+{
+	assert(replay != NULL);
+
+	fclose(replay->file);
+	free(replay);
+}
+
+UI_ACTION
+replay_next(struct replay *replay)
+{
+	assert(replay != NULL);
+
+	struct replay *r = replay;
+
+	if (r->run == 0) {
+		int c = fgetc(r->file);
+		if (c == EOF || c == END)
+			return (UA_QUIT);
+
+		r->action = c >> 4;
+		r->run = (c & 0xf) + 1;
+
+		if (r->action > UA_RESIZE)
+			die("error: %s is corrupt\n", r->path);
+	}
+
+	r->run--;
+
+	return (r->action);
+}
+
+static void
+_flush(struct recording *recording)
+{
+	struct recording *r = recording;
+
+	if (r->run == 0)
+		return;
+
+	fputc(r->action << 4 | (r->run - 1), r->file);
+	r->run = 0;
+}
+
+static void
+_write_u32(FILE *file, uint32_t value)
+{
+	for (int i = 0; i < 4; i++)
+		fputc(value >> (8 * i) & 0xff, file);
+}
+
+static void
+_write_u64(FILE *file, uint64_t value)
+{
+	_write_u32(file, value & 0xffffffff);
+	_write_u32(file, value >> 32);
+}
+
+static uint32_t
+_read_u32(struct replay *replay)
+{
+	uint32_t value = 0;
+	for (int i = 0; i < 4; i++)
+		value |= (uint32_t)_read_byte(replay) << (8 * i);
+
+	return (value);
+}
+
+static uint64_t
+_read_u64(struct replay *replay)
+{
+	uint64_t low = _read_u32(replay);
+	uint64_t high = _read_u32(replay);
+
+	return (high << 32 | low);
+}
+
+static int
+_read_byte(struct replay *replay)
+{
+	int c = fgetc(replay->file);
+	if (c == EOF)
+		die("error: %s is truncated\n", replay->path);
+
+	return (c);
+}
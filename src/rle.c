@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <assert.h>
+
+#include <sine_nomine/err.h>
+#include <sine_nomine/level.h>
+#include <sine_nomine/rle.h>
+
+enum { VARINT_MAX = 5,
+	INITIAL_CAPACITY = 4096,
+};
+
+static void _put_run(
+    struct rle_buffer *_buffer, unsigned int _flags, uint32_t _run);
+
+static size_t _get_run(const uint8_t *_data, size_t _size,
+    unsigned int *_flags, uint32_t *_run);
+
+void
+rle_reserve(struct rle_buffer *buffer, size_t size)
+{
+	assert(buffer != NULL);
+
+	if (buffer->size + size <= buffer->capacity)
+		return;
+
+	size_t capacity = buffer->capacity ? buffer->capacity
+					   : INITIAL_CAPACITY;
+	while (capacity < buffer->size + size)
+		capacity *= 2;
+
+	buffer->data = realloc(buffer->data, capacity);
+	if (buffer->data == NULL)
+		err("realloc");
+
+	assert(buffer->data != NULL);
+
+	buffer->capacity = capacity;
+}
+
+void
+rle_encode(
+    struct rle_buffer *buffer, const struct level *level, unsigned int mask)
+{
+	assert(buffer != NULL);
+	assert(level != NULL);
+	assert(mask <= UINT8_MAX);
+
+	struct coordinate_dimension d = level->dimension;
+
+	unsigned int *row = calloc(d.width, sizeof(*row));
+	if (row == NULL)
+		err("calloc");
+
+	assert(row != NULL);
+
+	unsigned int flags = 0;
+	uint32_t run = 0;
+
+	for (unsigned int y = 0; y < d.height; y++) {
+		level_get_row(level, y, row);
+
+		for (unsigned int x = 0; x < d.width; x++) {
+			unsigned int f = row[x] & mask;
+
+			if (f == flags) {
+				run++;
+				continue;
+			}
+
+			if (run > 0)
+				_put_run(buffer, flags, run);
+
+			flags = f;
+			run = 1;
+		}
+	}
+
+	_put_run(buffer, flags, run);
+
+	free(row);
+}
+
+size_t
+rle_decode(const uint8_t *data, size_t size, struct level *level,
+    unsigned int mask)
+{
+	assert(data != NULL || size == 0);
+	assert(level != NULL);
+
+	struct coordinate_dimension d = level->dimension;
+
+	unsigned int *row = calloc(d.width, sizeof(*row));
+	if (row == NULL)
+		err("calloc");
+
+	assert(row != NULL);
+
+	size_t position = 0;
+	unsigned int flags = 0;
+	uint32_t run = 0;
+
+	for (unsigned int y = 0; y < d.height; y++) {
+		for (unsigned int x = 0; x < d.width; x++) {
+			if (run == 0) {
+				size_t n = _get_run(data + position,
+				    size - position, &flags, &run);
+
+				if (n == 0 || run == 0 || (flags & ~mask)) {
+					free(row);
+					return (0);
+				}
+
+				position += n;
+			}
+
+			row[x] = flags;
+			run--;
+		}
+
+		level_set_row(level, y, row);
+	}
+
+	free(row);
+
+	return (run == 0 ? position : 0);
+}
+
+static void
+_put_run(struct rle_buffer *buffer, unsigned int flags, uint32_t run)
+{
+	rle_reserve(buffer, 1 + VARINT_MAX);
+
+	buffer->data[buffer->size++] = flags;
+
+	while (run >= 0x80) {
+		buffer->data[buffer->size++] = (run & 0x7f) | 0x80;
+		run >>= 7;
+	}
+
+	buffer->data[buffer->size++] = run;
+}
+
+/*
+ * Returns the number of bytes of the run, 0 if it is truncated.
+ */
+static size_t
+_get_run(const uint8_t *data, size_t size, unsigned int *flags, uint32_t *run)
+{
+	if (size < 2)
+		return (0);
+
+	*flags = data[0];
+	*run = 0;
+
+	for (size_t i = 1; i < size && i <= VARINT_MAX; i++) {
+		*run |= (uint32_t)(data[i] & 0x7f) << (7 * (i - 1));
+
+		if (!(data[i] & 0x80))
+			return (i + 1);
+	}
+
+	return (0);
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <assert.h>
+#include <time.h>
+
+#include <sine_nomine/rng.h>
+
+static uint64_t _mix(uint64_t _value);
+
+/*
+ * This is the minimal PCG32 (XSH RR) generator as described at
+ * https://www.pcg-random.org/download.html
+ */
+void
+rng_seed(struct rng *rng, uint64_t seed, uint64_t stream)
+{
+	assert(rng != NULL);
+
+	rng->state = 0;
+	rng->increment = (stream << 1) | 1;
+
+	rng_next(rng);
+	rng->state += seed;
+	rng_next(rng);
+}
+
+uint32_t
+rng_next(struct rng *rng)
+{
+	uint64_t old = rng->state;
+	rng->state = old * 6364136223846793005ULL + rng->increment;
+
+	uint32_t xorshifted = ((old >> 18) ^ old) >> 27;
+	uint32_t rot = old >> 59;
+
+	return ((xorshifted >> rot) | (xorshifted << ((-rot) & 31)));
+}
+
+unsigned int
+rng_uniform(struct rng *rng, unsigned int bound)
+{
+	assert(bound > 0);
+
+	/*
+	 * Reject the lowest (2^32 % bound) values to avoid modulo bias.
+	 */
+	uint32_t threshold = -(uint32_t)bound % bound;
+
+	for (;;) {
+		uint32_t r = rng_next(rng);
+		if (r >= threshold)
+			return (r % bound);
+	}
+}
+
+uint64_t
+rng_derive(uint64_t seed, uint64_t index)
+{
+	return (_mix(seed ^ _mix(index)));
+}
+
+uint64_t
+rng_entropy(void)
+{
+	uint64_t seed = 0;
+
+	FILE *f = fopen("/dev/urandom", "r");
+	if (f != NULL) {
+		size_t n = fread(&seed, sizeof(seed), 1, f);
+		fclose(f);
+
+		if (n == 1)
+			return (seed);
+	}
+
+	return ((uint64_t)time(NULL) ^ ((uint64_t)clock() << 32));
+}
+
+/*
+ * The SplitMix64 finalizer.
+ */
+static uint64_t
+_mix(uint64_t z)
+{
+	z += UINT64_C(0x9e3779b97f4a7c15);
+	z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+	z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+
+	return (z ^ (z >> 31));
+}
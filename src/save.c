@@ -0,0 +1,359 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+
+#include <sine_nomine/coordinate.h>
+#include <sine_nomine/err.h>
+#include <sine_nomine/game.h>
+#include <sine_nomine/level.h>
+#include <sine_nomine/rle.h>
+#include <sine_nomine/save.h>
+
+/*
+ * Layout of a save, all numbers little endian:
+ *
+ *   magic "SNSV", version (1 byte)
+ *   configuration: seed (8 bytes), height, width, rooms, range, room size
+ *     min and max, torches min and max, generator (4 bytes each)
+ *   depth, player y, x and range (4 bytes each)
+ *   gameplay rng state and increment (8 bytes each), autoexplore (1 byte)
+ *   tiles (see rle.h)
+ */
+enum { VERSION = 1,
+	HEADER_SIZE = 4 + 1 + 8 + 9 * 4 + 4 * 4 + 2 * 8 + 1,
+	SAVED_FLAGS = TA_FLOOR | TA_WALL | TA_KNOWN | TA_TORCH | TA_STAIRS |
+	    TA_UPSTAIRS,
+};
+
+static const char _magic[4] = { 'S', 'N', 'S', 'V' };
+
+struct saver {
+	bool pending;
+	pthread_t thread;
+	const char *path;
+	struct save save;
+};
+
+struct cursor {
+	const uint8_t *data;
+	size_t size;
+	size_t position;
+	const char *path;
+};
+
+static void *_write(void *_saver);
+
+static void _wait(struct saver *_saver);
+
+static void _put_u8(struct rle_buffer *_buffer, uint8_t _value);
+
+static void _put_u32(struct rle_buffer *_buffer, uint32_t _value);
+
+static void _put_u64(struct rle_buffer *_buffer, uint64_t _value);
+
+static uint8_t _get_u8(struct cursor *_cursor);
+
+static uint32_t _get_u32(struct cursor *_cursor);
+
+static uint64_t _get_u64(struct cursor *_cursor);
+
+static bool _valid(const struct game_configuration *_config);
+
+void
+save_write(const char *path, const struct save *save)
+{
+	assert(path != NULL);
+	assert(save != NULL);
+
+	struct rle_buffer b = { NULL, 0, 0 };
+	rle_reserve(&b, HEADER_SIZE);
+
+	const struct game_configuration *c = &save->config;
+
+	for (size_t i = 0; i < sizeof(_magic); i++)
+		_put_u8(&b, _magic[i]);
+	_put_u8(&b, VERSION);
+
+	_put_u64(&b, c->seed);
+	_put_u32(&b, c->height);
+	_put_u32(&b, c->width);
+	_put_u32(&b, c->rooms);
+	_put_u32(&b, c->range);
+	_put_u32(&b, c->roomsize.min);
+	_put_u32(&b, c->roomsize.max);
+	_put_u32(&b, c->torches.min);
+	_put_u32(&b, c->torches.max);
+	_put_u32(&b, c->generator);
+
+	_put_u32(&b, save->depth);
+	_put_u32(&b, save->player.position.y);
+	_put_u32(&b, save->player.position.x);
+	_put_u32(&b, save->player.range);
+	_put_u64(&b, save->gameplay.state);
+	_put_u64(&b, save->gameplay.increment);
+	_put_u8(&b, save->autoexplore);
+
+	assert(b.size == HEADER_SIZE);
+	rle_encode(&b, save->level, SAVED_FLAGS);
+
+	char temporary[4096];
+	if (snprintf(temporary, sizeof(temporary), "%s.tmp", path) >=
+	    (int)sizeof(temporary))
+		die("error: path too long: %s\n", path);
+
+	FILE *f = fopen(temporary, "wb");
+	if (f == NULL)
+		err("fopen %s", temporary);
+
+	if (fwrite(b.data, b.size, 1, f) != 1)
+		err("fwrite %s", temporary);
+	if (fclose(f) != 0)
+		err("fclose %s", temporary);
+	if (rename(temporary, path) != 0)
+		err("rename %s", temporary);
+
+	free(b.data);
+}
+
+bool
+save_read(const char *path, struct save *save)
+{
+	assert(path != NULL);
+	assert(save != NULL);
+
+	FILE *f = fopen(path, "rb");
+	if (f == NULL) {
+		if (errno == ENOENT)
+			return (false);
+
+		err("fopen %s", path);
+	}
+
+	if (fseek(f, 0, SEEK_END) != 0)
+		err("fseek %s", path);
+
+	long size = ftell(f);
+	if (size < 0)
+		err("ftell %s", path);
+
+	rewind(f);
+
+	uint8_t *data = malloc(size > 0 ? size : 1);
+	if (data == NULL)
+		err("malloc");
+
+	assert(data != NULL);
+
+	if (size > 0 && fread(data, size, 1, f) != 1)
+		err("fread %s", path);
+	fclose(f);
+
+	struct cursor cursor = { data, size, 0, path };
+	struct cursor *r = &cursor;
+
+	for (size_t i = 0; i < sizeof(_magic); i++) {
+		if (_get_u8(r) != (uint8_t)_magic[i])
+			die("error: %s is no save\n", path);
+	}
+	if (_get_u8(r) != VERSION)
+		die("error: %s has an unknown version\n", path);
+
+	struct game_configuration *c = &save->config;
+	c->seed = _get_u64(r);
+	c->height = _get_u32(r);
+	c->width = _get_u32(r);
+	c->rooms = _get_u32(r);
+	c->range = _get_u32(r);
+	c->roomsize.min = _get_u32(r);
+	c->roomsize.max = _get_u32(r);
+	c->torches.min = _get_u32(r);
+	c->torches.max = _get_u32(r);
+	c->generator = _get_u32(r);
+
+	save->depth = _get_u32(r);
+	save->player.position.y = _get_u32(r);
+	save->player.position.x = _get_u32(r);
+	save->player.range = _get_u32(r);
+	save->gameplay.state = _get_u64(r);
+	save->gameplay.increment = _get_u64(r);
+	save->autoexplore = _get_u8(r);
+
+	struct coordinate_dimension d = { c->height, c->width };
+	if (d.height == 0 || d.width == 0 ||
+	    !coordinate_check_bounds(d, save->player.position))
+		die("error: %s is corrupt\n", path);
+	if (!_valid(c))
+		die("error: %s is corrupt\n", path);
+
+	save->level = level_create(d);
+
+	size_t n = rle_decode(r->data + r->position, r->size - r->position,
+	    save->level, SAVED_FLAGS);
+	if (n == 0 || r->position + n != r->size)
+		die("error: %s is corrupt\n", path);
+
+	free(data);
+
+	return (true);
+}
+
+struct saver *
+saver_create()
+{
+	struct saver *s = calloc(1, sizeof(struct saver));
+	if (s == NULL)
+		err("calloc");
+
+	assert(s != NULL);
+
+	return (s);
+}
+
+void
+saver_destroy(struct saver *saver)
+{
+	assert(saver != NULL);
+
+	_wait(saver);
+	free(saver);
+}
+
+void
+saver_write(struct saver *saver, const char *path, const struct save *save)
+{
+	assert(saver != NULL);
+	assert(path != NULL);
+	assert(save != NULL);
+
+	_wait(saver);
+
+	saver->path = path;
+	saver->save = *save;
+	saver->save.level = level_snapshot(save->level);
+
+	if (pthread_create(&saver->thread, NULL, _write, saver) != 0)
+		err("pthread_create");
+
+	saver->pending = true;
+}
+
+static void *
+_write(void *arg)
+{
+	struct saver *s = arg;
+
+	save_write(s->path, &s->save);
+	level_destroy(s->save.level);
+
+	return (NULL);
+}
+
+static void
+_wait(struct saver *saver)
+{
+	if (!saver->pending)
+		return;
+
+	pthread_join(saver->thread, NULL);
+	saver->pending = false;
+}
+
+static void
+_put_u8(struct rle_buffer *buffer, uint8_t value)
+{
+	rle_reserve(buffer, 1);
+	buffer->data[buffer->size++] = value;
+}
+
+static void
+_put_u32(struct rle_buffer *buffer, uint32_t value)
+{
+	for (int i = 0; i < 4; i++)
+		_put_u8(buffer, value >> (8 * i) & 0xff);
+}
+
+static void
+_put_u64(struct rle_buffer *buffer, uint64_t value)
+{
+	_put_u32(buffer, value & 0xffffffff);
+	_put_u32(buffer, value >> 32);
+}
+
+static uint8_t
+_get_u8(struct cursor *cursor)
+{
+	if (cursor->position == cursor->size)
+		die("error: %s is truncated\n", cursor->path);
+
+	return (cursor->data[cursor->position++]);
+}
+
+static uint32_t
+_get_u32(struct cursor *cursor)
+{
+	uint32_t value = 0;
+	for (int i = 0; i < 4; i++)
+		value |= (uint32_t)_get_u8(cursor) << (8 * i);
+
+	return (value);
+}
+
+static uint64_t
+_get_u64(struct cursor *cursor)
+{
+	uint64_t low = _get_u32(cursor);
+	uint64_t high = _get_u32(cursor);
+
+	return (high << 32 | low);
+}
+
+/*
+ * Rejects what the generators cannot cope with: they would assert, or look for
+ * floor tiles forever. The world is never saved.
+ */
+static bool
+_valid(const struct game_configuration *config)
+{
+	const struct game_configuration *c = config;
+
+	if (c->generator != DG_ROOMS && c->generator != DG_BSP &&
+	    c->generator != DG_CAVE)
+		return (false);
+	if (c->generator == DG_ROOMS && c->rooms == 0)
+		return (false);
+
+	/* Rooms fit between the borders, and BSP can still split them off. */
+	unsigned int side = c->height < c->width ? c->height : c->width;
+	if (side < 4 || c->roomsize.min == 0 ||
+	    c->roomsize.min > c->roomsize.max || c->roomsize.max > side - 3)
+		return (false);
+
+	if (c->torches.min > c->torches.max ||
+	    c->torches.max > (uint64_t)c->height * c->width)
+		return (false);
+
+	return (true);
+}
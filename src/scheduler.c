@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <assert.h>
+
+#include <sine_nomine/err.h>
+#include <sine_nomine/scheduler.h>
+
+enum { BUCKET_INITIAL_CAPACITY = 8,
+	ACTORS_INITIAL_CAPACITY = 64,
+};
+
+/*
+ * Removing an actor only bumps its serial, its entry is dropped once its bucket
+ * comes up. Entries with an outdated serial are skipped.
+ */
+struct entry {
+	unsigned int actor;
+	unsigned int serial;
+};
+
+struct bucket {
+	struct entry *entries;
+	unsigned int head;
+	unsigned int count;
+	unsigned int capacity;
+};
+
+struct actor {
+	unsigned int serial;
+	bool scheduled;
+};
+
+struct scheduler {
+	unsigned long time;
+	unsigned int count;
+	struct bucket buckets[SCHEDULER_HORIZON];
+	struct actor *actors;
+	unsigned int capacity;
+};
+
+static void _reserve_actor(struct scheduler *_scheduler, unsigned int _actor);
+
+static void _push(struct bucket *_bucket, struct entry _entry);
+
+struct scheduler *
+scheduler_create()
+{
+	struct scheduler *s = calloc(1, sizeof(struct scheduler));
+	if (s == NULL)
+		err("calloc");
+
+	assert(s != NULL);
+
+	return (s);
+}
+
+void
+scheduler_destroy(struct scheduler *scheduler)
+{
+	assert(scheduler != NULL);
+
+	for (unsigned int i = 0; i < SCHEDULER_HORIZON; i++)
+		free(scheduler->buckets[i].entries);
+	free(scheduler->actors);
+	free(scheduler);
+}
+
+void
+scheduler_add(struct scheduler *scheduler, unsigned int actor,
+    unsigned long delay)
+{
+	assert(scheduler != NULL);
+	assert(delay < SCHEDULER_HORIZON);
+
+	struct scheduler *s = scheduler;
+
+	_reserve_actor(s, actor);
+	assert(!s->actors[actor].scheduled);
+
+	struct actor *a = &s->actors[actor];
+	a->serial++;
+	a->scheduled = true;
+
+	struct entry e = { actor, a->serial };
+	_push(&s->buckets[(s->time + delay) % SCHEDULER_HORIZON], e);
+	s->count++;
+}
+
+void
+scheduler_remove(struct scheduler *scheduler, unsigned int actor)
+{
+	assert(scheduler != NULL);
+
+	if (!scheduler_is_scheduled(scheduler, actor))
+		return;
+
+	struct actor *a = &scheduler->actors[actor];
+	a->serial++;
+	a->scheduled = false;
+	scheduler->count--;
+}
+
+bool
+scheduler_is_scheduled(struct scheduler *scheduler, unsigned int actor)
+{
+	assert(scheduler != NULL);
+
+	return (actor < scheduler->capacity &&
+	    scheduler->actors[actor].scheduled);
+}
+
+bool
+scheduler_next(struct scheduler *scheduler, unsigned int *actor)
+{
+	assert(scheduler != NULL);
+	assert(actor != NULL);
+
+	struct scheduler *s = scheduler;
+
+	if (s->count == 0)
+		return (false);
+
+	for (;;) {
+		struct bucket *b = &s->buckets[s->time % SCHEDULER_HORIZON];
+
+		while (b->head < b->count) {
+			struct entry e = b->entries[b->head++];
+			struct actor *a = &s->actors[e.actor];
+			if (!a->scheduled || a->serial != e.serial)
+				continue;
+
+			if (b->head == b->count)
+				b->head = b->count = 0;
+
+			a->scheduled = false;
+			s->count--;
+			*actor = e.actor;
+
+			return (true);
+		}
+
+		b->head = b->count = 0;
+		s->time++;
+	}
+}
+
+unsigned long
+scheduler_get_time(struct scheduler *scheduler)
+{
+	assert(scheduler != NULL);
+
+	return (scheduler->time);
+}
+
+unsigned int
+scheduler_count(struct scheduler *scheduler)
+{
+	assert(scheduler != NULL);
+
+	return (scheduler->count);
+}
+
+unsigned long
+scheduler_delay(unsigned int speed)
+{
+	assert(speed > 0);
+
+	unsigned long delay =
+	    (unsigned long)SCHEDULER_TURN * SCHEDULER_NORMAL_SPEED / speed;
+	assert(delay < SCHEDULER_HORIZON);
+
+	return (delay);
+}
+
+static void
+_reserve_actor(struct scheduler *scheduler, unsigned int actor)
+{
+	struct scheduler *s = scheduler;
+
+	if (actor < s->capacity)
+		return;
+
+	unsigned int capacity =
+	    s->capacity ? s->capacity : ACTORS_INITIAL_CAPACITY;
+	while (capacity <= actor)
+		capacity *= 2;
+
+	s->actors = realloc(s->actors, capacity * sizeof(*s->actors));
+	if (s->actors == NULL)
+		err("realloc");
+
+	assert(s->actors != NULL);
+
+	memset(s->actors + s->capacity, 0,
+	    (capacity - s->capacity) * sizeof(*s->actors));
+	s->capacity = capacity;
+}
+
+static void
+_push(struct bucket *bucket, struct entry entry)
+{
+	struct bucket *b = bucket;
+
+	if (b->count == b->capacity) {
+		b->capacity = b->capacity ? b->capacity * 2
+					  : BUCKET_INITIAL_CAPACITY;
+
+		b->entries =
+		    realloc(b->entries, b->capacity * sizeof(*b->entries));
+		if (b->entries == NULL)
+			err("realloc");
+
+		assert(b->entries != NULL);
+	}
+
+	b->entries[b->count++] = entry;
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <assert.h>
+
+#include <sine_nomine/coordinate.h>
+#include <sine_nomine/err.h>
+#include <sine_nomine/tileset.h>
+
+enum { MEMBERS_INITIAL_CAPACITY = 64,
+};
+
+static size_t _slot(struct tileset *_set, struct coordinate _position);
+
+struct tileset *
+tileset_create(struct coordinate_dimension dimension)
+{
+	struct tileset *s = calloc(1, sizeof(struct tileset));
+	if (s == NULL)
+		err("calloc");
+
+	assert(s != NULL);
+
+	s->dimension = dimension;
+
+	/* slots[i] holds the index of the member plus one, 0 if absent. */
+	s->slots = calloc(
+	    (size_t)dimension.height * dimension.width, sizeof(*s->slots));
+	if (s->slots == NULL)
+		err("calloc");
+
+	assert(s->slots != NULL);
+
+	return (s);
+}
+
+void
+tileset_destroy(struct tileset *set)
+{
+	assert(set != NULL);
+
+	free(set->members);
+	free(set->slots);
+	free(set);
+}
+
+bool
+tileset_add(struct tileset *set, struct coordinate position)
+{
+	assert(set != NULL);
+
+	size_t i = _slot(set, position);
+	if (set->slots[i] != 0)
+		return (false);
+
+	if (set->count == set->capacity) {
+		set->capacity = set->capacity ? set->capacity * 2
+					      : MEMBERS_INITIAL_CAPACITY;
+
+		set->members = realloc(
+		    set->members, set->capacity * sizeof(*set->members));
+		if (set->members == NULL)
+			err("realloc");
+
+		assert(set->members != NULL);
+	}
+
+	set->members[set->count++] = position;
+	set->slots[i] = set->count;
+
+	return (true);
+}
+
+bool
+tileset_remove(struct tileset *set, struct coordinate position)
+{
+	assert(set != NULL);
+
+	size_t i = _slot(set, position);
+	if (set->slots[i] == 0)
+		return (false);
+
+	/* Move the last member into the gap. */
+	unsigned int gap = set->slots[i] - 1;
+	struct coordinate last = set->members[--set->count];
+
+	set->members[gap] = last;
+	set->slots[_slot(set, last)] = gap + 1;
+	set->slots[i] = 0;
+
+	return (true);
+}
+
+bool
+tileset_contains(struct tileset *set, struct coordinate position)
+{
+	assert(set != NULL);
+
+	return (set->slots[_slot(set, position)] != 0);
+}
+
+void
+tileset_clear(struct tileset *set)
+{
+	assert(set != NULL);
+
+	for (unsigned int i = 0; i < set->count; i++)
+		set->slots[_slot(set, set->members[i])] = 0;
+
+	set->count = 0;
+}
+
+static size_t
+_slot(struct tileset *set, struct coordinate position)
+{
+	assert(coordinate_check_bounds(set->dimension, position));
+
+	return ((size_t)position.y * set->dimension.width + position.x);
+}
@@ -26,7 +26,9 @@ enum { CP_VISIBLE = 1,
 };
 
 struct ui_context {
-	WINDOW *window;
+	WINDOW *window; /* NULL if headless */
+	int timeout;
+	const char *script;
 };
 
 /*
@@ -40,6 +42,8 @@ static struct ui_context *_ui_context = NULL;
 static struct coordinate_dimension _screen_dimension(
     struct ui_context *_ui_context);
 
+static UI_ACTION _key_action(int _c);
+
 struct ui_context *
 ui_create(void)
 {
@@ -51,6 +55,7 @@ ui_create(void)
 	assert(c != NULL);
 
 	c->window = initscr();
+	c->timeout = -1;
 	cbreak();
 	noecho();
 	keypad(c->window, TRUE);
@@ -61,13 +66,31 @@ ui_create(void)
 	return (c);
 }
 
+struct ui_context *
+ui_create_headless(const char *script)
+{
+	struct ui_context *c = _ui_context =
+	    calloc(1, sizeof(struct ui_context));
+	if (c == NULL)
+		err("calloc");
+
+	assert(c != NULL);
+
+	c->script = script;
+
+	return (c);
+}
+
 void
 ui_destroy(struct ui_context *context)
 {
 	assert(context != NULL);
 
 	_ui_context = NULL;
-	endwin();
+	if (context->window != NULL)
+		endwin();
+
+	free(context);
 }
 
 void
@@ -77,29 +100,35 @@ ui_display(
 	assert(context != NULL);
 	assert(level != NULL);
 
+	if (context->window == NULL)
+		return;
+
 	struct coordinate_dimension screen = _screen_dimension(context);
 	struct coordinate center = { screen.height / 2, screen.width / 2 };
 
 	struct coordinate_offset offset =
 	    coordinate_get_offset(center, player.position);
 
+	/* Only the part of the level that is on the screen is looked at. */
+	unsigned int top, bottom, left, right;
+	coordinate_clip(
+	    level->dimension.height, screen.height, offset.y, &top, &bottom);
+	coordinate_clip(
+	    level->dimension.width, screen.width, offset.x, &left, &right);
+
 	werase(context->window);
-	for (unsigned int y = 0; y < level->dimension.height; y++) {
-		for (unsigned int x = 0; x < level->dimension.width; x++) {
+	for (unsigned int y = top; y < bottom; y++) {
+		for (unsigned int x = left; x < right; x++) {
 			struct coordinate tile = { y, x };
-
-			if (!coordinate_check_bounds_offset(
-				screen, tile, offset))
-				continue;
-
 			struct coordinate screen_coordinate =
 			    coordinate_add_offset(tile, offset);
 
-			if (!(level->tiles[y][x].flags & TA_KNOWN))
+			unsigned int flags = level_get_flags(level, tile);
+			if (!(flags & TA_KNOWN))
 				continue;
 
 			wattrset(context->window, A_NORMAL);
-			if (level->tiles[tile.y][tile.x].flags & TA_VISIBLE) {
+			if (flags & TA_VISIBLE) {
 				wattron(
 				    context->window, COLOR_PAIR(CP_VISIBLE));
 
@@ -107,10 +136,16 @@ ui_display(
 			}
 
 			char t = '#';
-			if (level->tiles[tile.y][tile.x].flags & TA_FLOOR)
+			if (flags & TA_FLOOR)
 				t = '.';
-			if (level->tiles[tile.y][tile.x].flags & TA_TORCH)
+			if (flags & TA_TORCH)
 				t = 'T';
+			if (flags & TA_STAIRS)
+				t = '>';
+			if (flags & TA_UPSTAIRS)
+				t = '<';
+			if ((flags & TA_OCCUPIED) && (flags & TA_VISIBLE))
+				t = 'm';
 
 			mvwaddch(context->window, screen_coordinate.y,
 			    screen_coordinate.x, t);
@@ -127,16 +162,59 @@ ui_display(
 void
 ui_timeout(struct ui_context *context, unsigned int timeout)
 {
+	if (context->window == NULL)
+		return;
+
+	context->timeout = timeout;
 	wtimeout(context->window, timeout);
 }
 
+bool
+ui_input_pending(struct ui_context *context)
+{
+	assert(context != NULL);
+
+	if (context->window == NULL)
+		return (context->script != NULL && *context->script != '\0');
+
+	wtimeout(context->window, 0);
+	int c = wgetch(context->window);
+	wtimeout(context->window, context->timeout);
+
+	if (c == ERR)
+		return (false);
+
+	ungetch(c);
+
+	return (true);
+}
+
 UI_ACTION
 ui_get_action(struct ui_context *context)
 {
 	assert(context != NULL);
 
-	int c = wgetch(context->window);
+	if (context->window != NULL)
+		return (_key_action(wgetch(context->window)));
+
+	if (context->script == NULL || *context->script == '\0')
+		return (UA_TIMEOUT);
+
+	return (_key_action(*context->script++));
+}
+
+void
+ui_emergency_exit(void)
+{
+	if (_ui_context == NULL)
+		return;
+
+	ui_destroy(_ui_context);
+}
 
+static UI_ACTION
+_key_action(int c)
+{
 	switch (c) {
 	case KEY_UP:
 	case 'k':
@@ -157,6 +235,15 @@ ui_get_action(struct ui_context *context)
 	case 'a':
 		return (UA_AUTOEXPLORE);
 
+	case '>':
+		return (UA_DESCEND);
+
+	case '<':
+		return (UA_ASCEND);
+
+	case KEY_RESIZE:
+		return (UA_RESIZE);
+
 	case 'q':
 		return (UA_QUIT);
 
@@ -167,15 +254,6 @@ ui_get_action(struct ui_context *context)
 	return (UA_UNKNOWN);
 }
 
-void
-ui_emergency_exit(void)
-{
-	if (_ui_context == NULL)
-		return;
-
-	ui_destroy(_ui_context);
-}
-
 static struct coordinate_dimension
 _screen_dimension(struct ui_context *context)
 {
@@ -0,0 +1,731 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <pthread.h>
+
+#include <sine_nomine/coordinate.h>
+#include <sine_nomine/dungeon.h>
+#include <sine_nomine/err.h>
+#include <sine_nomine/level.h>
+#include <sine_nomine/rng.h>
+#include <sine_nomine/world.h>
+
+enum { SLOTS_INITIAL_CAPACITY = 64,
+	REQUESTS_INITIAL_CAPACITY = 64,
+	ROOM_MIN = 4,
+	ROOM_MAX = 12,
+};
+
+/* Hash domains, so that chunk seeds and gates do not correlate. */
+enum { HASH_CHUNK = 1,
+	HASH_GATE_HORIZONTAL = 2,
+	HASH_GATE_VERTICAL = 3,
+};
+
+enum _chunk_state {
+	CS_EMPTY = 0,
+	CS_QUEUED,
+	CS_GENERATING,
+	CS_READY,
+};
+
+struct _key {
+	int32_t y;
+	int32_t x;
+};
+
+struct _slot {
+	struct _key key;
+	enum _chunk_state state;
+	struct level *level;
+};
+
+/* A FIFO of chunks waiting for the background thread. */
+struct _requests {
+	unsigned int capacity;
+	unsigned int head;
+	unsigned int elements;
+	struct _key *keys;
+};
+
+/*
+ * The chunks are kept in an open addressing hash table with linear probing.
+ * The table, the requests and the statistics are protected by the lock. Only
+ * the creating thread inserts ready chunks or evicts them, so it may use a
+ * ready level without holding the lock.
+ */
+struct world {
+	uint64_t seed;
+	unsigned int radius;
+
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+	pthread_t worker;
+	bool quit;
+
+	unsigned int capacity;
+	unsigned int used;
+	struct _slot *slots;
+
+	struct _requests requests;
+	struct world_statistics statistics;
+
+	bool centered;
+	struct _key center;
+
+	/* The chunk read last, to skip the lookup for neighboring tiles. */
+	struct _key last_key;
+	struct level *last_level;
+};
+
+static void *_worker(void *_world);
+
+static struct level *_acquire(struct world *_world, struct _key _key);
+
+static void _finish(
+    struct world *_world, struct _key _key, struct level *_level);
+
+static void _evict(struct world *_world, struct _key _center);
+
+static void _request(struct world *_world, struct _key _key);
+
+static struct _slot *_find(struct world *_world, struct _key _key);
+
+static struct _slot *_insert(struct world *_world, struct _key _key);
+
+static void _remove(struct world *_world, unsigned int _index);
+
+static void _grow(struct world *_world);
+
+static unsigned int _probe(
+    struct _slot _slots[], unsigned int _capacity, struct _key _key);
+
+static void _push_request(struct _requests *_requests, struct _key _key);
+
+static struct _key _pop_request(struct _requests *_requests);
+
+static struct level *_generate_chunk(uint64_t _seed, struct _key _key);
+
+static void _open_gate(struct level *_level, struct coordinate _gate,
+    struct coordinate_offset _inward);
+
+static struct coordinate _nearest_floor(
+    struct level *_level, struct coordinate _from);
+
+static void _carve_line(
+    struct level *_level, struct coordinate _from, struct coordinate _to);
+
+static unsigned int _gate(
+    uint64_t _seed, uint64_t _domain, int32_t _y, int32_t _x);
+
+static struct _key _chunk_of(struct world_position _position);
+
+static int32_t _floor_div(int64_t _value);
+
+static unsigned int _distance(struct _key _a, struct _key _b);
+
+static bool _equal(struct _key _a, struct _key _b);
+
+static uint64_t _hash(uint64_t _seed, uint64_t _domain, int32_t _y, int32_t _x);
+
+static uint64_t _mix(uint64_t _value);
+
+struct world *
+world_create(uint64_t seed, unsigned int radius)
+{
+	struct world *w = calloc(1, sizeof(struct world));
+	if (w == NULL)
+		err("calloc");
+
+	assert(w != NULL);
+
+	w->seed = seed;
+	w->radius = radius;
+
+	w->capacity = SLOTS_INITIAL_CAPACITY;
+	w->slots = calloc(w->capacity, sizeof(*w->slots));
+	if (w->slots == NULL)
+		err("calloc");
+
+	assert(w->slots != NULL);
+
+	if (pthread_mutex_init(&w->lock, NULL) != 0)
+		err("pthread_mutex_init");
+	if (pthread_cond_init(&w->changed, NULL) != 0)
+		err("pthread_cond_init");
+	if (pthread_create(&w->worker, NULL, _worker, w) != 0)
+		err("pthread_create");
+
+	return (w);
+}
+
+void
+world_destroy(struct world *world)
+{
+	assert(world != NULL);
+
+	pthread_mutex_lock(&world->lock);
+	world->quit = true;
+	pthread_cond_broadcast(&world->changed);
+	pthread_mutex_unlock(&world->lock);
+
+	pthread_join(world->worker, NULL);
+
+	for (unsigned int i = 0; i < world->capacity; i++) {
+		if (world->slots[i].state == CS_READY)
+			level_destroy(world->slots[i].level);
+	}
+
+	pthread_cond_destroy(&world->changed);
+	pthread_mutex_destroy(&world->lock);
+
+	free(world->requests.keys);
+	free(world->slots);
+	free(world);
+}
+
+void
+world_update(struct world *world, struct world_position player)
+{
+	assert(world != NULL);
+
+	struct _key center = _chunk_of(player);
+	if (world->centered && _equal(center, world->center))
+		return;
+
+	world->centered = true;
+	world->center = center;
+
+	pthread_mutex_lock(&world->lock);
+
+	_evict(world, center);
+
+	int r = world->radius;
+	for (int d = 0; d <= r; d++) {
+		for (int dy = -d; dy <= d; dy++) {
+			for (int dx = -d; dx <= d; dx++) {
+				if (abs(dy) != d && abs(dx) != d)
+					continue;
+
+				struct _key k = { center.y + dy,
+					center.x + dx };
+				_request(world, k);
+			}
+		}
+	}
+
+	pthread_cond_broadcast(&world->changed);
+	pthread_mutex_unlock(&world->lock);
+}
+
+unsigned int
+world_get_flags(struct world *world, struct world_position position)
+{
+	assert(world != NULL);
+
+	struct _key k = _chunk_of(position);
+
+	if (world->last_level == NULL || !_equal(k, world->last_key)) {
+		world->last_level = _acquire(world, k);
+		world->last_key = k;
+	}
+
+	struct coordinate c = {
+		position.y - (int64_t)k.y * WORLD_CHUNK_SIZE,
+		position.x - (int64_t)k.x * WORLD_CHUNK_SIZE,
+	};
+
+	return (level_get_flags(world->last_level, c));
+}
+
+struct level *
+world_window(struct world *world, struct world_position origin,
+    struct coordinate_dimension dimension)
+{
+	assert(world != NULL);
+
+	struct level *l = level_create(dimension);
+
+	unsigned int *row = calloc(dimension.width, sizeof(*row));
+	if (row == NULL)
+		err("calloc");
+
+	assert(row != NULL);
+
+	for (unsigned int y = 0; y < dimension.height; y++) {
+		for (unsigned int x = 0; x < dimension.width; x++) {
+			struct world_position p = { origin.y + y,
+				origin.x + x };
+			row[x] = world_get_flags(world, p);
+		}
+
+		level_set_row(l, y, row);
+	}
+
+	free(row);
+
+	return (l);
+}
+
+struct world_statistics
+world_get_statistics(struct world *world)
+{
+	assert(world != NULL);
+
+	pthread_mutex_lock(&world->lock);
+	struct world_statistics s = world->statistics;
+	s.resident = world->used;
+	pthread_mutex_unlock(&world->lock);
+
+	return (s);
+}
+
+static void *
+_worker(void *arg)
+{
+	struct world *w = arg;
+
+	pthread_mutex_lock(&w->lock);
+	for (;;) {
+		while (!w->quit && w->requests.elements == 0)
+			pthread_cond_wait(&w->changed, &w->lock);
+
+		if (w->quit)
+			break;
+
+		/* The chunk may have been evicted or read in the meantime. */
+		struct _key k = _pop_request(&w->requests);
+		struct _slot *s = _find(w, k);
+		if (s == NULL || s->state != CS_QUEUED)
+			continue;
+
+		s->state = CS_GENERATING;
+		pthread_mutex_unlock(&w->lock);
+
+		struct level *l = _generate_chunk(w->seed, k);
+
+		pthread_mutex_lock(&w->lock);
+		_finish(w, k, l);
+	}
+	pthread_mutex_unlock(&w->lock);
+
+	return (NULL);
+}
+
+/*
+ * Returns the level of a chunk, generating it on the spot if the background
+ * thread did not get to it yet, or waiting for it if it is at it right now.
+ */
+static struct level *
+_acquire(struct world *world, struct _key key)
+{
+	pthread_mutex_lock(&world->lock);
+
+	struct _slot *s = _find(world, key);
+	if (s == NULL)
+		s = _insert(world, key);
+
+	if (s->state != CS_READY)
+		world->statistics.stalls++;
+
+	if (s->state == CS_QUEUED) {
+		s->state = CS_GENERATING;
+		pthread_mutex_unlock(&world->lock);
+
+		struct level *l = _generate_chunk(world->seed, key);
+
+		pthread_mutex_lock(&world->lock);
+		_finish(world, key, l);
+	}
+
+	while ((s = _find(world, key))->state != CS_READY)
+		pthread_cond_wait(&world->changed, &world->lock);
+
+	struct level *l = s->level;
+	pthread_mutex_unlock(&world->lock);
+
+	return (l);
+}
+
+static void
+_finish(struct world *world, struct _key key, struct level *level)
+{
+	struct _slot *s = _find(world, key);
+	assert(s != NULL);
+	assert(s->state == CS_GENERATING);
+
+	s->level = level;
+	s->state = CS_READY;
+	world->statistics.generated++;
+
+	pthread_cond_broadcast(&world->changed);
+}
+
+/*
+ * Drops ready and queued chunks more than radius + 1 chunks away from the
+ * center. Chunks that are being generated are left alone, they are dropped by
+ * a later update.
+ */
+static void
+_evict(struct world *world, struct _key center)
+{
+	for (unsigned int i = 0; i < world->capacity;) {
+		struct _slot *s = &world->slots[i];
+
+		if ((s->state != CS_READY && s->state != CS_QUEUED) ||
+		    _distance(s->key, center) <= world->radius + 1) {
+			i++;
+			continue;
+		}
+
+		if (s->state == CS_READY) {
+			if (s->level == world->last_level)
+				world->last_level = NULL;
+
+			level_destroy(s->level);
+			world->statistics.evicted++;
+		}
+
+		/* _remove() may move another slot to i, look at it again. */
+		_remove(world, i);
+	}
+}
+
+static void
+_request(struct world *world, struct _key key)
+{
+	if (_find(world, key) != NULL)
+		return;
+
+	_insert(world, key);
+	_push_request(&world->requests, key);
+}
+
+static struct _slot *
+_find(struct world *world, struct _key key)
+{
+	unsigned int i = _probe(world->slots, world->capacity, key);
+	if (world->slots[i].state == CS_EMPTY)
+		return (NULL);
+
+	return (&world->slots[i]);
+}
+
+static struct _slot *
+_insert(struct world *world, struct _key key)
+{
+	/* Keep the load factor below one half. */
+	if ((world->used + 1) * 2 > world->capacity)
+		_grow(world);
+
+	unsigned int i = _probe(world->slots, world->capacity, key);
+	assert(world->slots[i].state == CS_EMPTY);
+
+	world->slots[i] = (struct _slot) { .key = key, .state = CS_QUEUED };
+	world->used++;
+
+	return (&world->slots[i]);
+}
+
+/*
+ * Removes a slot by shifting the following slots of the probe sequence back,
+ * so that no tombstones are needed.
+ */
+static void
+_remove(struct world *world, unsigned int index)
+{
+	unsigned int mask = world->capacity - 1;
+
+	world->slots[index].state = CS_EMPTY;
+	world->used--;
+
+	unsigned int j = index;
+	for (;;) {
+		j = (j + 1) & mask;
+		if (world->slots[j].state == CS_EMPTY)
+			break;
+
+		struct _key k = world->slots[j].key;
+		unsigned int home = _hash(0, 0, k.y, k.x) & mask;
+
+		/* Stay if the home slot lies cyclically in (index, j]. */
+		if (index <= j ? (index < home && home <= j)
+			       : (index < home || home <= j))
+			continue;
+
+		world->slots[index] = world->slots[j];
+		world->slots[j].state = CS_EMPTY;
+		index = j;
+	}
+}
+
+static void
+_grow(struct world *world)
+{
+	unsigned int capacity = world->capacity * 2;
+
+	struct _slot *slots = calloc(capacity, sizeof(*slots));
+	if (slots == NULL)
+		err("calloc");
+
+	assert(slots != NULL);
+
+	for (unsigned int i = 0; i < world->capacity; i++) {
+		struct _slot *s = &world->slots[i];
+		if (s->state == CS_EMPTY)
+			continue;
+
+		slots[_probe(slots, capacity, s->key)] = *s;
+	}
+
+	free(world->slots);
+	world->slots = slots;
+	world->capacity = capacity;
+}
+
+/*
+ * Returns the slot holding _key, or the empty slot where it belongs.
+ */
+static unsigned int
+_probe(struct _slot slots[], unsigned int capacity, struct _key key)
+{
+	unsigned int mask = capacity - 1;
+	unsigned int i = _hash(0, 0, key.y, key.x) & mask;
+
+	while (slots[i].state != CS_EMPTY && !_equal(slots[i].key, key))
+		i = (i + 1) & mask;
+
+	return (i);
+}
+
+static void
+_push_request(struct _requests *requests, struct _key key)
+{
+	if (requests->elements == requests->capacity) {
+		unsigned int capacity = requests->capacity
+		    ? requests->capacity * 2
+		    : REQUESTS_INITIAL_CAPACITY;
+
+		struct _key *keys = calloc(capacity, sizeof(*keys));
+		if (keys == NULL)
+			err("calloc");
+
+		assert(keys != NULL);
+
+		for (unsigned int i = 0; i < requests->elements; i++) {
+			keys[i] = requests->keys[(requests->head + i) %
+			    requests->capacity];
+		}
+
+		free(requests->keys);
+		requests->keys = keys;
+		requests->capacity = capacity;
+		requests->head = 0;
+	}
+
+	unsigned int tail =
+	    (requests->head + requests->elements) % requests->capacity;
+	requests->keys[tail] = key;
+	requests->elements++;
+}
+
+static struct _key
+_pop_request(struct _requests *requests)
+{
+	assert(requests->elements > 0);
+
+	struct _key k = requests->keys[requests->head];
+	requests->head = (requests->head + 1) % requests->capacity;
+	requests->elements--;
+
+	return (k);
+}
+
+/*
+ * A chunk is a BSP dungeon with one gate in every border. The position of a
+ * gate only depends on the seed and the border it lies in, so both chunks
+ * sharing a border open the same gate. Every gate is connected to the nearest
+ * floor tile of the chunk.
+ */
+static struct level *
+_generate_chunk(uint64_t seed, struct _key key)
+{
+	struct coordinate_dimension d = { WORLD_CHUNK_SIZE, WORLD_CHUNK_SIZE };
+	struct level *l = level_create(d);
+
+	struct rng rng;
+	rng_seed(&rng, _hash(seed, HASH_CHUNK, key.y, key.x),
+	    RNG_STREAM_WORLD);
+
+	struct coordinate_dimension min = { ROOM_MIN, ROOM_MIN };
+	struct coordinate_dimension max = { ROOM_MAX, ROOM_MAX };
+	dungeon_generate_bsp(l, &rng, min, max);
+
+	unsigned int last = WORLD_CHUNK_SIZE - 1;
+
+	struct coordinate top = { 0,
+		_gate(seed, HASH_GATE_HORIZONTAL, key.y, key.x) };
+	struct coordinate bottom = { last,
+		_gate(seed, HASH_GATE_HORIZONTAL, key.y + 1, key.x) };
+	struct coordinate left = {
+		_gate(seed, HASH_GATE_VERTICAL, key.y, key.x), 0
+	};
+	struct coordinate right = {
+		_gate(seed, HASH_GATE_VERTICAL, key.y, key.x + 1), last
+	};
+
+	_open_gate(l, top, (struct coordinate_offset) { 1, 0 });
+	_open_gate(l, bottom, (struct coordinate_offset) { -1, 0 });
+	_open_gate(l, left, (struct coordinate_offset) { 0, 1 });
+	_open_gate(l, right, (struct coordinate_offset) { 0, -1 });
+
+	return (l);
+}
+
+/*
+ * Opens the gate and carves an L shaped corridor to the nearest floor tile,
+ * leaving the border straight away.
+ */
+static void
+_open_gate(struct level *level, struct coordinate gate,
+    struct coordinate_offset inward)
+{
+	level_set_flags(level, gate, TA_FLOOR);
+
+	struct coordinate from = coordinate_add_offset(gate, inward);
+	struct coordinate to = _nearest_floor(level, from);
+
+	struct coordinate corner = from;
+	if (inward.y != 0)
+		corner.y = to.y;
+	else
+		corner.x = to.x;
+
+	_carve_line(level, from, corner);
+	_carve_line(level, corner, to);
+}
+
+static struct coordinate
+_nearest_floor(struct level *level, struct coordinate from)
+{
+	struct coordinate nearest = from;
+	unsigned int best = UINT32_MAX;
+
+	for (unsigned int y = 1; y < level->dimension.height - 1; y++) {
+		for (unsigned int x = 1; x < level->dimension.width - 1; x++) {
+			struct coordinate c = { y, x };
+			if (!(level_get_flags(level, c) & TA_FLOOR))
+				continue;
+
+			unsigned int d = abs((int)y - (int)from.y) +
+			    abs((int)x - (int)from.x);
+			if (d < best) {
+				best = d;
+				nearest = c;
+			}
+		}
+	}
+
+	assert(best != UINT32_MAX);
+
+	return (nearest);
+}
+
+static void
+_carve_line(struct level *level, struct coordinate from, struct coordinate to)
+{
+	assert(from.y == to.y || from.x == to.x);
+
+	struct coordinate_offset step = {
+		(to.y > from.y) - (to.y < from.y),
+		(to.x > from.x) - (to.x < from.x),
+	};
+
+	struct coordinate c = from;
+	for (;;) {
+		level_set_flags(level, c, TA_FLOOR);
+		if (c.y == to.y && c.x == to.x)
+			break;
+
+		c = coordinate_add_offset(c, step);
+	}
+}
+
+static unsigned int
+_gate(uint64_t seed, uint64_t domain, int32_t y, int32_t x)
+{
+	return (1 + _hash(seed, domain, y, x) % (WORLD_CHUNK_SIZE - 2));
+}
+
+static struct _key
+_chunk_of(struct world_position position)
+{
+	struct _key k = { _floor_div(position.y), _floor_div(position.x) };
+
+	return (k);
+}
+
+static int32_t
+_floor_div(int64_t value)
+{
+	if (value >= 0)
+		return (value / WORLD_CHUNK_SIZE);
+
+	return (-((-value + WORLD_CHUNK_SIZE - 1) / WORLD_CHUNK_SIZE));
+}
+
+/* Chebyshev distance in chunks. */
+static unsigned int
+_distance(struct _key a, struct _key b)
+{
+	unsigned int dy = abs(a.y - b.y);
+	unsigned int dx = abs(a.x - b.x);
+
+	return (dy > dx ? dy : dx);
+}
+
+static bool
+_equal(struct _key a, struct _key b)
+{
+	return (a.y == b.y && a.x == b.x);
+}
+
+static uint64_t
+_hash(uint64_t seed, uint64_t domain, int32_t y, int32_t x)
+{
+	uint64_t position = ((uint64_t)(uint32_t)y << 32) | (uint32_t)x;
+
+	return (_mix(seed ^ _mix(domain ^ _mix(position))));
+}
+
+/*
+ * The SplitMix64 finalizer.
+ */
+static uint64_t
+_mix(uint64_t z)
+{
+	z += UINT64_C(0x9e3779b97f4a7c15);
+	z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+	z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+
+	return (z ^ (z >> 31));
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <assert.h>
+
+#include <sine_nomine/actors.h>
+#include <sine_nomine/coordinate.h>
+#include <sine_nomine/level.h>
+#include <sine_nomine/rng.h>
+
+enum { HEIGHT = 40,
+	WIDTH = 50,
+	ITERATIONS = 20000,
+};
+
+static void _test_handles(void);
+
+static void _test_random(void);
+
+static void _check_occupancy(
+    struct actors *_actors, struct level *_level, unsigned int _count);
+
+int
+main()
+{
+	_test_handles();
+	_test_random();
+
+	exit(EXIT_SUCCESS);
+}
+
+static void
+_test_handles()
+{
+	struct coordinate_dimension d = { HEIGHT, WIDTH };
+	struct level *l = level_create(d);
+	struct actors *a = actors_create(l);
+
+	struct coordinate p[3] = { { 1, 1 }, { 2, 2 }, { 3, 3 } };
+	struct actor_handle h[3];
+	for (int i = 0; i < 3; i++)
+		h[i] = actors_add(a, p[i], i, 100 + i, i);
+
+	assert(a->count == 3);
+	for (int i = 0; i < 3; i++) {
+		assert(level_get_flags(l, p[i]) & TA_OCCUPIED);
+		assert(actors_get_index(a, h[i]) == (unsigned int)i);
+	}
+
+	/* The last actor takes the place of the removed one. */
+	actors_remove(a, h[0]);
+	assert(!actors_is_valid(a, h[0]));
+	assert(!(level_get_flags(l, p[0]) & TA_OCCUPIED));
+	assert(a->count == 2);
+
+	unsigned int i = actors_get_index(a, h[2]);
+	assert(i == 0);
+	assert(a->positions[i].y == 3 && a->positions[i].x == 3);
+	assert(a->ranges[i] == 2);
+	assert(a->speeds[i] == 102);
+
+	struct actor_handle g = actors_get_handle(a, i);
+	assert(g.slot == h[2].slot && g.generation == h[2].generation);
+
+	/* A reused slot does not revive the old handle. */
+	struct actor_handle n = actors_add(a, p[0], 7, 100, 7);
+	assert(n.slot == h[0].slot);
+	assert(!actors_is_valid(a, h[0]));
+	assert(actors_is_valid(a, n));
+
+	struct coordinate q = { 10, 10 };
+	actors_move(a, actors_get_index(a, n), q);
+	assert(!(level_get_flags(l, p[0]) & TA_OCCUPIED));
+	assert(level_get_flags(l, q) & TA_OCCUPIED);
+
+	actors_destroy(a);
+	assert(!(level_get_flags(l, q) & TA_OCCUPIED));
+	assert(!(level_get_flags(l, p[1]) & TA_OCCUPIED));
+
+	level_destroy(l);
+}
+
+/*
+ * Actors come, go and move around at random. Every handle keeps referring to
+ * the actor it was given for, and exactly the tiles of the actors are
+ * occupied.
+ */
+static void
+_test_random()
+{
+	struct rng r;
+	rng_seed(&r, 1, RNG_STREAM_GAMEPLAY);
+
+	struct coordinate_dimension d = { HEIGHT, WIDTH };
+	struct level *l = level_create(d);
+	struct actors *a = actors_create(l);
+
+	/* The range of each live actor is the number it was added as. */
+	struct actor_handle *live = calloc(ITERATIONS, sizeof(*live));
+	unsigned int *numbers = calloc(ITERATIONS, sizeof(*numbers));
+	assert(live != NULL && numbers != NULL);
+	unsigned int count = 0;
+
+	for (unsigned int i = 0; i < ITERATIONS; i++) {
+		struct coordinate c = { rng_uniform(&r, HEIGHT),
+			rng_uniform(&r, WIDTH) };
+		bool vacant = !(level_get_flags(l, c) & TA_OCCUPIED);
+
+		switch (rng_uniform(&r, 3)) {
+		case 0:
+			if (!vacant)
+				break;
+
+			numbers[count] = i;
+			live[count++] = actors_add(a, c, i, 100, i);
+			break;
+
+		case 1:
+			if (count == 0)
+				break;
+
+			unsigned int k = rng_uniform(&r, count);
+			actors_remove(a, live[k]);
+			assert(!actors_is_valid(a, live[k]));
+
+			live[k] = live[--count];
+			numbers[k] = numbers[count];
+			break;
+
+		case 2:
+			if (count == 0 || !vacant)
+				break;
+
+			unsigned int j =
+			    actors_get_index(a, live[rng_uniform(&r, count)]);
+			actors_move(a, j, c);
+			break;
+		}
+
+		for (unsigned int k = 0; k < count; k++) {
+			assert(actors_is_valid(a, live[k]));
+			assert(a->ranges[actors_get_index(a, live[k])] ==
+			    numbers[k]);
+		}
+
+		_check_occupancy(a, l, count);
+	}
+
+	free(numbers);
+	free(live);
+	actors_destroy(a);
+	level_destroy(l);
+}
+
+static void
+_check_occupancy(struct actors *actors, struct level *level, unsigned int count)
+{
+	assert(actors->count == count);
+
+	unsigned int occupied = 0;
+	for (unsigned int y = 0; y < HEIGHT; y++) {
+		for (unsigned int x = 0; x < WIDTH; x++) {
+			struct coordinate c = { y, x };
+			occupied += !!(level_get_flags(level, c) & TA_OCCUPIED);
+		}
+	}
+	assert(occupied == count);
+
+	for (unsigned int i = 0; i < actors->count; i++) {
+		assert(level_get_flags(level, actors->positions[i]) &
+		    TA_OCCUPIED);
+		assert(actors->table[actors->slots[i]].index == i);
+	}
+}
@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <assert.h>
+
+#include <sine_nomine/autoexplore.h>
+#include <sine_nomine/cave.h>
+#include <sine_nomine/coordinate.h>
+#include <sine_nomine/dijkstra.h>
+#include <sine_nomine/dungeon.h>
+#include <sine_nomine/fov.h>
+#include <sine_nomine/frontier.h>
+#include <sine_nomine/level.h>
+#include <sine_nomine/region.h>
+#include <sine_nomine/rng.h>
+#include <sine_nomine/structs.h>
+#include <sine_nomine/tileset.h>
+
+enum { HEIGHT = 60,
+	WIDTH = 90,
+	ITERATIONS = 10,
+	ROOMS = 8,
+	ROOM_MIN = 5,
+	ROOM_MAX = 12,
+	RANGE = 4,
+	TORCHES = 10,
+	MAX_TICKS = 20000,
+};
+
+static void _test_same_steps(bool _caves, bool _threaded);
+
+static void _test_cancel(void);
+
+static bool _reference_step(struct level *_level, struct region_map *_regions,
+    struct frontier *_frontier, struct coordinate _player,
+    struct coordinate_offset *_step);
+
+static struct coordinate _random_floor(struct level *_level, struct rng *_rng);
+
+int
+main()
+{
+	_test_same_steps(false, false);
+	_test_same_steps(true, false);
+	_test_same_steps(false, true);
+	_test_cancel();
+
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * Runs autoexplore the way the game loop does and checks that every step
+ * matches the one a fresh dijkstra map would give. A threaded run plans each
+ * step on a worker thread.
+ */
+static void
+_test_same_steps(bool caves, bool threaded)
+{
+	unsigned long steps = 0;
+	unsigned long plans = 0;
+
+	for (int i = 0; i < ITERATIONS; i++) {
+		struct rng r;
+		rng_seed(&r, i, RNG_STREAM_GENERATION);
+
+		struct coordinate_dimension d = { HEIGHT, WIDTH };
+		struct level *l = level_create(d);
+
+		if (caves) {
+			cave_generate(l, &r, CAVE_FILL, CAVE_ITERATIONS);
+		} else {
+			struct coordinate_dimension min = { ROOM_MIN,
+				ROOM_MIN };
+			struct coordinate_dimension max = { ROOM_MAX,
+				ROOM_MAX };
+			dungeon_generate(l, &r, ROOMS, min, max);
+		}
+		level_modify_random_floor_tiles(l, &r, TORCHES, TA_TORCH);
+
+		struct region_map *regions = region_create(l);
+		struct frontier *f = frontier_create(l);
+		struct autoexplore *a = autoexplore_create(l, regions, f);
+		struct fov *fov = fov_create(l);
+
+		struct player p = { _random_floor(l, &r), RANGE };
+
+		int tick;
+		for (tick = 0; tick < MAX_TICKS; tick++) {
+			region_update(regions);
+			frontier_update(f);
+			autoexplore_observe(a, p.position);
+			level_journal_clear(l);
+
+			fov_calculate(fov, p);
+			frontier_update(f);
+
+			struct coordinate_offset expected = { 0, 0 };
+			bool more = _reference_step(
+			    l, regions, f, p.position, &expected);
+
+			struct coordinate_offset step = { 0, 0 };
+			if (threaded) {
+				double frontier;
+				autoexplore_start(a, p.position);
+				assert(autoexplore_finish(
+					   a, &step, &frontier) == more);
+			} else {
+				assert(autoexplore_next(a, p.position, &step) ==
+				    more);
+			}
+			if (!more)
+				break;
+
+			assert(step.y == expected.y && step.x == expected.x);
+
+			struct coordinate np =
+			    coordinate_add_offset(p.position, step);
+			if (!(level_get_flags(l, np) & TA_WALL))
+				p.position = np;
+
+			if (level_get_flags(l, p.position) & TA_TORCH) {
+				level_remove_flags(l, p.position, TA_TORCH);
+				p.range++;
+			}
+		}
+		assert(tick < MAX_TICKS);
+
+		steps += a->statistics.steps;
+		plans += a->statistics.plans;
+
+		fov_destroy(fov);
+		autoexplore_destroy(a);
+		frontier_destroy(f);
+		region_destroy(regions);
+		level_destroy(l);
+	}
+
+	/* Most steps follow the cached path. */
+	assert(2 * plans < steps);
+}
+
+/*
+ * A cancelled step leaves the planner usable, and destroying it cancels a step
+ * still being planned.
+ */
+static void
+_test_cancel()
+{
+	struct rng r;
+	rng_seed(&r, 0, RNG_STREAM_GENERATION);
+
+	struct coordinate_dimension d = { HEIGHT, WIDTH };
+	struct coordinate_dimension min = { ROOM_MIN, ROOM_MIN };
+	struct coordinate_dimension max = { ROOM_MAX, ROOM_MAX };
+	struct level *l = level_create(d);
+	dungeon_generate(l, &r, ROOMS, min, max);
+
+	struct region_map *regions = region_create(l);
+	struct frontier *f = frontier_create(l);
+	struct autoexplore *a = autoexplore_create(l, regions, f);
+
+	struct fov *fov = fov_create(l);
+	struct player p = { _random_floor(l, &r), RANGE };
+	fov_calculate(fov, p);
+	fov_destroy(fov);
+	region_update(regions);
+
+	double frontier = -1;
+	autoexplore_start(a, p.position);
+	autoexplore_cancel(a, &frontier);
+	assert(!a->pending);
+	assert(frontier >= 0);
+
+	frontier_update(f);
+	struct coordinate_offset expected = { 0, 0 };
+	assert(_reference_step(l, regions, f, p.position, &expected));
+
+	/*
+	 * A plan cancelled while the map is built is dropped and leaves the
+	 * planner stale, the next step plans afresh.
+	 */
+	a->stale = true;
+	unsigned long plans = a->statistics.plans;
+	atomic_store(&a->cancelled, true);
+	struct coordinate_offset step = { 0, 0 };
+	assert(!autoexplore_next(a, p.position, &step));
+	assert(a->stale);
+	assert(a->statistics.plans == plans + 1);
+	atomic_store(&a->cancelled, false);
+
+	autoexplore_start(a, p.position);
+	assert(autoexplore_finish(a, &step, &frontier));
+	assert(step.y == expected.y && step.x == expected.x);
+
+	autoexplore_start(a, p.position);
+	autoexplore_destroy(a);
+
+	frontier_destroy(f);
+	region_destroy(regions);
+	level_destroy(l);
+}
+
+/*
+ * The step autoexplore used to take: downhill on a map built from scratch.
+ */
+static bool
+_reference_step(struct level *level, struct region_map *regions,
+    struct frontier *frontier, struct coordinate player,
+    struct coordinate_offset *step)
+{
+	struct dijkstra_map *dm = dijkstra_create(level);
+	dijkstra_restrict(dm, regions, player);
+
+	for (unsigned int i = 0; i < frontier->edge->count; i++) {
+		dijkstra_add_target(dm, frontier->edge->members[i],
+		    AUTOEXPLORE_EDGE_PRIORITY);
+	}
+	for (unsigned int i = 0; i < frontier->torches->count; i++) {
+		dijkstra_add_target(dm, frontier->torches->members[i],
+		    AUTOEXPLORE_TORCH_PRIORITY);
+	}
+
+	if (dijkstra_get_value(dm, player) == DIJKSTRA_MAX) {
+		dijkstra_destroy(dm);
+		return (false);
+	}
+
+	struct coordinate_offset off[] = { { -1, 0 }, { 0, 1 }, { 1, 0 },
+		{ 0, -1 } };
+	dijkstra min = DIJKSTRA_MAX;
+	for (int i = 0; i < 4; i++) {
+		if (!coordinate_check_bounds_offset(
+			level->dimension, player, off[i]))
+			continue;
+
+		struct coordinate c = coordinate_add_offset(player, off[i]);
+		if (dijkstra_get_value(dm, c) < min) {
+			min = dijkstra_get_value(dm, c);
+			*step = off[i];
+		}
+	}
+
+	dijkstra_destroy(dm);
+
+	return (true);
+}
+
+static struct coordinate
+_random_floor(struct level *level, struct rng *rng)
+{
+	for (;;) {
+		struct coordinate c;
+		c.y = rng_uniform(rng, level->dimension.height);
+		c.x = rng_uniform(rng, level->dimension.width);
+
+		if (level_get_flags(level, c) & TA_FLOOR)
+			return (c);
+	}
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <assert.h>
+
+#include <sine_nomine/coordinate.h>
+
+enum { LENGTH_MAX = 40,
+	WINDOW_MAX = 40,
+	OFFSET_MAX = 50,
+};
+
+static void _test_clip(void);
+
+int
+main()
+{
+	_test_clip();
+
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * The clipped range holds exactly the positions that pass the bounds check
+ * once the offset is added, for every small length, window and offset.
+ */
+static void
+_test_clip()
+{
+	for (unsigned int length = 0; length <= LENGTH_MAX; length++) {
+		for (unsigned int window = 1; window <= WINDOW_MAX; window++) {
+			for (int offset = -OFFSET_MAX; offset <= OFFSET_MAX;
+			     offset++) {
+				unsigned int first, last;
+				coordinate_clip(
+				    length, window, offset, &first, &last);
+				assert(first <= last);
+				assert(last <= length);
+
+				struct coordinate_dimension d = { window, 1 };
+				struct coordinate_offset o = { offset, 0 };
+
+				for (unsigned int p = 0; p < length; p++) {
+					struct coordinate c = { p, 0 };
+					bool inside = p >= first && p < last;
+					assert(coordinate_check_bounds_offset(
+						   d, c, o) == inside);
+				}
+			}
+		}
+	}
+}
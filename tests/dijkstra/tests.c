@@ -13,6 +13,7 @@
  * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <stdatomic.h>
 #include <stdlib.h>
 
 #include <assert.h>
@@ -23,6 +24,7 @@
 
 enum { HEIGHT = 6,
 	WIDTH = 5,
+	LARGE_SIDE = 200,
 };
 
 static void _test_empty_level_one_target(void);
@@ -33,6 +35,12 @@ static void _test_nonempty_level_one_target(void);
 
 static void _test_nonempty_level_two_targets(void);
 
+static void _test_limit(void);
+
+static void _test_cancel(void);
+
+static unsigned int _flooded(struct dijkstra_map *_map, struct level *_level);
+
 int
 main()
 {
@@ -40,6 +48,8 @@ main()
 	_test_empty_level_two_targets();
 	_test_nonempty_level_one_target();
 	_test_nonempty_level_two_targets();
+	_test_limit();
+	_test_cancel();
 
 	exit(EXIT_SUCCESS);
 }
@@ -124,8 +134,10 @@ _test_nonempty_level_one_target()
 
 	struct dijkstra_map *dm = dijkstra_create(l);
 
-	for (unsigned int y = 0; y < 4; y++)
-		l->tiles[y][2].flags |= TA_WALL;
+	for (unsigned int y = 0; y < 4; y++) {
+		struct coordinate w = { y, 2 };
+		level_add_flags(l, w, TA_WALL);
+	}
 
 	struct coordinate c = { 0, 0 };
 	dijkstra_add_target(dm, c, 0);
@@ -161,8 +173,10 @@ _test_nonempty_level_two_targets()
 
 	struct dijkstra_map *dm = dijkstra_create(l);
 
-	for (unsigned int y = 0; y < 4; y++)
-		l->tiles[y][2].flags |= TA_WALL;
+	for (unsigned int y = 0; y < 4; y++) {
+		struct coordinate w = { y, 2 };
+		level_add_flags(l, w, TA_WALL);
+	}
 
 	struct coordinate c = { 0, 0 };
 	dijkstra_add_target(dm, c, 0);
@@ -191,3 +205,86 @@ _test_nonempty_level_two_targets()
 	dijkstra_destroy(dm);
 	level_destroy(l);
 }
+
+static void
+_test_limit()
+{
+	struct coordinate_dimension d = { HEIGHT, WIDTH };
+	struct level *l = level_create(d);
+	assert(l != NULL);
+
+	struct dijkstra_map *dm = dijkstra_create(l);
+	dijkstra_limit(dm, 3);
+
+	struct coordinate c = { 0, 0 };
+	dijkstra_add_target(dm, c, 0);
+
+	const dijkstra M = DIJKSTRA_MAX;
+
+	/* clang-format off */
+	dijkstra expected[HEIGHT][WIDTH] = {
+		{ 0, 1, 2, 3, M },
+		{ 1, 2, 3, M, M },
+		{ 2, 3, M, M, M },
+		{ 3, M, M, M, M },
+		{ M, M, M, M, M },
+		{ M, M, M, M, M },
+	};
+	/* clang-format on */
+
+	for (unsigned int y = 0; y < l->dimension.height; y++) {
+		for (unsigned int x = 0; x < l->dimension.width; x++) {
+			struct coordinate c = { y, x };
+			assert(dijkstra_get_value(dm, c) == expected[y][x]);
+		}
+	}
+
+	dijkstra_destroy(dm);
+	level_destroy(l);
+}
+
+/*
+ * A cancelled flood stops within a few checks, one that is not cancelled
+ * floods the whole level.
+ */
+static void
+_test_cancel()
+{
+	struct coordinate_dimension d = { LARGE_SIDE, LARGE_SIDE };
+	struct level *l = level_create(d);
+	struct coordinate c = { LARGE_SIDE / 2, LARGE_SIDE / 2 };
+
+	atomic_bool cancelled;
+	atomic_init(&cancelled, false);
+
+	struct dijkstra_map *dm = dijkstra_create(l);
+	dijkstra_cancel(dm, &cancelled);
+	dijkstra_add_target(dm, c, 0);
+	assert(_flooded(dm, l) == LARGE_SIDE * LARGE_SIDE);
+	dijkstra_destroy(dm);
+
+	atomic_store(&cancelled, true);
+
+	dm = dijkstra_create(l);
+	dijkstra_cancel(dm, &cancelled);
+	dijkstra_add_target(dm, c, 0);
+	assert(_flooded(dm, l) <= 4 * DIJKSTRA_CANCEL_INTERVAL + 1);
+	dijkstra_destroy(dm);
+
+	level_destroy(l);
+}
+
+static unsigned int
+_flooded(struct dijkstra_map *map, struct level *level)
+{
+	unsigned int n = 0;
+
+	for (unsigned int y = 0; y < level->dimension.height; y++) {
+		for (unsigned int x = 0; x < level->dimension.width; x++) {
+			struct coordinate c = { y, x };
+			n += dijkstra_get_value(map, c) != DIJKSTRA_MAX;
+		}
+	}
+
+	return (n);
+}
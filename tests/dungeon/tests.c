@@ -17,10 +17,13 @@
 
 #include <assert.h>
 
+#include <sine_nomine/cave.h>
 #include <sine_nomine/coordinate.h>
 #include <sine_nomine/dijkstra.h>
 #include <sine_nomine/dungeon.h>
 #include <sine_nomine/level.h>
+#include <sine_nomine/region.h>
+#include <sine_nomine/rng.h>
 
 enum { HEIGHT = 200,
 	WIDTH = 300,
@@ -32,6 +35,8 @@ enum { HEIGHT = 200,
 
 static void _check_connectivity(struct level *_level);
 
+static void _check_borders(struct level *_level);
+
 static struct dijkstra_map *_flood(struct level *_level);
 
 int
@@ -44,13 +49,54 @@ main()
 		struct coordinate_dimension min = { ROOM_MIN, ROOM_MIN };
 		struct coordinate_dimension max = { ROOM_MIN, ROOM_MIN };
 
-		dungeon_generate(l, ROOMS, min, max);
+		struct rng r;
+		rng_seed(&r, i, RNG_STREAM_GENERATION);
+
+		dungeon_generate(l, &r, ROOMS, min, max);
+		_check_connectivity(l);
+		_check_borders(l);
+
+		level_destroy(l);
+	}
+
+	for (int i = 0; i < ITERATIONS; i++) {
+		struct coordinate_dimension d = { HEIGHT, WIDTH };
+		struct level *l = level_create(d);
+
+		struct coordinate_dimension min = { ROOM_MIN, ROOM_MIN };
+		struct coordinate_dimension max = { ROOM_MAX, ROOM_MAX };
+
+		struct rng r;
+		rng_seed(&r, i, RNG_STREAM_GENERATION);
+
+		dungeon_generate_bsp(l, &r, min, max);
+		_check_connectivity(l);
+		_check_borders(l);
+
+		level_destroy(l);
+	}
+
+	for (int i = 0; i < ITERATIONS; i++) {
+		struct coordinate_dimension d = { HEIGHT, WIDTH };
+		struct level *l = level_create(d);
+
+		struct rng r;
+		rng_seed(&r, i, RNG_STREAM_GENERATION);
+
+		cave_generate(l, &r, CAVE_FILL, CAVE_ITERATIONS);
 		_check_connectivity(l);
+		_check_borders(l);
+
+		level_destroy(l);
 	}
 
 	exit(EXIT_SUCCESS);
 }
 
+/*
+ * A flood from one floor tile reaches every other one. The region map must
+ * agree, the flood does not depend on it.
+ */
 static void
 _check_connectivity(struct level *level)
 {
@@ -58,8 +104,8 @@ _check_connectivity(struct level *level)
 
 	for (unsigned int y = 0; y < level->dimension.height; y++) {
 		for (unsigned int x = 0; x < level->dimension.width; x++) {
-			if (level->tiles[y][x].flags & TA_FLOOR) {
-				struct coordinate c = { y, x };
+			struct coordinate c = { y, x };
+			if (level_get_flags(level, c) & TA_FLOOR) {
 				assert(
 				    dijkstra_get_value(dm, c) < DIJKSTRA_MAX);
 			}
@@ -67,6 +113,32 @@ _check_connectivity(struct level *level)
 	}
 
 	dijkstra_destroy(dm);
+
+	struct region_map *rm = region_create(level);
+	assert(region_count(rm) == 1);
+	region_destroy(rm);
+}
+
+static void
+_check_borders(struct level *level)
+{
+	struct coordinate_dimension d = level->dimension;
+
+	for (unsigned int y = 0; y < d.height; y++) {
+		struct coordinate left = { y, 0 };
+		struct coordinate right = { y, d.width - 1 };
+
+		assert(level_get_flags(level, left) & TA_WALL);
+		assert(level_get_flags(level, right) & TA_WALL);
+	}
+
+	for (unsigned int x = 0; x < d.width; x++) {
+		struct coordinate top = { 0, x };
+		struct coordinate bottom = { d.height - 1, x };
+
+		assert(level_get_flags(level, top) & TA_WALL);
+		assert(level_get_flags(level, bottom) & TA_WALL);
+	}
 }
 
 struct dijkstra_map *
@@ -76,8 +148,8 @@ _flood(struct level *level)
 
 	for (unsigned int y = 0; y < level->dimension.height; y++) {
 		for (unsigned int x = 0; x < level->dimension.width; x++) {
-			if (level->tiles[y][x].flags & TA_FLOOR) {
-				struct coordinate c = { y, x };
+			struct coordinate c = { y, x };
+			if (level_get_flags(level, c) & TA_FLOOR) {
 				dijkstra_add_target(dm, c, 0);
 
 				return (dm);
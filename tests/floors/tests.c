@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <assert.h>
+
+#include <sine_nomine/coordinate.h>
+#include <sine_nomine/floors.h>
+#include <sine_nomine/game.h>
+#include <sine_nomine/level.h>
+#include <sine_nomine/pregen.h>
+#include <sine_nomine/region.h>
+
+enum { ACTIVE = 2,
+	DEPTH = 8,
+};
+
+static struct game_configuration config = {
+	.height = 50,
+	.width = 70,
+	.rooms = 5,
+	.range = 4,
+	.roomsize = { 5, 10 },
+	.torches = { 5, 20 },
+	.seed = 11,
+	.generator = DG_ROOMS,
+};
+
+static void _test_round_trip(void);
+
+static void _test_add(void);
+
+static void _mark(struct pregen_level *_level);
+
+static void _check_same(struct level *_a, struct level *_b);
+
+int
+main()
+{
+	_test_round_trip();
+	_test_add();
+
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * Walking down and up again: only a few floors stay active, the others come
+ * back from compression as they were left, visibility aside.
+ */
+static void
+_test_round_trip()
+{
+	struct floors *f = floors_create(config, ACTIVE, 0);
+	struct level *copies[DEPTH];
+
+	for (unsigned int d = 0; d < DEPTH; d++) {
+		struct pregen_level *l = floors_get(f, d);
+		assert(l->depth == d);
+
+		_mark(l);
+		copies[d] = level_snapshot(l->level);
+
+		struct floors_statistics s = floors_get_statistics(f);
+		assert(s.active <= ACTIVE);
+		assert(s.active + s.compressed == d + 1);
+	}
+
+	for (int d = DEPTH - 1; d >= 0; d--) {
+		struct pregen_level *l = floors_get(f, d);
+		assert(l->depth == (unsigned int)d);
+		assert(level_get_flags(l->level, l->spawn) & TA_FLOOR);
+		assert(level_get_flags(l->level, l->stairs) & TA_STAIRS);
+		assert(region_count(l->regions) == 1);
+
+		_check_same(l->level, copies[d]);
+	}
+
+	struct floors_statistics s = floors_get_statistics(f);
+	assert(s.generated == DEPTH);
+	assert(s.decompressed == DEPTH - ACTIVE);
+	assert(s.compressed == DEPTH - ACTIVE);
+	assert(s.compressed_bytes > 0);
+
+	/* Going down again continues with the levels pregen made. */
+	struct pregen_level *l = floors_get(f, DEPTH);
+	assert(l->depth == DEPTH);
+
+	floors_destroy(f);
+
+	for (unsigned int d = 0; d < DEPTH; d++)
+		level_destroy(copies[d]);
+}
+
+/*
+ * A floor added from elsewhere is kept, the floors above it are generated the
+ * way pregen generates them.
+ */
+static void
+_test_add()
+{
+	struct floors *f = floors_create(config, ACTIVE, DEPTH + 1);
+
+	struct pregen_level *added = pregen_generate(config, DEPTH);
+	_mark(added);
+	floors_add(f, added);
+
+	assert(floors_get(f, DEPTH) == added);
+
+	struct pregen_level *expected = pregen_generate(config, DEPTH - 1);
+	struct pregen_level *l = floors_get(f, DEPTH - 1);
+	_check_same(l->level, expected->level);
+	pregen_release(expected);
+
+	l = floors_get(f, DEPTH + 1);
+	assert(l->depth == DEPTH + 1);
+
+	floors_destroy(f);
+}
+
+/*
+ * Leaves some traces: known and visible tiles along the first rows, a torch
+ * taken away.
+ */
+static void
+_mark(struct pregen_level *level)
+{
+	struct level *l = level->level;
+
+	for (unsigned int y = 0; y < l->dimension.height / 2; y++) {
+		for (unsigned int x = 0; x < l->dimension.width; x++) {
+			struct coordinate c = { y, x };
+			level_add_flags(l, c, TA_KNOWN);
+			if ((x + y) % 3 == 0)
+				level_add_flags(l, c, TA_VISIBLE);
+			if (level_get_flags(l, c) & TA_TORCH) {
+				level_remove_flags(l, c, TA_TORCH);
+				break;
+			}
+		}
+	}
+
+	level_journal_clear(l);
+}
+
+static void
+_check_same(struct level *a, struct level *b)
+{
+	for (unsigned int y = 0; y < a->dimension.height; y++) {
+		for (unsigned int x = 0; x < a->dimension.width; x++) {
+			struct coordinate c = { y, x };
+			assert((level_get_flags(a, c) & ~TA_VISIBLE) ==
+			    (level_get_flags(b, c) & ~TA_VISIBLE));
+		}
+	}
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdlib.h>
+
+#include <assert.h>
+
+#include <sine_nomine/coordinate.h>
+#include <sine_nomine/dungeon.h>
+#include <sine_nomine/fov.h>
+#include <sine_nomine/level.h>
+#include <sine_nomine/rng.h>
+#include <sine_nomine/structs.h>
+
+enum { HEIGHT = 60,
+	WIDTH = 90,
+	ITERATIONS = 10,
+	STEPS = 200,
+	ROOMS = 8,
+	ROOM_MIN = 5,
+	ROOM_MAX = 12,
+	RANGE_MIN = 2,
+	RANGE_MAX = 9,
+};
+
+static void _test_same_view(void);
+
+static void _test_unchanged_view(void);
+
+static struct level *_generate(unsigned int _seed);
+
+static struct coordinate _random_floor(struct level *_level, struct rng *_rng);
+
+int
+main()
+{
+	_test_same_view();
+	_test_unchanged_view();
+
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * A player walks, teleports and changes range. Keeping the field of view
+ * current has to give the same tiles as looking at the whole level every time.
+ */
+static void
+_test_same_view()
+{
+	for (unsigned int i = 0; i < ITERATIONS; i++) {
+		struct level *l = _generate(i);
+		struct level *reference = _generate(i);
+		struct fov *fov = fov_create(l);
+
+		struct rng r;
+		rng_seed(&r, i, RNG_STREAM_GAMEPLAY);
+
+		struct player p = { _random_floor(l, &r), RANGE_MIN };
+		for (int step = 0; step < STEPS; step++) {
+			switch (rng_uniform(&r, 8)) {
+			case 0:
+				p.position = _random_floor(l, &r);
+				break;
+			case 1:
+				p.range = RANGE_MIN +
+				    rng_uniform(&r, RANGE_MAX - RANGE_MIN + 1);
+				break;
+			default: {
+				struct coordinate_offset off[] = { { -1, 0 },
+					{ 0, 1 }, { 1, 0 }, { 0, -1 } };
+				struct coordinate c = coordinate_add_offset(
+				    p.position, off[rng_uniform(&r, 4)]);
+				if (level_get_flags(l, c) & TA_FLOOR)
+					p.position = c;
+				break;
+			}
+			}
+
+			fov_calculate(fov, p);
+
+			struct fov *fresh = fov_create(reference);
+			fov_calculate(fresh, p);
+			fov_destroy(fresh);
+
+			for (unsigned int y = 0; y < HEIGHT; y++) {
+				for (unsigned int x = 0; x < WIDTH; x++) {
+					struct coordinate c = { y, x };
+					assert(level_get_flags(l, c) ==
+					    level_get_flags(reference, c));
+				}
+			}
+		}
+
+		fov_destroy(fov);
+		level_destroy(reference);
+		level_destroy(l);
+	}
+}
+
+/*
+ * Looking again from the same spot changes nothing.
+ */
+static void
+_test_unchanged_view()
+{
+	struct level *l = _generate(0);
+	struct fov *fov = fov_create(l);
+
+	struct rng r;
+	rng_seed(&r, 0, RNG_STREAM_GAMEPLAY);
+
+	struct player p = { _random_floor(l, &r), RANGE_MAX };
+	fov_calculate(fov, p);
+
+	unsigned long generation = l->generation;
+	fov_calculate(fov, p);
+	assert(l->generation == generation);
+
+	fov_destroy(fov);
+	level_destroy(l);
+}
+
+static struct level *
+_generate(unsigned int seed)
+{
+	struct rng r;
+	rng_seed(&r, seed, RNG_STREAM_GENERATION);
+
+	struct coordinate_dimension d = { HEIGHT, WIDTH };
+	struct coordinate_dimension min = { ROOM_MIN, ROOM_MIN };
+	struct coordinate_dimension max = { ROOM_MAX, ROOM_MAX };
+	struct level *l = level_create(d);
+	dungeon_generate(l, &r, ROOMS, min, max);
+
+	return (l);
+}
+
+static struct coordinate
+_random_floor(struct level *level, struct rng *rng)
+{
+	for (;;) {
+		struct coordinate c;
+		c.y = rng_uniform(rng, level->dimension.height);
+		c.x = rng_uniform(rng, level->dimension.width);
+
+		if (level_get_flags(level, c) & TA_FLOOR)
+			return (c);
+	}
+}
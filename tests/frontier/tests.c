@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdlib.h>
+
+#include <assert.h>
+
+#include <sine_nomine/coordinate.h>
+#include <sine_nomine/dijkstra.h>
+#include <sine_nomine/dungeon.h>
+#include <sine_nomine/fov.h>
+#include <sine_nomine/frontier.h>
+#include <sine_nomine/level.h>
+#include <sine_nomine/rng.h>
+#include <sine_nomine/structs.h>
+#include <sine_nomine/tileset.h>
+
+enum { HEIGHT = 60,
+	WIDTH = 90,
+	ITERATIONS = 20,
+	STEPS = 15,
+	ROOMS = 8,
+	ROOM_MIN = 5,
+	ROOM_MAX = 12,
+	RANGE = 4,
+	TORCHES = 10,
+};
+
+static void _test_tileset(void);
+
+static void _test_incremental(void);
+
+static void _test_same_distances(void);
+
+static struct level *_explore(
+    struct rng *_rng, struct frontier **_frontier);
+
+static struct coordinate _random_floor(struct level *_level, struct rng *_rng);
+
+static void _check_same_sets(struct tileset *_a, struct tileset *_b);
+
+int
+main()
+{
+	_test_tileset();
+	_test_incremental();
+	_test_same_distances();
+
+	exit(EXIT_SUCCESS);
+}
+
+static void
+_test_tileset()
+{
+	struct coordinate_dimension d = { 3, 4 };
+	struct tileset *s = tileset_create(d);
+
+	struct coordinate a = { 0, 0 };
+	struct coordinate b = { 1, 2 };
+	struct coordinate c = { 2, 3 };
+
+	assert(tileset_add(s, a));
+	assert(tileset_add(s, b));
+	assert(tileset_add(s, c));
+	assert(!tileset_add(s, b));
+	assert(s->count == 3);
+
+	assert(tileset_remove(s, a));
+	assert(!tileset_remove(s, a));
+	assert(!tileset_contains(s, a));
+	assert(tileset_contains(s, b));
+	assert(tileset_contains(s, c));
+	assert(s->count == 2);
+
+	tileset_clear(s);
+	assert(s->count == 0);
+	assert(!tileset_contains(s, c));
+	assert(tileset_add(s, c));
+
+	tileset_destroy(s);
+}
+
+/*
+ * A frontier kept current from the journal matches one built from scratch.
+ */
+static void
+_test_incremental()
+{
+	for (int i = 0; i < ITERATIONS; i++) {
+		struct rng r;
+		rng_seed(&r, i, RNG_STREAM_GENERATION);
+
+		struct frontier *f;
+		struct level *l = _explore(&r, &f);
+		struct frontier *g = frontier_create(l);
+
+		_check_same_sets(f->edge, g->edge);
+		_check_same_sets(f->torches, g->torches);
+
+		frontier_destroy(g);
+		frontier_destroy(f);
+		level_destroy(l);
+	}
+}
+
+/*
+ * Seeding the frontier gives the same distances as seeding every unknown tile
+ * on every tile the player can step on.
+ */
+static void
+_test_same_distances()
+{
+	for (int i = 0; i < ITERATIONS; i++) {
+		struct rng r;
+		rng_seed(&r, i, RNG_STREAM_GENERATION);
+
+		struct frontier *f;
+		struct level *l = _explore(&r, &f);
+
+		struct dijkstra_map *all = dijkstra_create(l);
+		struct dijkstra_map *edge = dijkstra_create(l);
+
+		for (unsigned int y = 0; y < HEIGHT; y++) {
+			for (unsigned int x = 0; x < WIDTH; x++) {
+				struct coordinate c = { y, x };
+				unsigned int flags = level_get_flags(l, c);
+
+				if (!(flags & TA_KNOWN))
+					dijkstra_add_target(all, c, 20);
+				if ((flags & TA_KNOWN) && (flags & TA_TORCH))
+					dijkstra_add_target(all, c, 0);
+			}
+		}
+
+		for (unsigned int j = 0; j < f->edge->count; j++)
+			dijkstra_add_target(edge, f->edge->members[j], 20);
+		for (unsigned int j = 0; j < f->torches->count; j++)
+			dijkstra_add_target(edge, f->torches->members[j], 0);
+
+		for (unsigned int y = 0; y < HEIGHT; y++) {
+			for (unsigned int x = 0; x < WIDTH; x++) {
+				struct coordinate c = { y, x };
+				unsigned int flags = level_get_flags(l, c);
+
+				if (!(flags & TA_KNOWN) || (flags & TA_WALL))
+					continue;
+
+				assert(dijkstra_get_value(all, c) ==
+				    dijkstra_get_value(edge, c));
+			}
+		}
+
+		dijkstra_destroy(edge);
+		dijkstra_destroy(all);
+		frontier_destroy(f);
+		level_destroy(l);
+	}
+}
+
+/*
+ * Generates a level and lets a player look around at a few random spots,
+ * keeping a frontier up to date on the way.
+ */
+static struct level *
+_explore(struct rng *rng, struct frontier **frontier)
+{
+	struct coordinate_dimension d = { HEIGHT, WIDTH };
+	struct level *l = level_create(d);
+
+	struct coordinate_dimension min = { ROOM_MIN, ROOM_MIN };
+	struct coordinate_dimension max = { ROOM_MAX, ROOM_MAX };
+	dungeon_generate(l, rng, ROOMS, min, max);
+	level_modify_random_floor_tiles(l, rng, TORCHES, TA_TORCH);
+
+	struct frontier *f = frontier_create(l);
+	struct fov *fov = fov_create(l);
+
+	for (int i = 0; i < STEPS; i++) {
+		struct player p = { _random_floor(l, rng), RANGE };
+		fov_calculate(fov, p);
+
+		frontier_update(f);
+		level_journal_clear(l);
+	}
+
+	fov_destroy(fov);
+	*frontier = f;
+
+	return (l);
+}
+
+static struct coordinate
+_random_floor(struct level *level, struct rng *rng)
+{
+	for (;;) {
+		struct coordinate c;
+		c.y = rng_uniform(rng, level->dimension.height);
+		c.x = rng_uniform(rng, level->dimension.width);
+
+		if (level_get_flags(level, c) & TA_FLOOR)
+			return (c);
+	}
+}
+
+static void
+_check_same_sets(struct tileset *a, struct tileset *b)
+{
+	assert(a->count == b->count);
+
+	for (unsigned int i = 0; i < a->count; i++)
+		assert(tileset_contains(b, a->members[i]));
+}
@@ -0,0 +1,341 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <assert.h>
+#include <unistd.h>
+
+#include <sine_nomine/game.h>
+#include <sine_nomine/structs.h>
+
+enum { TURNS = 1000,
+	SEEDS = 3,
+	CROWD_SIDE = 250,
+	CROWD_TURNS = 300,
+	THREADS = 4,
+	WORLD_TURNS = 200,
+	WORLD_PREFETCHED = 25, /* chunks around the first one */
+};
+
+/* A copy of the monsters of a game, see _copy_monsters(). */
+struct monsters {
+	unsigned int count;
+	struct coordinate *positions;
+	ACTOR_STATE *states;
+	struct rng *rngs;
+	unsigned int *slots;
+};
+
+static void _test_script(void);
+
+static void _test_bot(void);
+
+static void _test_save(void);
+
+static void _test_jobs(void);
+
+static void _test_world(void);
+
+static bool _same_files(const char *_a, const char *_b);
+
+static struct monsters _copy_monsters(const struct actors *_actors);
+
+static void _free_monsters(struct monsters *_monsters);
+
+static struct game_configuration _configuration(uint64_t _seed);
+
+int
+main()
+{
+	_test_script();
+	_test_bot();
+	_test_save();
+	_test_jobs();
+	_test_world();
+
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * The script is played key by key, the game ends with its 'q'. Keys that do
+ * nothing do not cause a frame, and while keys are queued up only every few
+ * turns are drawn.
+ */
+static void
+_test_script()
+{
+	struct game_configuration config = _configuration(0);
+	config.script = "jjkkhhllxq";
+
+	struct game *g = game_create(config);
+	game_loop(g);
+	struct game_statistics s = game_get_statistics(g);
+	game_destroy(g);
+
+	assert(s.turns == 10);
+	assert(s.levels == 0);
+	assert(s.frames < s.turns);
+
+	config.script = "hlhlhlhlhlhlhlhlhlhlhlhlhlhlhlhlhlhlhlhlq";
+
+	g = game_create(config);
+	game_loop(g);
+	s = game_get_statistics(g);
+	game_destroy(g);
+
+	assert(s.turns == 41);
+	assert(s.frames >= 1);
+	assert(s.frames <= 5);
+
+	config.script = "xxxxxxxxxq";
+
+	g = game_create(config);
+	game_loop(g);
+	s = game_get_statistics(g);
+	game_destroy(g);
+
+	assert(s.turns == 10);
+	assert(s.frames == 1);
+}
+
+/*
+ * Without a script the bot explores and descends until the turns are used up,
+ * the same way for the same seed.
+ */
+static void
+_test_bot()
+{
+	for (uint64_t seed = 0; seed < SEEDS; seed++) {
+		struct game_statistics s[2];
+
+		for (int i = 0; i < 2; i++) {
+			struct game *g = game_create(_configuration(seed));
+			game_loop(g);
+			s[i] = game_get_statistics(g);
+			game_destroy(g);
+		}
+
+		assert(s[0].seed == seed);
+		assert(s[0].turns == TURNS);
+		assert(s[0].levels > 0);
+		assert(s[1].turns == s[0].turns);
+		assert(s[1].levels == s[0].levels);
+	}
+}
+
+/*
+ * A saved game is continued where it was left, the seed comes from the save.
+ */
+static void
+_test_save()
+{
+	char path[] = "/tmp/sn-game-XXXXXX";
+	int fd = mkstemp(path);
+	assert(fd != -1);
+	close(fd);
+	unlink(path);
+
+	struct game_configuration config = _configuration(1);
+	config.save = path;
+
+	struct game *g = game_create(config);
+	game_loop(g);
+	game_destroy(g);
+
+	assert(access(path, R_OK) == 0);
+
+	config = _configuration(2);
+	config.save = path;
+	config.height = 100;
+
+	g = game_create(config);
+	game_loop(g);
+	struct game_statistics s = game_get_statistics(g);
+	game_destroy(g);
+
+	assert(s.turns == TURNS);
+	assert(s.levels > 0);
+
+	unlink(path);
+}
+
+/*
+ * Hundreds of monsters play the same on one thread and on several: they end
+ * up in the same places and states, and the games with identical saves. The
+ * cave holds enough monsters for their decisions to be split among threads.
+ */
+static void
+_test_jobs()
+{
+	char paths[2][32];
+	struct monsters before[2];
+	struct monsters after[2];
+
+	for (int i = 0; i < 2; i++) {
+		strcpy(paths[i], "/tmp/sn-jobs-XXXXXX");
+		int fd = mkstemp(paths[i]);
+		assert(fd != -1);
+		close(fd);
+		unlink(paths[i]);
+
+		struct game_configuration config = _configuration(3);
+		config.height = CROWD_SIDE;
+		config.width = CROWD_SIDE;
+		config.generator = DG_CAVE;
+		config.turns = CROWD_TURNS;
+		config.save = paths[i];
+		config.jobs = i == 0 ? 1 : THREADS;
+
+		struct game *g = game_create(config);
+		before[i] = _copy_monsters(game_get_monsters(g));
+		game_loop(g);
+		after[i] = _copy_monsters(game_get_monsters(g));
+		struct game_statistics s = game_get_statistics(g);
+		game_destroy(g);
+
+		/* The monsters compared are the ones of the first level. */
+		assert(s.levels == 0);
+	}
+
+	unsigned int n = after[0].count;
+	assert(n > 0);
+	assert(after[1].count == n);
+	assert(memcmp(after[0].positions, after[1].positions,
+		   n * sizeof(*after[0].positions)) == 0);
+	assert(memcmp(after[0].states, after[1].states,
+		   n * sizeof(*after[0].states)) == 0);
+	assert(memcmp(after[0].rngs, after[1].rngs,
+		   n * sizeof(*after[0].rngs)) == 0);
+	assert(memcmp(after[0].slots, after[1].slots,
+		   n * sizeof(*after[0].slots)) == 0);
+
+	/* Identical monsters prove nothing if none of them did anything. */
+	unsigned int moved = 0;
+	for (unsigned int i = 0; i < n; i++) {
+		for (unsigned int j = 0; j < before[0].count; j++) {
+			if (before[0].slots[j] != after[0].slots[i])
+				continue;
+
+			struct coordinate from = before[0].positions[j];
+			struct coordinate to = after[0].positions[i];
+			if (from.y != to.y || from.x != to.x)
+				moved++;
+		}
+	}
+	assert(moved > 0);
+
+	for (int i = 0; i < 2; i++) {
+		_free_monsters(&before[i]);
+		_free_monsters(&after[i]);
+	}
+
+	assert(_same_files(paths[0], paths[1]));
+
+	unlink(paths[0]);
+	unlink(paths[1]);
+}
+
+/*
+ * The bot explores the world beyond the chunk it starts in, the window follows
+ * it there.
+ */
+static void
+_test_world()
+{
+	struct game_configuration config = _configuration(0);
+	config.generator = DG_WORLD;
+	config.turns = WORLD_TURNS;
+
+	struct game *g = game_create(config);
+	game_loop(g);
+	struct game_statistics s = game_get_statistics(g);
+	game_destroy(g);
+
+	assert(s.turns == WORLD_TURNS);
+	assert(s.levels == 0);
+	assert(s.chunks > WORLD_PREFETCHED);
+}
+
+static bool
+_same_files(const char *a, const char *b)
+{
+	FILE *fa = fopen(a, "rb");
+	FILE *fb = fopen(b, "rb");
+	assert(fa != NULL && fb != NULL);
+
+	int ca, cb;
+	do {
+		ca = fgetc(fa);
+		cb = fgetc(fb);
+	} while (ca == cb && ca != EOF);
+
+	fclose(fa);
+	fclose(fb);
+
+	return (ca == cb);
+}
+
+static struct monsters
+_copy_monsters(const struct actors *actors)
+{
+	struct monsters m = { .count = actors->count };
+
+	m.positions = calloc(m.count + 1, sizeof(*m.positions));
+	m.states = calloc(m.count + 1, sizeof(*m.states));
+	m.rngs = calloc(m.count + 1, sizeof(*m.rngs));
+	m.slots = calloc(m.count + 1, sizeof(*m.slots));
+	assert(m.positions != NULL && m.states != NULL);
+	assert(m.rngs != NULL && m.slots != NULL);
+
+	memcpy(m.positions, actors->positions, m.count * sizeof(*m.positions));
+	memcpy(m.states, actors->states, m.count * sizeof(*m.states));
+	memcpy(m.rngs, actors->rngs, m.count * sizeof(*m.rngs));
+	memcpy(m.slots, actors->slots, m.count * sizeof(*m.slots));
+
+	return (m);
+}
+
+static void
+_free_monsters(struct monsters *monsters)
+{
+	free(monsters->positions);
+	free(monsters->states);
+	free(monsters->rngs);
+	free(monsters->slots);
+}
+
+static struct game_configuration
+_configuration(uint64_t seed)
+{
+	struct game_configuration config = {
+		.height = 40,
+		.width = 40,
+		.range = 4,
+		.rooms = 4,
+		.roomsize = (struct range) { 5, 10 },
+		.torches = (struct range) { 1, 3 },
+		.seed = seed,
+		.headless = true,
+		.turns = TURNS,
+	};
+
+	return (config);
+}
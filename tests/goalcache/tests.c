@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdlib.h>
+
+#include <assert.h>
+
+#include <sine_nomine/coordinate.h>
+#include <sine_nomine/dijkstra.h>
+#include <sine_nomine/goalcache.h>
+#include <sine_nomine/jobs.h>
+#include <sine_nomine/level.h>
+
+enum { HEIGHT = 20,
+	WIDTH = 30,
+	CAPACITY = 2,
+	THREADS = 4,
+	ACQUISITIONS = 400,
+	GOALS = 3,
+};
+
+struct shared {
+	struct goal_cache *cache;
+	struct coordinate goals[GOALS];
+	struct dijkstra_map *expected[GOALS];
+};
+
+static void _test_sharing(void);
+
+static void _test_eviction(void);
+
+static void _test_limit(void);
+
+static void _test_threads(void);
+
+static void _acquire(void *_context, unsigned int _begin, unsigned int _end);
+
+int
+main()
+{
+	_test_sharing();
+	_test_eviction();
+	_test_limit();
+	_test_threads();
+
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * The same goals in any order share a map, other goals or another generation
+ * do not.
+ */
+static void
+_test_sharing()
+{
+	struct coordinate_dimension d = { HEIGHT, WIDTH };
+	struct level *l = level_create(d);
+	struct goal_cache *c = goal_cache_create(l, CAPACITY, DIJKSTRA_MAX);
+
+	struct coordinate ab[2] = { { 1, 2 }, { 10, 20 } };
+	struct coordinate ba[2] = { { 10, 20 }, { 1, 2 } };
+
+	struct dijkstra_map *m1 = goal_cache_acquire(c, ab, 2, 1);
+	struct dijkstra_map *m2 = goal_cache_acquire(c, ba, 2, 1);
+	assert(m1 == m2);
+
+	struct coordinate between = { 10, 15 };
+	assert(dijkstra_get_value(m1, ab[0]) == 0);
+	assert(dijkstra_get_value(m1, ab[1]) == 0);
+	assert(dijkstra_get_value(m1, between) == 5);
+
+	struct dijkstra_map *m3 = goal_cache_acquire(c, ab, 1, 1);
+	struct dijkstra_map *m4 = goal_cache_acquire(c, ab, 2, 2);
+	assert(m3 != m1 && m4 != m1 && m3 != m4);
+
+	struct goal_cache_statistics s = goal_cache_get_statistics(c);
+	assert(s.hits == 1);
+	assert(s.misses == 3);
+
+	/* Referenced maps are kept beyond the capacity. */
+	assert(s.evictions == 0);
+
+	goal_cache_release(c, m1);
+	goal_cache_release(c, m2);
+	goal_cache_release(c, m3);
+	goal_cache_release(c, m4);
+
+	s = goal_cache_get_statistics(c);
+	assert(s.evictions == 1);
+
+	goal_cache_destroy(c);
+	level_destroy(l);
+}
+
+/* The least recently used map goes first. */
+static void
+_test_eviction()
+{
+	struct coordinate_dimension d = { HEIGHT, WIDTH };
+	struct level *l = level_create(d);
+	struct goal_cache *c = goal_cache_create(l, CAPACITY, DIJKSTRA_MAX);
+
+	struct coordinate g[3] = { { 0, 0 }, { 5, 5 }, { 9, 9 } };
+
+	for (int i = 0; i < 2; i++)
+		goal_cache_release(c, goal_cache_acquire(c, &g[i], 1, 0));
+
+	/* g[0] is used again, g[1] is the oldest when g[2] comes. */
+	goal_cache_release(c, goal_cache_acquire(c, &g[0], 1, 0));
+	goal_cache_release(c, goal_cache_acquire(c, &g[2], 1, 0));
+	goal_cache_release(c, goal_cache_acquire(c, &g[0], 1, 0));
+
+	struct goal_cache_statistics s = goal_cache_get_statistics(c);
+	assert(s.hits == 2);
+	assert(s.misses == 3);
+	assert(s.evictions == 1);
+
+	goal_cache_release(c, goal_cache_acquire(c, &g[1], 1, 0));
+
+	s = goal_cache_get_statistics(c);
+	assert(s.misses == 4);
+	assert(s.evictions == 2);
+
+	goal_cache_destroy(c);
+	level_destroy(l);
+}
+
+static void
+_test_limit()
+{
+	struct coordinate_dimension d = { HEIGHT, WIDTH };
+	struct level *l = level_create(d);
+	struct goal_cache *c = goal_cache_create(l, CAPACITY, 3);
+
+	struct coordinate g = { 10, 10 };
+	struct dijkstra_map *m = goal_cache_acquire(c, &g, 1, 0);
+
+	struct coordinate near = { 10, 13 };
+	struct coordinate far = { 10, 14 };
+	assert(dijkstra_get_value(m, near) == 3);
+	assert(dijkstra_get_value(m, far) == DIJKSTRA_MAX);
+
+	goal_cache_release(c, m);
+	goal_cache_destroy(c);
+	level_destroy(l);
+}
+
+/*
+ * Threads acquiring the same goals while the map is built get the finished
+ * map, never one still being flooded.
+ */
+static void
+_test_threads()
+{
+	struct coordinate_dimension d = { HEIGHT, WIDTH };
+	struct level *l = level_create(d);
+
+	struct shared s = { .cache = goal_cache_create(l, 1, DIJKSTRA_MAX) };
+	for (unsigned int i = 0; i < GOALS; i++) {
+		s.goals[i] = (struct coordinate) { 3 + i * 5, 4 + i * 9 };
+		s.expected[i] = dijkstra_create(l);
+		dijkstra_add_target(s.expected[i], s.goals[i], 0);
+	}
+
+	struct jobs *j = jobs_create(THREADS);
+	jobs_run(j, _acquire, &s, ACQUISITIONS, 1);
+	jobs_destroy(j);
+
+	struct goal_cache_statistics st = goal_cache_get_statistics(s.cache);
+	assert(st.hits + st.misses == ACQUISITIONS);
+	assert(st.misses >= GOALS);
+
+	for (unsigned int i = 0; i < GOALS; i++)
+		dijkstra_destroy(s.expected[i]);
+
+	goal_cache_destroy(s.cache);
+	level_destroy(l);
+}
+
+static void
+_acquire(void *context, unsigned int begin, unsigned int end)
+{
+	struct shared *s = context;
+
+	for (unsigned int i = begin; i < end; i++) {
+		unsigned int g = i % GOALS;
+		struct dijkstra_map *m =
+		    goal_cache_acquire(s->cache, &s->goals[g], 1, 0);
+
+		struct coordinate c;
+		for (c.y = 0; c.y < HEIGHT; c.y++) {
+			for (c.x = 0; c.x < WIDTH; c.x++) {
+				assert(dijkstra_get_value(m, c) ==
+				    dijkstra_get_value(s->expected[g], c));
+			}
+		}
+
+		goal_cache_release(s->cache, m);
+	}
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include <assert.h>
+
+#include <sine_nomine/jobs.h>
+
+enum { RUNS = 200,
+	COUNT_MAX = 5000,
+};
+
+struct visits {
+	atomic_uint counts[COUNT_MAX];
+	unsigned int values[COUNT_MAX];
+};
+
+static void _test_every_index_once(unsigned int _threads);
+
+static void _visit(void *_context, unsigned int _begin, unsigned int _end);
+
+int
+main()
+{
+	_test_every_index_once(1);
+	_test_every_index_once(2);
+	_test_every_index_once(8);
+	_test_every_index_once(0);
+
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * Whatever the number of indices, the grain and the threads: every index is
+ * visited exactly once and the run is over when jobs_run() returns.
+ */
+static void
+_test_every_index_once(unsigned int threads)
+{
+	struct jobs *j = jobs_create(threads);
+	assert(jobs_threads(j) >= 1);
+	assert(threads == 0 || jobs_threads(j) == threads);
+
+	struct visits *v = calloc(1, sizeof(struct visits));
+	assert(v != NULL);
+
+	for (unsigned int run = 0; run < RUNS; run++) {
+		unsigned int count = (run * 7919) % COUNT_MAX;
+		unsigned int grain = 1 + run % 97;
+
+		for (unsigned int i = 0; i < COUNT_MAX; i++)
+			atomic_store(&v->counts[i], 0);
+
+		jobs_run(j, _visit, v, count, grain);
+
+		for (unsigned int i = 0; i < COUNT_MAX; i++) {
+			assert(atomic_load(&v->counts[i]) == (i < count));
+			if (i < count)
+				assert(v->values[i] == i * i);
+		}
+	}
+
+	free(v);
+	jobs_destroy(j);
+}
+
+static void
+_visit(void *context, unsigned int begin, unsigned int end)
+{
+	struct visits *v = context;
+
+	assert(begin < end);
+
+	for (unsigned int i = begin; i < end; i++) {
+		atomic_fetch_add(&v->counts[i], 1);
+		v->values[i] = i * i;
+	}
+}
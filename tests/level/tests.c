@@ -0,0 +1,250 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdlib.h>
+
+#include <assert.h>
+
+#include <sine_nomine/coordinate.h>
+#include <sine_nomine/level.h>
+
+enum { HEIGHT = 6,
+	WIDTH = 5,
+};
+
+static void _test_journal_records_changes(void);
+
+static void _test_journal_skips_noops(void);
+
+static void _test_fill_span_resets_journal(void);
+
+static void _test_journal_clear(void);
+
+static void _test_snapshot_isolation(void);
+
+static void _test_snapshot_release_order(void);
+
+int
+main()
+{
+	_test_journal_records_changes();
+	_test_journal_skips_noops();
+	_test_fill_span_resets_journal();
+	_test_journal_clear();
+	_test_snapshot_isolation();
+	_test_snapshot_release_order();
+
+	exit(EXIT_SUCCESS);
+}
+
+static void
+_test_journal_records_changes()
+{
+	struct coordinate_dimension d = { HEIGHT, WIDTH };
+	struct level *l = level_create(d);
+	assert(l != NULL);
+
+	unsigned long g = l->generation;
+
+	struct coordinate a = { 1, 2 };
+	struct coordinate b = { 4, 3 };
+
+	level_set_flags(l, a, TA_FLOOR);
+	level_add_flags(l, b, TA_WALL);
+	level_add_flags(l, a, TA_TORCH);
+	level_remove_flags(l, a, TA_FLOOR);
+
+	assert(l->generation == g + 4);
+	assert(level_get_flags(l, a) == TA_TORCH);
+	assert(level_get_flags(l, b) == TA_WALL);
+
+	unsigned int count;
+	const struct level_change *c = level_journal_since(l, g, &count);
+	assert(c != NULL);
+	assert(count == 4);
+
+	assert(c[0].position.y == a.y && c[0].position.x == a.x);
+	assert(c[0].old_flags == 0 && c[0].new_flags == TA_FLOOR);
+	assert(c[1].position.y == b.y && c[1].position.x == b.x);
+	assert(c[1].old_flags == 0 && c[1].new_flags == TA_WALL);
+	assert(c[2].old_flags == TA_FLOOR);
+	assert(c[2].new_flags == (TA_FLOOR | TA_TORCH));
+	assert(c[3].old_flags == (TA_FLOOR | TA_TORCH));
+	assert(c[3].new_flags == TA_TORCH);
+
+	/* A consumer that already caught up partially only sees the rest. */
+	c = level_journal_since(l, g + 3, &count);
+	assert(c != NULL);
+	assert(count == 1);
+	assert(c[0].new_flags == TA_TORCH);
+
+	level_destroy(l);
+}
+
+static void
+_test_journal_skips_noops()
+{
+	struct coordinate_dimension d = { HEIGHT, WIDTH };
+	struct level *l = level_create(d);
+	assert(l != NULL);
+
+	struct coordinate a = { 0, 0 };
+	level_set_flags(l, a, TA_FLOOR);
+
+	unsigned long g = l->generation;
+
+	level_set_flags(l, a, TA_FLOOR);
+	level_add_flags(l, a, TA_FLOOR);
+	level_remove_flags(l, a, TA_WALL);
+
+	assert(l->generation == g);
+
+	unsigned int count;
+	assert(level_journal_since(l, g, &count) != NULL);
+	assert(count == 0);
+
+	level_destroy(l);
+}
+
+static void
+_test_fill_span_resets_journal()
+{
+	struct coordinate_dimension d = { HEIGHT, WIDTH };
+	struct level *l = level_create(d);
+	assert(l != NULL);
+
+	unsigned long g = l->generation;
+
+	struct coordinate a = { 2, 1 };
+	level_fill_span(l, a, 3, TA_FLOOR);
+
+	assert(l->generation > g);
+
+	for (unsigned int x = 0; x < WIDTH; x++) {
+		struct coordinate c = { 2, x };
+		unsigned int expected = (x >= 1 && x < 4) ? TA_FLOOR : 0;
+		assert(level_get_flags(l, c) == expected);
+	}
+
+	unsigned int count;
+	assert(level_journal_since(l, g, &count) == NULL);
+	assert(level_journal_since(l, l->generation, &count) != NULL);
+	assert(count == 0);
+
+	level_destroy(l);
+}
+
+static void
+_test_journal_clear()
+{
+	struct coordinate_dimension d = { HEIGHT, WIDTH };
+	struct level *l = level_create(d);
+	assert(l != NULL);
+
+	/* Enough changes to force the journal to grow. */
+	for (unsigned int y = 0; y < HEIGHT; y++) {
+		for (unsigned int x = 0; x < WIDTH; x++) {
+			struct coordinate c = { y, x };
+			level_set_flags(l, c, TA_WALL);
+			level_set_flags(l, c, TA_FLOOR);
+			level_add_flags(l, c, TA_KNOWN);
+		}
+	}
+
+	unsigned int count;
+	assert(level_journal_since(l, 0, &count) != NULL);
+	assert(count == 3 * HEIGHT * WIDTH);
+
+	unsigned long g = l->generation;
+	level_journal_clear(l);
+
+	assert(l->generation == g);
+	assert(level_journal_since(l, 0, &count) == NULL);
+	assert(level_journal_since(l, g, &count) != NULL);
+	assert(count == 0);
+
+	level_destroy(l);
+}
+
+static void
+_test_snapshot_isolation()
+{
+	struct coordinate_dimension d = { HEIGHT, WIDTH };
+	struct level *l = level_create(d);
+	assert(l != NULL);
+
+	struct coordinate a = { 1, 1 };
+	struct coordinate b = { 3, 2 };
+	level_set_flags(l, a, TA_FLOOR);
+
+	struct level *s = level_snapshot(l);
+	assert(s != NULL);
+	assert(s->generation == l->generation);
+
+	/* Nothing is copied until somebody writes. */
+	for (unsigned int i = 0; i < l->chunk_count; i++)
+		assert(s->chunks[i] == l->chunks[i]);
+
+	level_set_flags(l, a, TA_WALL);
+	level_set_flags(s, b, TA_TORCH);
+
+	assert(level_get_flags(l, a) == TA_WALL);
+	assert(level_get_flags(s, a) == TA_FLOOR);
+	assert(level_get_flags(l, b) == 0);
+	assert(level_get_flags(s, b) == TA_TORCH);
+
+	/* Only the modified chunks got copied. */
+	for (unsigned int i = 0; i < l->chunk_count; i++) {
+		if (i == level_chunk_index(a) || i == level_chunk_index(b))
+			assert(s->chunks[i] != l->chunks[i]);
+		else
+			assert(s->chunks[i] == l->chunks[i]);
+	}
+
+	level_destroy(s);
+
+	/* Chunks that are no longer shared are modified in place. */
+	struct level_chunk *c = l->chunks[level_chunk_index(b)];
+	level_set_flags(l, b, TA_FLOOR);
+	assert(l->chunks[level_chunk_index(b)] == c);
+
+	level_destroy(l);
+}
+
+static void
+_test_snapshot_release_order()
+{
+	struct coordinate_dimension d = { HEIGHT, WIDTH };
+	struct level *l = level_create(d);
+	assert(l != NULL);
+
+	struct level *s1 = level_snapshot(l);
+	struct level *s2 = level_snapshot(l);
+
+	struct coordinate a = { 0, 4 };
+	level_set_flags(l, a, TA_FLOOR);
+
+	/* The level is gone, the snapshots still share the old chunks. */
+	level_destroy(l);
+
+	for (unsigned int i = 0; i < s1->chunk_count; i++)
+		assert(s1->chunks[i] == s2->chunks[i]);
+	assert(level_get_flags(s1, a) == 0);
+
+	level_destroy(s1);
+	assert(level_get_flags(s2, a) == 0);
+
+	level_destroy(s2);
+}
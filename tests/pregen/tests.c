@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdlib.h>
+
+#include <assert.h>
+
+#include <sine_nomine/coordinate.h>
+#include <sine_nomine/game.h>
+#include <sine_nomine/level.h>
+#include <sine_nomine/pregen.h>
+#include <sine_nomine/region.h>
+
+enum { SEED = 7,
+	DEPTH = 4,
+};
+
+static struct game_configuration config = {
+	.height = 60,
+	.width = 80,
+	.rooms = 5,
+	.range = 4,
+	.roomsize = { 5, 10 },
+	.torches = { 5, 20 },
+	.seed = SEED,
+	.generator = DG_ROOMS,
+};
+
+static void _test_levels(void);
+
+static void _test_deterministic(void);
+
+static void _test_neighbouring_seeds(void);
+
+static void _check_level(struct pregen_level *_level, unsigned int _depth);
+
+int
+main()
+{
+	_test_levels();
+	_test_deterministic();
+	_test_neighbouring_seeds();
+
+	exit(EXIT_SUCCESS);
+}
+
+static void
+_test_levels()
+{
+	struct pregen *p = pregen_create(config, 0);
+
+	for (unsigned int d = 0; d < DEPTH; d++) {
+		struct pregen_level *l = pregen_take(p);
+		_check_level(l, d);
+		pregen_release(l);
+	}
+
+	/* Destroying releases the level generated ahead. */
+	pregen_destroy(p);
+
+	/* A game continued from a save starts deeper. */
+	p = pregen_create(config, DEPTH);
+
+	struct pregen_level *l = pregen_take(p);
+	_check_level(l, DEPTH);
+	pregen_release(l);
+
+	pregen_destroy(p);
+}
+
+static void
+_test_deterministic()
+{
+	struct pregen *a = pregen_create(config, 0);
+	struct pregen *b = pregen_create(config, 0);
+
+	for (unsigned int d = 0; d < DEPTH; d++) {
+		struct pregen_level *la = pregen_take(a);
+		struct pregen_level *lb = pregen_take(b);
+
+		assert(la->spawn.y == lb->spawn.y);
+		assert(la->spawn.x == lb->spawn.x);
+
+		for (unsigned int y = 0; y < config.height; y++) {
+			for (unsigned int x = 0; x < config.width; x++) {
+				struct coordinate c = { y, x };
+				assert(level_get_flags(la->level, c) ==
+				    level_get_flags(lb->level, c));
+			}
+		}
+
+		pregen_release(lb);
+		pregen_release(la);
+	}
+
+	pregen_destroy(b);
+	pregen_destroy(a);
+}
+
+/* The second floor of a seed is not the first floor of the next seed. */
+static void
+_test_neighbouring_seeds()
+{
+	struct game_configuration next = config;
+	next.seed++;
+
+	struct pregen_level *a = pregen_generate(config, 1);
+	struct pregen_level *b = pregen_generate(next, 0);
+
+	unsigned int different = 0;
+	for (unsigned int y = 0; y < config.height; y++) {
+		for (unsigned int x = 0; x < config.width; x++) {
+			struct coordinate c = { y, x };
+			different += (level_get_flags(a->level, c) & TA_WALL) !=
+			    (level_get_flags(b->level, c) & TA_WALL);
+		}
+	}
+	assert(different > 0);
+
+	pregen_release(b);
+	pregen_release(a);
+}
+
+static void
+_check_level(struct pregen_level *level, unsigned int depth)
+{
+	assert(level->depth == depth);
+	assert(level_get_flags(level->level, level->spawn) & TA_FLOOR);
+	assert(level_get_flags(level->level, level->stairs) & TA_STAIRS);
+	assert(!(level_get_flags(level->level, level->spawn) & TA_UPSTAIRS) ==
+	    (depth == 0));
+	assert(region_count(level->regions) == 1);
+
+	unsigned int stairs = 0;
+	for (unsigned int y = 0; y < config.height; y++) {
+		for (unsigned int x = 0; x < config.width; x++) {
+			struct coordinate c = { y, x };
+			unsigned int flags = level_get_flags(level->level, c);
+			assert(!(flags & TA_UPSTAIRS) ||
+			    (y == level->spawn.y && x == level->spawn.x));
+			if (!(flags & TA_STAIRS))
+				continue;
+
+			assert(flags & TA_FLOOR);
+			assert(region_connected(
+			    level->regions, c, level->spawn));
+			stairs++;
+		}
+	}
+
+	assert(stairs == 1);
+}
@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdlib.h>
+
+#include <assert.h>
+
+#include <sine_nomine/coordinate.h>
+#include <sine_nomine/dijkstra.h>
+#include <sine_nomine/level.h>
+#include <sine_nomine/region.h>
+
+enum { HEIGHT = 5,
+	WIDTH = 9,
+};
+
+/* clang-format off */
+static const char *layout[HEIGHT] = {
+	"#########",
+	"#.#.#...#",
+	"#...#.#.#",
+	"#.#.#...#",
+	"#########",
+};
+/* clang-format on */
+
+static struct level *_build(void);
+
+static void _test_labels(void);
+
+static void _test_open_merges(void);
+
+static void _test_close_splits(void);
+
+static void _test_fill_span_relabels(void);
+
+static void _test_restricted_dijkstra(void);
+
+int
+main()
+{
+	_test_labels();
+	_test_open_merges();
+	_test_close_splits();
+	_test_fill_span_relabels();
+	_test_restricted_dijkstra();
+
+	exit(EXIT_SUCCESS);
+}
+
+static struct level *
+_build()
+{
+	struct coordinate_dimension d = { HEIGHT, WIDTH };
+	struct level *l = level_create(d);
+	assert(l != NULL);
+
+	for (unsigned int y = 0; y < HEIGHT; y++) {
+		for (unsigned int x = 0; x < WIDTH; x++) {
+			struct coordinate c = { y, x };
+			level_set_flags(
+			    l, c, layout[y][x] == '#' ? TA_WALL : TA_FLOOR);
+		}
+	}
+
+	return (l);
+}
+
+static void
+_test_labels()
+{
+	struct level *l = _build();
+	struct region_map *rm = region_create(l);
+
+	assert(region_count(rm) == 2);
+
+	/* Both arms of the left region start with different labels. */
+	struct coordinate a = { 1, 1 };
+	struct coordinate b = { 1, 3 };
+	struct coordinate c = { 3, 3 };
+	struct coordinate d = { 1, 5 };
+	struct coordinate e = { 3, 7 };
+	struct coordinate wall = { 2, 4 };
+
+	assert(region_connected(rm, a, b));
+	assert(region_connected(rm, a, c));
+	assert(region_connected(rm, d, e));
+	assert(!region_connected(rm, a, d));
+
+	assert(region_get(rm, wall) == 0);
+	assert(!region_connected(rm, wall, wall));
+
+	region_destroy(rm);
+	level_destroy(l);
+}
+
+static void
+_test_open_merges()
+{
+	struct level *l = _build();
+	struct region_map *rm = region_create(l);
+
+	struct coordinate door = { 2, 4 };
+	level_set_flags(l, door, TA_FLOOR);
+
+	/* Flags that do not change passability are ignored. */
+	struct coordinate a = { 1, 1 };
+	level_add_flags(l, a, TA_VISIBLE);
+
+	region_update(rm);
+	assert(region_count(rm) == 1);
+
+	struct coordinate e = { 3, 7 };
+	assert(region_connected(rm, a, e));
+	assert(region_connected(rm, door, e));
+
+	/* An opened tile without passable neighbors is a region of its own. */
+	struct coordinate corner = { 0, 0 };
+	level_set_flags(l, corner, TA_FLOOR);
+
+	region_update(rm);
+	assert(region_count(rm) == 2);
+	assert(!region_connected(rm, corner, a));
+
+	region_destroy(rm);
+	level_destroy(l);
+}
+
+static void
+_test_close_splits()
+{
+	struct level *l = _build();
+	struct region_map *rm = region_create(l);
+
+	struct coordinate gap = { 2, 1 };
+	level_set_flags(l, gap, TA_WALL);
+	struct coordinate gap2 = { 2, 3 };
+	level_set_flags(l, gap2, TA_WALL);
+
+	region_update(rm);
+	assert(region_count(rm) == 6);
+
+	struct coordinate a = { 1, 1 };
+	struct coordinate b = { 3, 1 };
+	assert(!region_connected(rm, a, b));
+
+	region_destroy(rm);
+	level_destroy(l);
+}
+
+static void
+_test_fill_span_relabels()
+{
+	struct level *l = _build();
+	struct region_map *rm = region_create(l);
+
+	struct coordinate start = { 2, 1 };
+	level_fill_span(l, start, WIDTH - 2, TA_FLOOR);
+
+	region_update(rm);
+	assert(region_count(rm) == 1);
+
+	/* Nothing changed, nothing to do. */
+	region_update(rm);
+	assert(region_count(rm) == 1);
+
+	region_destroy(rm);
+	level_destroy(l);
+}
+
+static void
+_test_restricted_dijkstra()
+{
+	struct level *l = _build();
+	struct region_map *rm = region_create(l);
+
+	struct coordinate origin = { 1, 1 };
+	struct coordinate other = { 1, 5 };
+	struct coordinate wall = { 0, 5 };
+	struct coordinate edge = { 2, 4 };
+
+	struct dijkstra_map *dm = dijkstra_create(l);
+	dijkstra_restrict(dm, rm, origin);
+
+	/* Targets in the other region are rejected. */
+	dijkstra_add_target(dm, other, 0);
+	dijkstra_add_target(dm, wall, 0);
+	assert(dijkstra_get_value(dm, other) == DIJKSTRA_MAX);
+	assert(dijkstra_get_value(dm, wall) == DIJKSTRA_MAX);
+	assert(dijkstra_get_value(dm, origin) == DIJKSTRA_MAX);
+
+	/* A wall between both regions floods only into this one. */
+	dijkstra_add_target(dm, edge, 0);
+	assert(dijkstra_get_value(dm, edge) == 0);
+	assert(dijkstra_get_value(dm, origin) == 4);
+
+	struct coordinate beyond = { 2, 5 };
+	assert(dijkstra_get_value(dm, beyond) == DIJKSTRA_MAX);
+
+	dijkstra_destroy(dm);
+	region_destroy(rm);
+	level_destroy(l);
+}
@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sine_nomine/game.h>
+#include <sine_nomine/replay.h>
+#include <sine_nomine/structs.h>
+#include <sine_nomine/ui.h>
+
+enum { TURNS = 800,
+	ACTIONS = 1000,
+	FILE_MAX = 1 << 16,
+};
+
+static void _test_actions(void);
+
+static void _test_game(void);
+
+static struct game_configuration _configuration(void);
+
+static void _temporary(char *_path);
+
+static size_t _read_file(const char *_path, unsigned char *_buffer);
+
+int
+main()
+{
+	_test_actions();
+	_test_game();
+
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * Actions and configuration come back as they were recorded, runs longer than
+ * a single byte holds included.
+ */
+static void
+_test_actions()
+{
+	char path[] = "/tmp/sn-replay-XXXXXX";
+	_temporary(path);
+
+	UI_ACTION actions[ACTIONS];
+	for (int i = 0; i < ACTIONS; i++) {
+		if (i < 40)
+			actions[i] = UA_TIMEOUT;
+		else if (i % 7 == 0)
+			actions[i] = UA_AUTOEXPLORE;
+		else
+			actions[i] = (i / 3) % (UA_RESIZE + 1);
+	}
+
+	struct game_configuration config = _configuration();
+	config.seed = 0x0123456789abcdefULL;
+	config.generator = DG_CAVE;
+
+	struct recording *r = recording_create(path, config);
+	for (int i = 0; i < ACTIONS; i++)
+		recording_add(r, actions[i]);
+	recording_destroy(r, 1234);
+
+	struct game_configuration c = { 0 };
+	struct replay *p = replay_create(path, &c);
+
+	assert(c.seed == config.seed);
+	assert(c.height == config.height);
+	assert(c.width == config.width);
+	assert(c.rooms == config.rooms);
+	assert(c.range == config.range);
+	assert(c.roomsize.min == config.roomsize.min);
+	assert(c.roomsize.max == config.roomsize.max);
+	assert(c.torches.min == config.torches.min);
+	assert(c.torches.max == config.torches.max);
+	assert(c.generator == config.generator);
+	assert(c.turns == 1234);
+
+	for (int i = 0; i < ACTIONS; i++)
+		assert(replay_next(p) == actions[i]);
+	assert(replay_next(p) == UA_QUIT);
+
+	replay_destroy(p);
+	unlink(path);
+}
+
+/*
+ * Replaying a headless session repeats it: recording the replay again gives
+ * the same file.
+ */
+static void
+_test_game()
+{
+	char first[] = "/tmp/sn-replay-XXXXXX";
+	char second[] = "/tmp/sn-replay-XXXXXX";
+	_temporary(first);
+	_temporary(second);
+
+	struct game_configuration config = _configuration();
+	config.record = first;
+
+	struct game *g = game_create(config);
+	game_loop(g);
+	struct game_statistics recorded = game_get_statistics(g);
+	game_destroy(g);
+
+	config = (struct game_configuration) {
+		.record = second,
+		.replay = first,
+	};
+
+	g = game_create(config);
+	game_loop(g);
+	struct game_statistics replayed = game_get_statistics(g);
+	game_destroy(g);
+
+	assert(recorded.turns == TURNS);
+	assert(replayed.turns == recorded.turns);
+	assert(replayed.levels == recorded.levels);
+
+	static unsigned char a[FILE_MAX], b[FILE_MAX];
+	size_t n = _read_file(first, a);
+	assert(n == _read_file(second, b));
+	assert(memcmp(a, b, n) == 0);
+
+	unlink(second);
+	unlink(first);
+}
+
+static struct game_configuration
+_configuration()
+{
+	struct game_configuration config = {
+		.height = 40,
+		.width = 40,
+		.range = 4,
+		.rooms = 4,
+		.roomsize = (struct range) { 5, 10 },
+		.torches = (struct range) { 1, 3 },
+		.seed = 7,
+		.headless = true,
+		.script = "jjjlllkkk",
+		.turns = TURNS,
+	};
+
+	return (config);
+}
+
+static void
+_temporary(char *path)
+{
+	int fd = mkstemp(path);
+	assert(fd != -1);
+	close(fd);
+}
+
+static size_t
+_read_file(const char *path, unsigned char *buffer)
+{
+	FILE *f = fopen(path, "rb");
+	assert(f != NULL);
+
+	size_t n = fread(buffer, 1, FILE_MAX, f);
+	assert(n < FILE_MAX);
+	fclose(f);
+
+	return (n);
+}
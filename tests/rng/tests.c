@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <assert.h>
+
+#include <sine_nomine/rng.h>
+
+enum { DRAWS = 10000,
+	SMALL_BOUND = 7,
+};
+
+static void _test_known_answers(void);
+
+static void _test_streams(void);
+
+static void _test_uniform(void);
+
+static void _test_derive(void);
+
+int
+main()
+{
+	_test_known_answers();
+	_test_streams();
+	_test_uniform();
+	_test_derive();
+
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * The first numbers of the PCG32 reference implementation (pcg32-demo) for
+ * seed 42 and stream 54. Games are replayed from their seed, the generator
+ * must never change.
+ */
+static void
+_test_known_answers()
+{
+	const uint32_t expected[] = { 0xa15c02b7, 0x7b47f409, 0xba1d3330,
+		0x83d2f293, 0xbfa4784b, 0xcbed606e };
+
+	struct rng r;
+	rng_seed(&r, 42, 54);
+
+	for (size_t i = 0; i < sizeof(expected) / sizeof(*expected); i++)
+		assert(rng_next(&r) == expected[i]);
+}
+
+/* Streams of one seed do not produce the same numbers. */
+static void
+_test_streams()
+{
+	struct rng a;
+	struct rng b;
+	rng_seed(&a, 1, RNG_STREAM_GENERATION);
+	rng_seed(&b, 1, RNG_STREAM_GAMEPLAY);
+
+	unsigned int same = 0;
+	for (int i = 0; i < DRAWS; i++)
+		same += rng_next(&a) == rng_next(&b);
+
+	assert(same < DRAWS / 100);
+
+	/* The same seed and stream do. */
+	rng_seed(&a, 1, RNG_STREAM_WORLD);
+	rng_seed(&b, 1, RNG_STREAM_WORLD);
+	for (int i = 0; i < DRAWS; i++)
+		assert(rng_next(&a) == rng_next(&b));
+}
+
+/* Every number is below the bound, and small bounds are covered. */
+static void
+_test_uniform()
+{
+	const unsigned int bounds[] = { 1, 2, SMALL_BOUND, 1000, 1u << 31,
+		(1u << 31) + 1, UINT32_MAX };
+
+	struct rng r;
+	rng_seed(&r, 3, RNG_STREAM_GAMEPLAY);
+
+	for (size_t i = 0; i < sizeof(bounds) / sizeof(*bounds); i++) {
+		for (int j = 0; j < DRAWS; j++)
+			assert(rng_uniform(&r, bounds[i]) < bounds[i]);
+	}
+
+	bool seen[SMALL_BOUND] = { false };
+	for (int j = 0; j < DRAWS; j++)
+		seen[rng_uniform(&r, SMALL_BOUND)] = true;
+
+	for (int i = 0; i < SMALL_BOUND; i++)
+		assert(seen[i]);
+}
+
+/* Neighbouring seeds and indices do not share derived seeds. */
+static void
+_test_derive()
+{
+	assert(rng_derive(5, 0) == rng_derive(5, 0));
+	assert(rng_derive(5, 1) != rng_derive(6, 0));
+	assert(rng_derive(5, 1) != rng_derive(5, 0));
+	assert(rng_derive(5, 0) != rng_derive(6, 0));
+}
@@ -0,0 +1,347 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <sine_nomine/coordinate.h>
+#include <sine_nomine/dungeon.h>
+#include <sine_nomine/fov.h>
+#include <sine_nomine/game.h>
+#include <sine_nomine/level.h>
+#include <sine_nomine/rng.h>
+#include <sine_nomine/save.h>
+#include <sine_nomine/structs.h>
+
+enum { HEIGHT = 70,
+	WIDTH = 150,
+	ROOMS = 10,
+	ROOM_MIN = 5,
+	ROOM_MAX = 15,
+	TORCHES = 12,
+	LOOKS = 10,
+	RANGE = 6,
+};
+
+/* Offsets of configuration fields in a save, see save.c. */
+enum { OFFSET_ROOMS = 21,
+	OFFSET_ROOMSIZE_MIN = 29,
+	OFFSET_TORCHES_MIN = 37,
+	OFFSET_GENERATOR = 45,
+};
+
+struct patch {
+	long offset;
+	uint32_t value;
+};
+
+static void _test_round_trip(void);
+
+static void _test_missing(void);
+
+static void _test_saver(void);
+
+static void _test_corrupt(void);
+
+static bool _rejected(const char *_path, struct patch _patch);
+
+static struct level *_generate(struct rng *_rng);
+
+static struct coordinate _random_floor(struct level *_level, struct rng *_rng);
+
+int
+main()
+{
+	_test_round_trip();
+	_test_missing();
+	_test_saver();
+	_test_corrupt();
+
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * A partly explored level and the player come back as they were saved, except
+ * for the visibility of the tiles.
+ */
+static void
+_test_round_trip()
+{
+	char path[] = "/tmp/sn-save-XXXXXX";
+	int fd = mkstemp(path);
+	assert(fd != -1);
+	close(fd);
+
+	struct rng r;
+	rng_seed(&r, 3, RNG_STREAM_GENERATION);
+	struct level *l = _generate(&r);
+
+	struct fov *fov = fov_create(l);
+	struct player p = { { 0, 0 }, RANGE };
+	for (int i = 0; i < LOOKS; i++) {
+		p.position = _random_floor(l, &r);
+		fov_calculate(fov, p);
+	}
+	fov_destroy(fov);
+
+	struct save s = {
+		.config = {
+			.height = HEIGHT,
+			.width = WIDTH,
+			.rooms = ROOMS,
+			.range = 4,
+			.roomsize = { ROOM_MIN, ROOM_MAX },
+			.torches = { 1, TORCHES },
+			.seed = 0xfedcba9876543210ULL,
+			.generator = DG_BSP,
+		},
+		.depth = 17,
+		.player = p,
+		.autoexplore = true,
+		.level = l,
+	};
+	rng_seed(&s.gameplay, 5, RNG_STREAM_GAMEPLAY);
+	rng_next(&s.gameplay);
+
+	save_write(path, &s);
+
+	struct save t = { .config = { .turns = 99 } };
+	assert(save_read(path, &t));
+
+	assert(t.config.seed == s.config.seed);
+	assert(t.config.height == HEIGHT);
+	assert(t.config.width == WIDTH);
+	assert(t.config.rooms == ROOMS);
+	assert(t.config.range == 4);
+	assert(t.config.roomsize.min == ROOM_MIN);
+	assert(t.config.roomsize.max == ROOM_MAX);
+	assert(t.config.torches.min == 1);
+	assert(t.config.torches.max == TORCHES);
+	assert(t.config.generator == DG_BSP);
+	assert(t.config.turns == 99);
+
+	assert(t.depth == 17);
+	assert(t.player.position.y == p.position.y);
+	assert(t.player.position.x == p.position.x);
+	assert(t.player.range == RANGE);
+	assert(t.gameplay.state == s.gameplay.state);
+	assert(t.gameplay.increment == s.gameplay.increment);
+	assert(t.autoexplore);
+
+	for (unsigned int y = 0; y < HEIGHT; y++) {
+		for (unsigned int x = 0; x < WIDTH; x++) {
+			struct coordinate c = { y, x };
+			assert(level_get_flags(t.level, c) ==
+			    (level_get_flags(l, c) & ~TA_VISIBLE));
+		}
+	}
+
+	level_destroy(t.level);
+	level_destroy(l);
+	unlink(path);
+}
+
+static void
+_test_missing()
+{
+	struct save s;
+	assert(!save_read("/nonexistent/sn-save", &s));
+}
+
+/*
+ * A background save holds the level as it was when the save was started.
+ */
+static void
+_test_saver()
+{
+	char path[] = "/tmp/sn-save-XXXXXX";
+	int fd = mkstemp(path);
+	assert(fd != -1);
+	close(fd);
+
+	struct rng r;
+	rng_seed(&r, 4, RNG_STREAM_GENERATION);
+	struct level *l = _generate(&r);
+	struct level *expected = level_snapshot(l);
+
+	struct save s = {
+		.config = {
+			.height = HEIGHT,
+			.width = WIDTH,
+			.rooms = ROOMS,
+			.roomsize = { ROOM_MIN, ROOM_MAX },
+			.torches = { 1, TORCHES },
+		},
+		.player = { _random_floor(l, &r), RANGE },
+		.level = l,
+	};
+
+	struct saver *saver = saver_create();
+	saver_write(saver, path, &s);
+
+	for (unsigned int y = 0; y < HEIGHT; y++) {
+		for (unsigned int x = 0; x < WIDTH; x++) {
+			struct coordinate c = { y, x };
+			level_add_flags(l, c, TA_KNOWN);
+		}
+	}
+
+	saver_destroy(saver);
+
+	struct save t;
+	assert(save_read(path, &t));
+
+	for (unsigned int y = 0; y < HEIGHT; y++) {
+		for (unsigned int x = 0; x < WIDTH; x++) {
+			struct coordinate c = { y, x };
+			assert(level_get_flags(t.level, c) ==
+			    level_get_flags(expected, c));
+		}
+	}
+
+	level_destroy(t.level);
+	level_destroy(expected);
+	level_destroy(l);
+	unlink(path);
+}
+
+/*
+ * A configuration the generators cannot cope with makes the save corrupt, it
+ * is not played.
+ */
+static void
+_test_corrupt()
+{
+	char path[] = "/tmp/sn-save-XXXXXX";
+	int fd = mkstemp(path);
+	assert(fd != -1);
+	close(fd);
+
+	struct rng r;
+	rng_seed(&r, 5, RNG_STREAM_GENERATION);
+	struct level *l = _generate(&r);
+
+	struct save s = {
+		.config = {
+			.height = HEIGHT,
+			.width = WIDTH,
+			.rooms = ROOMS,
+			.roomsize = { ROOM_MIN, ROOM_MAX },
+			.torches = { 2, TORCHES },
+			.generator = DG_ROOMS,
+		},
+		.player = { _random_floor(l, &r), RANGE },
+		.level = l,
+	};
+
+	struct patch patches[] = {
+		{ OFFSET_GENERATOR, 99 },
+		{ OFFSET_GENERATOR, DG_WORLD },
+		{ OFFSET_ROOMS, 0 },
+		{ OFFSET_ROOMSIZE_MIN, 0 },
+		{ OFFSET_ROOMSIZE_MIN, ROOM_MAX + 1 },
+		{ OFFSET_TORCHES_MIN, TORCHES + 1 },
+	};
+
+	for (size_t i = 0; i < sizeof(patches) / sizeof(*patches); i++) {
+		save_write(path, &s);
+		assert(_rejected(path, patches[i]));
+	}
+
+	/* The untouched save is fine. */
+	save_write(path, &s);
+	struct save t;
+	assert(save_read(path, &t));
+
+	level_destroy(t.level);
+	level_destroy(l);
+	unlink(path);
+}
+
+/*
+ * Overwrites a field of the save at _path and reads it in a child process,
+ * which is expected to die.
+ */
+static bool
+_rejected(const char *path, struct patch patch)
+{
+	FILE *f = fopen(path, "r+b");
+	assert(f != NULL);
+
+	int r = fseek(f, patch.offset, SEEK_SET);
+	assert(r == 0);
+
+	for (int i = 0; i < 4; i++) {
+		r = fputc((patch.value >> 8 * i) & 0xff, f);
+		assert(r != EOF);
+	}
+
+	r = fclose(f);
+	assert(r == 0);
+
+	pid_t pid = fork();
+	assert(pid != -1);
+
+	if (pid == 0) {
+		/* The child is expected to complain. */
+		f = freopen("/dev/null", "w", stderr);
+		assert(f != NULL);
+
+		struct save t;
+		save_read(path, &t);
+		_exit(EXIT_SUCCESS);
+	}
+
+	int status;
+	assert(waitpid(pid, &status, 0) == pid);
+
+	return (WIFEXITED(status) && WEXITSTATUS(status) != EXIT_SUCCESS);
+}
+
+static struct level *
+_generate(struct rng *rng)
+{
+	struct coordinate_dimension d = { HEIGHT, WIDTH };
+	struct level *l = level_create(d);
+
+	struct coordinate_dimension min = { ROOM_MIN, ROOM_MIN };
+	struct coordinate_dimension max = { ROOM_MAX, ROOM_MAX };
+	dungeon_generate(l, rng, ROOMS, min, max);
+	level_modify_random_floor_tiles(l, rng, TORCHES, TA_TORCH);
+	level_add_flags(l, _random_floor(l, rng), TA_STAIRS);
+
+	return (l);
+}
+
+static struct coordinate
+_random_floor(struct level *level, struct rng *rng)
+{
+	for (;;) {
+		struct coordinate c;
+		c.y = rng_uniform(rng, level->dimension.height);
+		c.x = rng_uniform(rng, level->dimension.width);
+
+		if (level_get_flags(level, c) & TA_FLOOR)
+			return (c);
+	}
+}
@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <assert.h>
+
+#include <sine_nomine/rng.h>
+#include <sine_nomine/scheduler.h>
+
+enum { ACTORS = 1000,
+	ACTIONS = 50000,
+	SPEED_MIN = 25,
+	SPEED_MAX = 400,
+};
+
+/* What the scheduler should do, the slow way. */
+struct reference {
+	bool scheduled[ACTORS];
+	unsigned long time[ACTORS];
+	unsigned long order[ACTORS];
+	unsigned long added;
+	unsigned long now;
+};
+
+static void _test_order(void);
+
+static void _test_remove(void);
+
+static void _test_speed(void);
+
+static void _test_reference(void);
+
+static void _reference_add(
+    struct reference *_reference, unsigned int _actor, unsigned long _delay);
+
+static unsigned int _reference_next(struct reference *_reference);
+
+int
+main()
+{
+	_test_order();
+	_test_remove();
+	_test_speed();
+	_test_reference();
+
+	exit(EXIT_SUCCESS);
+}
+
+static void
+_test_order()
+{
+	struct scheduler *s = scheduler_create();
+	unsigned int actor;
+
+	assert(!scheduler_next(s, &actor));
+
+	scheduler_add(s, 1, 30);
+	scheduler_add(s, 2, 10);
+	scheduler_add(s, 3, 30);
+	scheduler_add(s, 4, 0);
+	assert(scheduler_count(s) == 4);
+
+	unsigned int expected[] = { 4, 2, 1, 3 };
+	unsigned long times[] = { 0, 10, 30, 30 };
+	for (int i = 0; i < 4; i++) {
+		assert(scheduler_next(s, &actor));
+		assert(actor == expected[i]);
+		assert(scheduler_get_time(s) == times[i]);
+		assert(!scheduler_is_scheduled(s, actor));
+	}
+
+	assert(scheduler_count(s) == 0);
+	assert(!scheduler_next(s, &actor));
+	assert(scheduler_get_time(s) == 30);
+
+	/* Wrapping around the calendar. */
+	scheduler_add(s, 5, SCHEDULER_HORIZON - 1);
+	scheduler_add(s, 6, 1);
+	assert(scheduler_next(s, &actor) && actor == 6);
+	assert(scheduler_next(s, &actor) && actor == 5);
+	assert(scheduler_get_time(s) == 30 + SCHEDULER_HORIZON - 1);
+
+	scheduler_destroy(s);
+}
+
+static void
+_test_remove()
+{
+	struct scheduler *s = scheduler_create();
+	unsigned int actor;
+
+	scheduler_add(s, 1, 5);
+	scheduler_add(s, 2, 5);
+	scheduler_add(s, 3, 7);
+
+	scheduler_remove(s, 1);
+	scheduler_remove(s, 1);
+	scheduler_remove(s, 100);
+	assert(!scheduler_is_scheduled(s, 1));
+	assert(scheduler_count(s) == 2);
+
+	/* Scheduled again, the actor goes behind the others. */
+	scheduler_add(s, 1, 5);
+
+	assert(scheduler_next(s, &actor) && actor == 2);
+	assert(scheduler_next(s, &actor) && actor == 1);
+	assert(scheduler_next(s, &actor) && actor == 3);
+	assert(!scheduler_next(s, &actor));
+
+	scheduler_destroy(s);
+}
+
+/* A fast actor acts more often than a slow one. */
+static void
+_test_speed()
+{
+	struct scheduler *s = scheduler_create();
+	unsigned int speeds[] = { SCHEDULER_NORMAL_SPEED,
+		2 * SCHEDULER_NORMAL_SPEED, SCHEDULER_NORMAL_SPEED / 2 };
+	unsigned int actions[3] = { 0 };
+
+	for (unsigned int i = 0; i < 3; i++)
+		scheduler_add(s, i, scheduler_delay(speeds[i]));
+
+	unsigned int actor;
+	while (scheduler_next(s, &actor) &&
+	    scheduler_get_time(s) <= 100 * SCHEDULER_TURN) {
+		actions[actor]++;
+		scheduler_add(s, actor, scheduler_delay(speeds[actor]));
+	}
+
+	assert(actions[0] == 100);
+	assert(actions[1] == 200);
+	assert(actions[2] == 50);
+
+	scheduler_destroy(s);
+}
+
+/*
+ * Actors of random speeds come and go. Each one has to act at the same time
+ * and in the same order as with a plain search for the earliest actor.
+ */
+static void
+_test_reference()
+{
+	struct rng r;
+	rng_seed(&r, 1, RNG_STREAM_GAMEPLAY);
+
+	struct scheduler *s = scheduler_create();
+	struct reference *ref = calloc(1, sizeof(struct reference));
+	assert(ref != NULL);
+
+	for (unsigned int i = 0; i < ACTORS; i++) {
+		unsigned long delay = rng_uniform(&r, SCHEDULER_TURN);
+		scheduler_add(s, i, delay);
+		_reference_add(ref, i, delay);
+	}
+
+	for (unsigned int i = 0; i < ACTIONS; i++) {
+		unsigned int actor;
+		assert(scheduler_next(s, &actor));
+		assert(actor == _reference_next(ref));
+		assert(scheduler_get_time(s) == ref->now);
+
+		/* Now and then an actor dies and another one appears. */
+		if (rng_uniform(&r, 20) == 0) {
+			unsigned int other = rng_uniform(&r, ACTORS);
+			if (other != actor && ref->scheduled[other]) {
+				scheduler_remove(s, other);
+				ref->scheduled[other] = false;
+			}
+		}
+
+		for (unsigned int j = 0; j < 2; j++) {
+			unsigned int a =
+			    j == 0 ? actor : rng_uniform(&r, ACTORS);
+			if (ref->scheduled[a])
+				continue;
+
+			unsigned int speed = SPEED_MIN +
+			    rng_uniform(&r, SPEED_MAX - SPEED_MIN + 1);
+			unsigned long delay = scheduler_delay(speed);
+			scheduler_add(s, a, delay);
+			_reference_add(ref, a, delay);
+		}
+
+		unsigned int count = 0;
+		for (unsigned int j = 0; j < ACTORS; j++)
+			count += ref->scheduled[j];
+		assert(scheduler_count(s) == count);
+	}
+
+	free(ref);
+	scheduler_destroy(s);
+}
+
+static void
+_reference_add(
+    struct reference *reference, unsigned int actor, unsigned long delay)
+{
+	reference->scheduled[actor] = true;
+	reference->time[actor] = reference->now + delay;
+	reference->order[actor] = reference->added++;
+}
+
+static unsigned int
+_reference_next(struct reference *reference)
+{
+	struct reference *r = reference;
+
+	unsigned int next = ACTORS;
+	for (unsigned int i = 0; i < ACTORS; i++) {
+		if (!r->scheduled[i])
+			continue;
+
+		if (next == ACTORS || r->time[i] < r->time[next] ||
+		    (r->time[i] == r->time[next] &&
+			r->order[i] < r->order[next]))
+			next = i;
+	}
+
+	assert(next != ACTORS);
+
+	r->scheduled[next] = false;
+	r->now = r->time[next];
+
+	return (next);
+}
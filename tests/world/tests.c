@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+
+#include <assert.h>
+#include <time.h>
+
+#include <sine_nomine/coordinate.h>
+#include <sine_nomine/level.h>
+#include <sine_nomine/region.h>
+#include <sine_nomine/world.h>
+
+enum { SEED = 42,
+	RADIUS = 1,
+	SPAN = 3, /* chunks, centered on the origin */
+	PREFETCH_TIMEOUT = 10000, /* ms */
+};
+
+static void _test_deterministic(void);
+
+static void _test_regenerated_after_eviction(void);
+
+static void _test_connected_across_chunks(void);
+
+static void _test_prefetch(void);
+
+static void _test_window(void);
+
+static struct level *_copy(struct world *_world);
+
+int
+main()
+{
+	_test_deterministic();
+	_test_regenerated_after_eviction();
+	_test_connected_across_chunks();
+	_test_prefetch();
+	_test_window();
+
+	exit(EXIT_SUCCESS);
+}
+
+static void
+_test_deterministic()
+{
+	struct world *a = world_create(SEED, RADIUS);
+	struct world *b = world_create(SEED, RADIUS);
+	struct world *c = world_create(SEED + 1, RADIUS);
+
+	unsigned int differences = 0;
+	for (int64_t y = -100; y < 100; y++) {
+		for (int64_t x = -100; x < 100; x++) {
+			struct world_position p = { y, x };
+			unsigned int flags = world_get_flags(a, p);
+
+			assert(flags == world_get_flags(b, p));
+			assert(flags == TA_FLOOR || flags == TA_WALL);
+
+			if (flags != world_get_flags(c, p))
+				differences++;
+		}
+	}
+
+	assert(differences > 0);
+
+	world_destroy(c);
+	world_destroy(b);
+	world_destroy(a);
+}
+
+static void
+_test_regenerated_after_eviction()
+{
+	struct world *w = world_create(SEED, RADIUS);
+
+	struct world_position origin = { 0, 0 };
+	world_update(w, origin);
+
+	struct level *before = _copy(w);
+
+	struct world_position far = { 0, 100 * WORLD_CHUNK_SIZE };
+	world_update(w, far);
+
+	struct world_statistics s = world_get_statistics(w);
+	assert(s.evicted > 0);
+
+	world_update(w, origin);
+
+	struct level *after = _copy(w);
+	for (unsigned int y = 0; y < before->dimension.height; y++) {
+		for (unsigned int x = 0; x < before->dimension.width; x++) {
+			struct coordinate c = { y, x };
+			assert(level_get_flags(before, c) ==
+			    level_get_flags(after, c));
+		}
+	}
+
+	level_destroy(after);
+	level_destroy(before);
+	world_destroy(w);
+}
+
+static void
+_test_connected_across_chunks()
+{
+	struct world *w = world_create(SEED, RADIUS);
+
+	struct level *l = _copy(w);
+	struct region_map *rm = region_create(l);
+
+	assert(region_count(rm) == 1);
+
+	region_destroy(rm);
+	level_destroy(l);
+	world_destroy(w);
+}
+
+static void
+_test_prefetch()
+{
+	struct world *w = world_create(SEED, RADIUS);
+
+	struct world_position origin = { 0, 0 };
+	world_update(w, origin);
+
+	unsigned int chunks = (2 * RADIUS + 1) * (2 * RADIUS + 1);
+	struct timespec ms = { 0, 1000000 };
+
+	for (int i = 0; i < PREFETCH_TIMEOUT; i++) {
+		if (world_get_statistics(w).generated == chunks)
+			break;
+
+		nanosleep(&ms, NULL);
+	}
+
+	struct level *l = _copy(w);
+
+	struct world_statistics s = world_get_statistics(w);
+	assert(s.generated == chunks);
+	assert(s.stalls == 0);
+	assert(s.resident == chunks);
+
+	level_destroy(l);
+	world_destroy(w);
+}
+
+/*
+ * A window need not be aligned to the chunks.
+ */
+static void
+_test_window()
+{
+	struct world *w = world_create(SEED, RADIUS);
+
+	struct world_position origin = { -WORLD_CHUNK_SIZE - 7, 33 };
+	struct coordinate_dimension d = { 50, 2 * WORLD_CHUNK_SIZE + 5 };
+	struct level *l = world_window(w, origin, d);
+
+	for (unsigned int y = 0; y < d.height; y++) {
+		for (unsigned int x = 0; x < d.width; x++) {
+			struct coordinate c = { y, x };
+			struct world_position p = { origin.y + y,
+				origin.x + x };
+			assert(level_get_flags(l, c) == world_get_flags(w, p));
+		}
+	}
+
+	level_destroy(l);
+	world_destroy(w);
+}
+
+/*
+ * Copies the SPAN x SPAN chunks around the origin into a level.
+ */
+static struct level *
+_copy(struct world *world)
+{
+	struct coordinate_dimension d = { SPAN * WORLD_CHUNK_SIZE,
+		SPAN * WORLD_CHUNK_SIZE };
+	int64_t offset = (SPAN / 2) * WORLD_CHUNK_SIZE;
+	struct world_position origin = { -offset, -offset };
+
+	return (world_window(world, origin, d));
+}
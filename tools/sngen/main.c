@@ -0,0 +1,405 @@
+/*
+ * Copyright (C) 2019 by Tobias Rehbein <tobias.rehbein@web.de>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <getopt.h>
+#include <limits.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sine_nomine/cave.h>
+#include <sine_nomine/coordinate.h>
+#include <sine_nomine/dungeon.h>
+#include <sine_nomine/err.h>
+#include <sine_nomine/level.h>
+#include <sine_nomine/region.h>
+#include <sine_nomine/rng.h>
+
+/*
+ * sngen generates a batch of levels in parallel and reports the throughput
+ * and latency of the dungeon generator.
+ *
+ * Level i is generated the way the first floor of seed + i is, so it is the
+ * same dungeon `sn --seed <seed + i>` starts with (given the same size and room
+ * options).
+ */
+
+enum { COUNT = 1000,
+	HEIGHT = 100,
+	WIDTH = 100,
+	ROOMS = 5,
+	ROOMMINSIZE = 10,
+	ROOMMAXSIZE = 20,
+	COUNT_MAX = 1 << 24,
+	THREADS_MAX = 1024,
+	DIMENSION_MAX = 1 << 16,
+};
+
+struct batch {
+	unsigned int count;
+	uint64_t seed;
+	DUNGEON_GENERATOR generator;
+	unsigned int rooms;
+	struct coordinate_dimension dimension;
+	struct coordinate_dimension room_min;
+	struct coordinate_dimension room_max;
+	const char *output;
+	bool validate;
+
+	atomic_uint next;
+	atomic_uint invalid;
+	double *latencies;
+};
+
+/* clang-format off */
+static struct option long_options[] = {
+	{ "help",      no_argument,       0,    1},
+	{ "count",     required_argument, 0,    2},
+	{ "threads",   required_argument, 0,    3},
+	{ "seed",      required_argument, 0,    4},
+	{ "height",    required_argument, 0,    5},
+	{ "width",     required_argument, 0,    6},
+	{ "rooms",     required_argument, 0,    7},
+	{ "output",    required_argument, 0,    8},
+	{ "generator", required_argument, 0,    9},
+	{ "validate",  no_argument,       0,    10},
+	{ NULL,        0,                 NULL, 0}
+};
+/* clang-format on */
+
+static const char *generators[] = {
+	[DG_ROOMS] = "rooms",
+	[DG_BSP] = "bsp",
+	[DG_CAVE] = "cave",
+};
+
+static void *_worker(void *_batch);
+
+static void _validate_level(
+    struct batch *_batch, unsigned int _index, struct level *_level);
+
+static void _write_level(
+    struct batch *_batch, unsigned int _index, struct level *_level);
+
+static void _report(struct batch *_batch, unsigned int _threads, double _ms);
+
+static int _compare_doubles(const void *_a, const void *_b);
+
+static double _now(void);
+
+static uint64_t _parse_number(char **_argv, const char *_text, uint64_t _max);
+
+static void _print_help(char **_argv);
+
+int
+main(int argc, char **argv)
+{
+	struct batch batch = {
+		.count = COUNT,
+		.seed = rng_entropy(),
+		.rooms = ROOMS,
+		.dimension = { HEIGHT, WIDTH },
+		.room_min = { ROOMMINSIZE, ROOMMINSIZE },
+		.room_max = { ROOMMAXSIZE, ROOMMAXSIZE },
+	};
+
+	long threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (threads < 1)
+		threads = 1;
+
+	int option, long_index;
+	while ((option = getopt_long_only(
+		    argc, argv, "", long_options, &long_index)) != -1) {
+		switch (option) {
+		case 1:
+			_print_help(argv);
+			exit(EXIT_SUCCESS);
+		case 2:
+			batch.count = _parse_number(argv, optarg, COUNT_MAX);
+			break;
+		case 3:
+			threads = _parse_number(argv, optarg, THREADS_MAX);
+			break;
+		case 4:
+			batch.seed = _parse_number(argv, optarg, UINT64_MAX);
+			break;
+		case 5:
+			batch.dimension.height =
+			    _parse_number(argv, optarg, DIMENSION_MAX);
+			break;
+		case 6:
+			batch.dimension.width =
+			    _parse_number(argv, optarg, DIMENSION_MAX);
+			break;
+		case 7:
+			batch.rooms = _parse_number(argv, optarg, UINT_MAX);
+			break;
+		case 8:
+			batch.output = optarg;
+			break;
+		case 9:
+			if (strcmp(optarg, "rooms") == 0)
+				batch.generator = DG_ROOMS;
+			else if (strcmp(optarg, "bsp") == 0)
+				batch.generator = DG_BSP;
+			else if (strcmp(optarg, "cave") == 0)
+				batch.generator = DG_CAVE;
+			else
+				die("error: unknown generator '%s'\n", optarg);
+			break;
+		case 10:
+			batch.validate = true;
+			break;
+		default:
+			_print_help(argv);
+			exit(EXIT_FAILURE);
+		}
+	}
+	if (batch.count < 1)
+		die("error: count must be at least 1\n");
+	if (threads < 1)
+		die("error: threads must be at least 1\n");
+	if (batch.rooms < 1)
+		die("error: rooms must be at least 1\n");
+	if (batch.dimension.width < 25)
+		die("error: width must not be smaller than 25\n");
+	if (batch.dimension.height < 25)
+		die("error: height must not be smaller than 25\n");
+
+	batch.latencies = calloc(batch.count, sizeof(*batch.latencies));
+	if (batch.latencies == NULL)
+		err("calloc");
+
+	assert(batch.latencies != NULL);
+
+	atomic_init(&batch.next, 0);
+	atomic_init(&batch.invalid, 0);
+
+	pthread_t *workers = calloc(threads, sizeof(*workers));
+	if (workers == NULL)
+		err("calloc");
+
+	assert(workers != NULL);
+
+	double start = _now();
+
+	for (long i = 0; i < threads; i++) {
+		if (pthread_create(&workers[i], NULL, _worker, &batch) != 0)
+			err("pthread_create");
+	}
+
+	for (long i = 0; i < threads; i++)
+		pthread_join(workers[i], NULL);
+
+	_report(&batch, threads, _now() - start);
+
+	free(workers);
+	free(batch.latencies);
+
+	if (atomic_load(&batch.invalid) > 0)
+		return (EXIT_FAILURE);
+
+	return (EXIT_SUCCESS);
+}
+
+static void *
+_worker(void *arg)
+{
+	struct batch *batch = arg;
+	struct rng rng;
+
+	for (;;) {
+		unsigned int i = atomic_fetch_add(&batch->next, 1);
+		if (i >= batch->count)
+			break;
+
+		double start = _now();
+
+		rng_seed(&rng, rng_derive(batch->seed + i, 0),
+		    RNG_STREAM_GENERATION);
+
+		struct level *l = level_create(batch->dimension);
+
+		switch (batch->generator) {
+		case DG_ROOMS:
+			dungeon_generate(l, &rng, batch->rooms,
+			    batch->room_min, batch->room_max);
+			break;
+
+		case DG_BSP:
+			dungeon_generate_bsp(
+			    l, &rng, batch->room_min, batch->room_max);
+			break;
+
+		case DG_CAVE:
+			cave_generate(l, &rng, CAVE_FILL, CAVE_ITERATIONS);
+			break;
+
+		case DG_WORLD:
+			/* Not accepted by --generator. */
+			break;
+		}
+
+		batch->latencies[i] = _now() - start;
+
+		if (batch->validate)
+			_validate_level(batch, i, l);
+
+		if (batch->output != NULL)
+			_write_level(batch, i, l);
+
+		level_destroy(l);
+	}
+
+	return (NULL);
+}
+
+/*
+ * Every floor tile of a generated level must be reachable from every other
+ * one.
+ */
+static void
+_validate_level(struct batch *batch, unsigned int index, struct level *level)
+{
+	struct region_map *rm = region_create(level);
+
+	unsigned int regions = region_count(rm);
+	if (regions != 1) {
+		fprintf(stderr, "level %llu: %u regions\n",
+		    (unsigned long long)(batch->seed + index), regions);
+		atomic_fetch_add(&batch->invalid, 1);
+	}
+
+	region_destroy(rm);
+}
+
+static void
+_write_level(struct batch *batch, unsigned int index, struct level *level)
+{
+	char path[4096];
+	snprintf(path, sizeof(path), "%s/level-%llu.txt", batch->output,
+	    (unsigned long long)(batch->seed + index));
+
+	FILE *f = fopen(path, "w");
+	if (f == NULL)
+		err("fopen %s", path);
+
+	for (unsigned int y = 0; y < level->dimension.height; y++) {
+		for (unsigned int x = 0; x < level->dimension.width; x++) {
+			struct coordinate c = { y, x };
+			fputc(level_get_flags(level, c) & TA_FLOOR ? '.' : '#',
+			    f);
+		}
+
+		fputc('\n', f);
+	}
+
+	if (fclose(f) != 0)
+		err("fclose %s", path);
+}
+
+static void
+_report(struct batch *batch, unsigned int threads, double ms)
+{
+	qsort(batch->latencies, batch->count, sizeof(*batch->latencies),
+	    _compare_doubles);
+
+	double *l = batch->latencies;
+	unsigned int n = batch->count;
+	size_t p50 = (size_t)n * 50 / 100;
+	size_t p90 = (size_t)n * 90 / 100;
+	size_t p99 = (size_t)n * 99 / 100;
+
+	printf("levels:   %u (%ux%u, %s)\n", n, batch->dimension.height,
+	    batch->dimension.width, generators[batch->generator]);
+	printf("threads:  %u\n", threads);
+	printf("seeds:    %llu - %llu\n", (unsigned long long)batch->seed,
+	    (unsigned long long)(batch->seed + n - 1));
+	printf("time:     %.3f ms (%.1f levels/s)\n", ms, n / (ms / 1000.0));
+	printf("latency:  p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+	    l[p50], l[p90], l[p99], l[n - 1]);
+
+	if (batch->validate)
+		printf("invalid:  %u\n", atomic_load(&batch->invalid));
+}
+
+static int
+_compare_doubles(const void *a, const void *b)
+{
+	double da = *(const double *)a;
+	double db = *(const double *)b;
+
+	return ((da > db) - (da < db));
+}
+
+static double
+_now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0);
+}
+
+/*
+ * Returns the decimal number in _text. Prints the help and exits if _text is
+ * anything else, or the number is larger than _max.
+ */
+static uint64_t
+_parse_number(char **argv, const char *text, uint64_t max)
+{
+	char *end;
+	errno = 0;
+	unsigned long long n = strtoull(text, &end, 10);
+
+	/* strtoull() accepts signs and leading space, numbers do not. */
+	if (!isdigit((unsigned char)text[0]) || errno != 0 || *end != '\0' ||
+	    n > max) {
+		_print_help(argv);
+		exit(EXIT_FAILURE);
+	}
+
+	return (n);
+}
+
+static void
+_print_help(char **argv)
+{
+	/* clang-format off */
+	printf("Usage: %s [options]\n", argv[0]);
+	printf("       --help                 print this help\n");
+	printf("       --count   <number>     number of levels to generate\n");
+	printf("       --threads <number>     number of worker threads\n");
+	printf("       --seed    <number>     seed of the first level\n");
+	printf("       --rooms   <number>     number of rooms to generate\n");
+	printf("       --height  <number>     height of the levels\n");
+	printf("       --width   <number>     width of the levels\n");
+	printf("       --output  <directory>  write the levels to this directory\n");
+	printf("       --generator <name>     dungeon generator: rooms (default), bsp or cave\n");
+	printf("       --validate             check that every level is connected\n");
+	/* clang-format on */
+}